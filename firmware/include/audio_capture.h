@@ -24,6 +24,10 @@ String audio_build_json();
 float audio_get_rms_db();
 float audio_get_peak_db();
 
+// Capture window of the last result on the shared timebase (timebase_now_us()).
+uint64_t audio_get_start_us();
+uint64_t audio_get_end_us();
+
 // --- Analysis functions (exposed for unit testing) ---
 
 // Compute RMS of 16-bit signed samples, return as dB relative to full-scale.
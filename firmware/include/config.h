@@ -10,8 +10,12 @@
 #if NUM_SENSORS > 16
   #error "NUM_SENSORS cannot exceed 16 (MCP23017 limit: GPA0-7 + GPB0-7)"
 #endif
+#define SENSOR_PIN_MASK       ((uint16_t)((1UL << NUM_SENSORS) - 1))  // GPA0.. then GPB0..
 #define SENSOR_SPACING_MM     100.0f  // Distance between adjacent sensors
 #define HO_SCALE_FACTOR       87.1f   // HO scale ratio
+#define DEFAULT_SCALE         SCALE_HO  // Boot-time scale (N, HO, S, O selectable at runtime)
+// Measured per-gap spacing overrides SENSOR_SPACING_MM (NUM_SENSORS - 1 entries):
+// #define SENSOR_GAPS_MM     { 100.0f, 100.5f, 99.8f }
 
 // --- MCP23017 ---
 #define MCP23017_ADDR         0x27    // A0=A1=A2=HIGH on this board
@@ -44,9 +48,52 @@
 #define I2C_FREQ      400000  // 400kHz
 
 // --- Timing ---
-#define DETECTION_TIMEOUT_MS  60000   // Max time to wait for a complete pass
+#define DETECTION_TIMEOUT_MS  60000   // Max wait for the second sensor (no speed measured yet)
+#define EDGE_TIMEOUT_FACTOR   3.0f    // Later edges: wait this many expected gap times (covers a missed sensor)
+#define EDGE_TIMEOUT_MIN_MS   500     // Floor for the per-interval timeout
 #define MIN_RETRIGGER_US      1000    // Ignore re-triggers faster than 1ms
+#define TRAILING_EDGE_TIMEOUT_MS 5000 // Max wait for clears after the last sensor blocks
+#define EARLY_STOP_INTERVALS  0       // End a run once this many latest intervals agree (0 = off)
+#define EARLY_STOP_TOLERANCE  0.03f   // Agreement: every interval within +/- this fraction of their mean
 #define ARM_SETTLE_MS         50      // Settle time after arming before accepting triggers
+#define SENSOR_EVENT_RING_SIZE 32     // Queued ISR events (power of 2); covers loop stalls
+
+// --- Sensor task ---
+#define SENSOR_TASK_PRIORITY  10      // Above loop() (1) and AsyncTCP (3)
+#define SENSOR_TASK_CORE      1       // APP_CPU; WiFi/lwIP run on core 0
+#define SENSOR_TASK_STACK     4096    // Bytes
+#define SENSOR_TASK_POLL_MS   5       // Settle/timeout check interval while armed
+#define SENSOR_RESULT_QUEUE_LEN 4     // Completed runs buffered for loop()
+#define SENSOR_INTERVAL_QUEUE_LEN 8   // Interval events buffered for loop()
+
+// --- Speed sweep ---
+#define SWEEP_DEFAULT_SETTLE_MS   5000    // Wait after speed change before arming
+#define SWEEP_DEFAULT_TIMEOUT_MS  90000   // Max wait for a pass
+#define SWEEP_STOP_MS             1000    // Stop / reverse pauses between passes
+#define SWEEP_MAX_PASSES          8       // Per-step pass cap
+#define SWEEP_SPARSE_KNOTS        12      // Sparse sweep: initial steps measured
+#define SWEEP_REFINE_TOL_PCT      2.0f    // Sparse sweep: refine where model error/CI exceeds this
+#define SWEEP_REFINE_ROUNDS       4       // Sparse sweep: refinement rounds after the initial knots
+
+// --- Multi-pass aggregation ---
+#define PASS_STATS_MAX            SWEEP_MAX_PASSES
+#define PASS_STATS_REJECT_K       3.5f    // Outlier if > K robust sigmas (1.4826*MAD) from median
+#define PASS_STATS_MIN_SPREAD     0.01f   // Rejection threshold floor, fraction of median
+
+// --- Momentum profiling ---
+#define MOMENTUM_DEFAULT_STEP     60      // Step to accelerate to / decelerate from
+#define MOMENTUM_STOP_WAIT_MS     10000   // After stopping, for CV4 momentum to run out
+#define MOMENTUM_TIMEOUT_MS       60000   // Max wait for each profiling pass
+
+// --- Start-of-motion search ---
+#define MOTION_SEARCH_LOW         1       // Default step range to bisect
+#define MOTION_SEARCH_HIGH        20
+#define MOTION_PROBE_MS           2000    // Max watch time per probe
+#define MOTION_SPINUP_MS          300     // Delay before the vibration window
+#define MOTION_STOP_MS            1000    // Pause after stopping between probes
+#define MOTION_VIB_RMS_FACTOR     2.0f    // Onset: rms > baseline * factor + margin
+#define MOTION_VIB_RMS_MARGIN     5.0f    // ADC counts
+#define MOTION_LOAD_DELTA_G       2.0f    // Onset: load cell change from baseline
 
 // --- WiFi ---
 #define WIFI_AP_SSID      "SpeedCal"
@@ -60,7 +107,9 @@
 #define MQTT_DEFAULT_PREFIX   "/cova"
 #define MQTT_DEFAULT_NAME     "speed-cal"
 #define MQTT_RECONNECT_MS     5000    // Retry interval on disconnect
-// Sensor topics: {prefix}/speed-cal/{name}/arm, /stop, /status, /result, /error
+// Sensor topics: {prefix}/speed-cal/{name}/arm, /stop, /status, /result, /error,
+//   /sweep/start, /sweep/abort, /sweep_step, /sweep,
+//   /motion_search/start, /motion_search/abort, /motion_search
 // Throttle topics: {prefix}/speed-cal/throttle/acquire, /speed, /direction, etc.
 #define THROTTLE_TOPIC_NAME   "throttle"
 
@@ -69,17 +118,57 @@
 #define HTTP_PORT         80
 
 // --- HX711 Load Cell ---
-#define HX711_DOUT_PIN        16      // Data out from HX711
-#define HX711_SCK_PIN         17      // Clock to HX711
-#define LOAD_CELL_SAMPLE_MS   100     // Read interval (ms)
-#define LOAD_CELL_EMA_ALPHA   0.3f    // Smoothing factor (0-1, higher = less smoothing)
+#define HX711_DOUT_PIN        16      // Data out from HX711 (SPI MISO + ready interrupt)
+#define HX711_SCK_PIN         17      // Clock to HX711 (SPI MOSI carries the clock pattern)
+#define HX711_SPI_HZ          1000000 // 1us per SPI bit: 1us high / 1us low HX711 clock
+#define HX711_SPS             80      // Conversion rate (RATE pin high; 10 if low)
+#define HX711_RING_SIZE       32      // Queued samples (power of 2); 400ms at 80 SPS
+#define HX711_TASK_PRIORITY   5       // Below the sensor task, above loop() (1)
+#define HX711_TASK_CORE       1
+#define HX711_TASK_STACK      2048    // Bytes
+#define HX711_TIMEOUT_MS      5000    // No samples this long: warn (DOUT stuck HIGH)
+#define LOAD_CELL_EMA_ALPHA   0.05f   // Smoothing factor per sample (~0.25s at 80 SPS)
 #define LOAD_CELL_CAL_FACTOR  420.0f  // Raw units per gram (tune with known weight)
+#define LOAD_CELL_HISTORY_SIZE 512    // Timestamped samples kept (6.4s at 80 SPS)
+#define WINDOW_STATS_MAX      LOAD_CELL_HISTORY_SIZE
+#define PULL_STATS_WINDOW_MS  2000    // Pull reading: load cell window ending at the reading
+#define PULL_SETTLE_WINDOW_MS 500     // Auto settle: steadiness window (also the minimum settle)
+#define PULL_SETTLE_MAX_SLOPE 2.0f    // Auto settle: max |slope|, g/s
+#define PULL_SETTLE_MAX_SD    1.0f    // Auto settle: max stddev, g
+#define PULL_SETTLE_REL_TOL   0.02f   // Stddev limit (and the minimum change) widen to this fraction of the pull
+#define PULL_SETTLE_MIN_CHANGE 3.0f   // Auto settle: load moved off the previous reading by this much, g
+#define PULL_SETTLE_MIN_SAMPLES 4     // Fewer in the window: keep waiting
+#define PULL_RAMP_STEPS_PER_S 2.0f    // Ramp mode: throttle climb rate (126 steps in ~1 min)
+#define PULL_RAMP_PLATEAU_BINS 2      // Ramp ends this many bins after the last rise in pull
+#define PULL_RAMP_PLATEAU_REL 0.02f   // A rise must beat the peak by this fraction
+#define PULL_RAMP_MIN_PEAK_G  20.0f   // No plateau below this pull (loco not loaded yet)
 
 // --- Piezo Vibration ---
 #define PIEZO_ADC_PIN         36      // ADC1_CH0 (VP), safe with WiFi
 #define VIBRATION_CAPTURE_MS  500     // Default capture window (ms)
-#define VIBRATION_SAMPLE_US   500     // Sample interval (~2kHz)
-#define VIBRATION_MAX_SAMPLES 1200    // Buffer size (headroom over 500ms/500us = 1000 samples)
+#define VIBRATION_SAMPLE_HZ   10000   // Timer-driven sample rate
+#define VIBRATION_MAX_SAMPLES 6000    // Spectrum buffer: first 600ms of a capture at 10kHz
+#define VIBRATION_MAX_CAPTURE_MS 600000  // Longest capture (statistics are single-pass, any length)
+#define VIBRATION_HIST_BINS   13      // Octave bins of |sample - bias| up to 4095 counts
+#define VIBRATION_BLOCK_SAMPLES 256   // Double-buffer block handed from the sampler task to loop()
+#define VIBRATION_TIMER       0       // Hardware timer driving the sampler
+#define VIBRATION_TASK_PRIORITY 8     // Below the sensor task, above HX711 and loop()
+#define VIBRATION_TASK_CORE   1
+#define VIBRATION_TASK_STACK  2048    // Bytes
+#define VIBRATION_FFT_LOG2    10      // Welch segment length 2^10 = 1024 points, 50% overlap
+#define VIBRATION_FFT_PEAKS   5       // Dominant peaks reported per capture
+#define VIBRATION_PEAK_MIN    1.0f    // Ignore spectral peaks below this amplitude (ADC counts)
+#define VIBRATION_SPECTRUM_BANDS 16   // Compact spectrum stored per pull test step (dB per band)
+
+// --- Order tracking (vibration against wheel revolutions) ---
+#define ORDER_WHEEL_DIA_MM    0.0f    // Model wheel diameter; 0 = off until set (`order D [T]`)
+#define ORDER_MESH_ORDER      0       // Gear-mesh order: teeth engaging per wheel revolution (0 = none)
+#define ORDER_SAMPLES_PER_REV 64      // Angle-domain samples per revolution (orders up to 31)
+#define ORDER_MAX_REVS        16      // Revolutions analysed per pass (scratch = 64 x 16 floats)
+#define ORDER_MATCH_MS        2000    // Capture must start within this long of the pass's first edge
+#define ORDER_DECIM_HZ        2000    // Pass capture boxcar-decimated to this rate at the start
+#define ORDER_DECIM_SAMPLES   8192    // Decimated buffer (16KB); the rate halves each time it fills
+#define ORDER_MAX_CAPTURE_MS  60000   // Pass capture ends with the run, or after this long
 
 // --- INMP441 Audio ---
 #define I2S_SCK_PIN           18      // I2S bit clock
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Fixed-capacity single-producer / single-consumer event ring.
+ *
+ * Designed for handing timestamped events from an ISR (producer) to
+ * loop() (consumer) without locks or critical sections. Exactly one
+ * context may call push() and exactly one other context may call pop(),
+ * peek(), clear() and size().
+ *
+ * head and tail are free-running counters, so all N slots are usable and
+ * wrap-around is handled by unsigned subtraction. When the ring is full,
+ * push() drops the NEW event and bumps the overflow counter — the consumer
+ * always sees the oldest events, in order, and can tell how many were lost.
+ *
+ * push() is force-inlined so it lands in the caller's IRAM_ATTR ISR.
+ */
+template <typename T, uint32_t N>
+class EventRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "EventRing capacity must be a power of two");
+
+public:
+    static constexpr uint32_t CAPACITY = N;
+
+    // Producer side. Returns false (and counts an overflow) if full.
+    __attribute__((always_inline)) inline bool push(const T& item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        uint32_t depth = head - tail;
+        if (depth >= N) {
+            overflows_.store(overflows_.load(std::memory_order_relaxed) + 1,
+                             std::memory_order_relaxed);
+            return false;
+        }
+        slots_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        if (depth + 1 > highWater_.load(std::memory_order_relaxed)) {
+            highWater_.store(depth + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer side. Returns false if empty.
+    bool pop(T& out) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        out = slots_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Copy the oldest event without removing it.
+    bool peek(T& out) const {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        out = slots_[tail & (N - 1)];
+        return true;
+    }
+
+    // Consumer side. Discard everything currently queued.
+    void clear() {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // Number of events waiting (snapshot).
+    uint32_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Events dropped because the ring was full (since construction).
+    uint32_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+    // Deepest the ring has ever been (since construction).
+    uint32_t high_water() const { return highWater_.load(std::memory_order_relaxed); }
+
+private:
+    T slots_[N];
+    std::atomic<uint32_t> head_{0};       // Written by producer only
+    std::atomic<uint32_t> tail_{0};       // Written by consumer only
+    std::atomic<uint32_t> overflows_{0};  // Written by producer only
+    std::atomic<uint32_t> highWater_{0};  // Written by producer only
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fixed-point (Q15) radix-2 FFT and spectrum summaries for vibration
+// captures.
+//
+// fft_q15() is an in-place decimation-in-time complex FFT that halves
+// every stage, so the output is the DFT divided by n and can never
+// overflow: keep the input magnitude within +/-32767 and every stage
+// stays within it. Twiddles come from one table for FFT_MAX_SIZE; smaller
+// power-of-two sizes stride through it.
+//
+// Pure computation, no allocation; unit-tested and benchmarked natively.
+
+static const int FFT_MAX_LOG2 = 10;
+static const int FFT_MAX_SIZE = 1 << FFT_MAX_LOG2;
+
+struct SpectrumPeak {
+    float hz;           // Parabolic-interpolated frequency
+    float magnitude;    // Interpolated peak magnitude (same units as input)
+};
+
+// In-place forward FFT of n = 2^log2n points (log2n <= FFT_MAX_LOG2).
+// Result is DFT/n.
+void fft_q15(int16_t* re, int16_t* im, int log2n);
+
+// Multiply by a Hann window in place (Q15). Coherent gain 0.5.
+void fft_window_hann(int16_t* x, int n);
+
+// Add re^2 + im^2 of bins 0..n/2 into power[] (accumulate for Welch averaging).
+void fft_accumulate_power(const int16_t* re, const int16_t* im, int n, float* power);
+
+// Up to maxPeaks local maxima of mag[1..bins-2] above minMag, largest
+// first. Returns the number written.
+int spectrum_peaks(const float* mag, int bins, float binHz, float minMag,
+                   SpectrumPeak* out, int maxPeaks);
+
+// Sum of power[] over bins whose centre lies in [loHz, hiHz).
+float spectrum_band_power(const float* power, int bins, float binHz, float loHz, float hiHz);
+
+// Power-weighted mean frequency, DC bin excluded (0 if no power).
+float spectrum_centroid(const float* power, int bins, float binHz);
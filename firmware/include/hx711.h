@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+// HX711 24-bit load cell ADC, clocked by the SPI peripheral.
+//
+// The HX711 clock is generated on the SPI MOSI line (routed to
+// HX711_SCK_PIN): each HX711 clock pulse is the bit pair "10", so a
+// 7-byte transfer of 0xAA x6 + 0x80 gives exactly 25 pulses (24 data bits
+// plus one to select channel A, gain 128) with SCK idling low. DOUT is
+// routed to MISO and sampled in the low half of each pulse, i.e. the odd
+// bits of the received frame. No extra wiring versus bit-banging.
+//
+// The DOUT falling edge (conversion ready) is timestamped in an ISR that
+// wakes a driver task; the task clocks the frame out over SPI and pushes
+// the sample into a ring that loop() drains. Reads run at the chip's own
+// rate (80 SPS with RATE high) and never block loop().
+
+struct Hx711Sample {
+    int32_t raw;            // Sign-extended 24-bit reading
+    uint64_t timestampUs;   // timebase_now_us() at the DOUT falling edge
+};
+
+// Bytes clocked per reading (25 HX711 pulses as "10" bit pairs).
+static const int HX711_FRAME_BYTES = 7;
+
+// Fill tx with the clock pattern for one reading.
+static inline void hx711_clock_pattern(uint8_t* tx) {
+    for (int i = 0; i < HX711_FRAME_BYTES - 1; i++) tx[i] = 0xAA;
+    tx[HX711_FRAME_BYTES - 1] = 0x80;   // 25th pulse: channel A, gain 128
+}
+
+// Decode a received frame: data bit k is frame bit 2k+1 (MSB first),
+// sampled while SCK is low after its k-th rising edge.
+static inline int32_t hx711_decode_frame(const uint8_t* rx) {
+    uint32_t raw = 0;
+    for (int k = 0; k < 24; k++) {
+        int bit = 2 * k + 1;
+        raw = (raw << 1) | ((rx[bit >> 3] >> (7 - (bit & 7))) & 1);
+    }
+    if (raw & 0x800000) {
+        raw |= 0xFF000000;
+    }
+    return (int32_t)raw;
+}
+
+// Configure SPI, attach the DOUT interrupt and start the driver task.
+// Call once in setup().
+void hx711_init();
+
+// Take the oldest queued sample. Call from loop(). Returns false if none.
+bool hx711_take(Hx711Sample& sample);
+
+// Samples read since boot.
+uint32_t hx711_sample_count();
+
+// Sample ring diagnostics (since boot).
+uint32_t hx711_high_water();
+uint32_t hx711_overflows();
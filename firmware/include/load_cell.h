@@ -1,11 +1,13 @@
 #pragma once
 
 #include <Arduino.h>
+#include "window_stats.h"
 
-// Initialize HX711 GPIO pins. Call once in setup().
+// Load the calibration factor and start the HX711 driver. Call once in setup().
 void load_cell_init();
 
-// Non-blocking periodic read. Call from loop().
+// Apply samples queued by the HX711 driver (all of them, 80 SPS).
+// Non-blocking. Call from loop().
 void load_cell_process();
 
 // Zero the current reading (set tare offset).
@@ -17,6 +19,17 @@ float load_cell_get_grams();
 // Get latest raw (unsmoothed, untared) ADC value.
 int32_t load_cell_get_raw();
 
+// Time of the latest reading on the shared timebase (timebase_now_us()).
+uint64_t load_cell_get_sample_us();
+
+// Statistics in grams (tared, unsmoothed) over the samples taken in
+// [fromUs, toUs] (timebase_now_us()). The last LOAD_CELL_HISTORY_SIZE
+// samples are kept. Returns false if none fall in the window.
+bool load_cell_window_stats(uint64_t fromUs, uint64_t toUs, WindowStats& out);
+
+// Statistics over the last windowMs up to the newest sample.
+bool load_cell_recent_stats(uint32_t windowMs, WindowStats& out);
+
 // True if at least one valid reading has been taken.
 bool load_cell_is_ready();
 
@@ -5,7 +5,8 @@
 #include "config.h"
 
 // Initialize the MCP23017 for sensor input with interrupt-on-change.
-// Configures GPA0-GPA(NUM_SENSORS-1) as inputs with interrupt enabled.
+// Configures sensor pins GPA0-7 then GPB0-7 (SENSOR_PIN_MASK) as inputs
+// with interrupt enabled on both ports.
 // Returns true if device responds on I2C.
 bool mcp23017_init();
 
@@ -16,9 +17,17 @@ uint8_t mcp23017_read_reg(uint8_t reg);
 // Returns true on success, false on I2C error.
 bool mcp23017_write_reg(uint8_t reg, uint8_t value);
 
-// Read INTCAPA to find which pins triggered the interrupt and clear it.
-// Returns bitmask of pins that changed.
-uint8_t mcp23017_read_interrupt();
+// Read len consecutive registers starting at reg in one I2C transaction.
+// Returns false on I2C error.
+bool mcp23017_read_regs(uint8_t reg, uint8_t* buf, uint8_t len);
 
-// Read current state of port A (sensor pins).
-uint8_t mcp23017_read_sensors();
+// Read INTFA/INTFB/INTCAPA/INTCAPB/GPIOA/GPIOB in one sequential burst and
+// clear the interrupt. Bit n = sensor n (port A low byte, port B high byte).
+//   flags:    pins that caused the interrupt
+//   captured: pin levels latched at interrupt time
+//   current:  pin levels at the end of the burst
+// Returns false on I2C error (flags=0, captured=current=0xFFFF).
+bool mcp23017_read_interrupt(uint16_t& flags, uint16_t& captured, uint16_t& current);
+
+// Read current state of both ports (bit n = sensor n).
+uint16_t mcp23017_read_sensors();
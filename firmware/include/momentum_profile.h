@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include "sensor_array.h"
+
+// Momentum (CV3/CV4) profiling.
+// Two passes with zero settle time, timed against the speed command:
+//  - Acceleration: loco stopped just before end A, speed step set, the
+//    array records the pickup. A position/time fit gives the acceleration
+//    and, extrapolated back to zero speed, time from command to motion.
+//  - Deceleration: loco returns B→A at the same step (it needs run-up
+//    room beyond end B to reach speed); on the first sensor edge the
+//    throttle is stopped and the array records the coast-down.
+//    The fit gives the deceleration and the overrun time and distance
+//    (JMRI overRunTime).
+// Each profile reports the command-to-bridge-acknowledgement latency and
+// per-interval speed against time since the command.
+// CV3/CV4 are labels for the output; set them on the decoder beforehand.
+// Requires throttle acquired and the track in DCC programming mode.
+
+struct MomentumParams {
+    int step;                   // Speed step to accelerate to / decelerate from
+    int cv3;                    // Acceleration CV being profiled (-1 = not given)
+    int cv4;                    // Deceleration CV being profiled (-1 = not given)
+    unsigned long stopWaitMs;   // Wait after stopping for momentum to run out
+};
+
+// Defaults from config.h.
+MomentumParams momentum_default_params();
+
+// Parameters from a JSON object (step, cv3, cv4, stop_wait_ms).
+// Missing keys keep defaults.
+MomentumParams momentum_params_from_json(const char* json);
+
+// Start profiling. Ignored if already running or preconditions fail.
+void momentum_start(const MomentumParams& params);
+
+// Abort. Stops the loco, keeps a finished acceleration profile.
+void momentum_abort();
+
+// Non-blocking state machine. Call from loop().
+void momentum_process();
+
+// Feed a completed run from sensor_take_result(). Ignored unless a
+// profiling pass is in progress.
+void momentum_on_result(const RunResult& run);
+
+// True while profiling.
+bool momentum_is_running();
+
+// Build results JSON. Valid after profiling ends.
+String momentum_build_json();
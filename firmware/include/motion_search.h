@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Automated start-of-motion search.
+// Bisects the speed step range in each direction for the lowest step that
+// makes the loco move. Onset is detected on the ESP32, without waiting for
+// a full pass: the first sensor edge after arming, piezo vibration RMS
+// rising above the stopped baseline, or the load cell leaving its baseline.
+// Requires throttle acquired and the track in DCC programming mode.
+
+// Start a search over [low_step, high_step] (0 = defaults from config.h).
+void motion_search_start(int low_step, int high_step);
+
+// Abort a running search. Stops the loco, keeps any finished direction.
+void motion_search_abort();
+
+// Non-blocking state machine. Call from loop().
+void motion_search_process();
+
+// True if a search is currently running.
+bool motion_search_is_running();
+
+// Build results JSON (both thresholds). Valid after the search ends.
+String motion_search_build_json();
@@ -27,6 +27,9 @@ void mqtt_configure(const String& broker, const String& prefix, const String& na
 // Publish a speed measurement result (JSON) to {prefix}/speed-cal/{name}/result
 void mqtt_publish_result(const String& json);
 
+// Publish one interval of a pass in progress (JSON) to {prefix}/speed-cal/{name}/interval
+void mqtt_publish_interval(const String& json);
+
 // Publish status (JSON) to {prefix}/speed-cal/{name}/status
 void mqtt_publish_status(const String& json);
 
@@ -39,12 +42,27 @@ void mqtt_publish_load(const String& json);
 // Publish vibration analysis (JSON) to {prefix}/speed-cal/{name}/vibration
 void mqtt_publish_vibration(const String& json);
 
+// Publish order tracking result (JSON) to {prefix}/speed-cal/{name}/order
+void mqtt_publish_order(const String& json);
+
 // Publish audio analysis (JSON) to {prefix}/speed-cal/{name}/audio
 void mqtt_publish_audio(const String& json);
 
 // Publish pull test results (JSON) to {prefix}/speed-cal/{name}/pull_test
 void mqtt_publish_pull_test(const String& json);
 
+// Publish one completed sweep step (JSON) to {prefix}/speed-cal/{name}/sweep_step
+void mqtt_publish_sweep_step(const String& json);
+
+// Publish sweep summary (JSON) to {prefix}/speed-cal/{name}/sweep
+void mqtt_publish_sweep(const String& json);
+
+// Publish the interpolated speed table (JSON) to {prefix}/speed-cal/{name}/speed_table
+void mqtt_publish_speed_table(const String& json);
+
+// Publish start-of-motion thresholds (JSON) to {prefix}/speed-cal/{name}/motion_search
+void mqtt_publish_motion_search(const String& json);
+
 // Publish track switch mode (JSON) to {prefix}/speed-cal/{name}/track_mode
 void mqtt_publish_track_mode(const String& json);
 
@@ -62,3 +80,12 @@ int mqtt_get_throttle_address();
 float mqtt_get_throttle_speed();
 bool mqtt_get_throttle_is_forward();
 String mqtt_get_throttle_status();
+
+// Timebase times (timebase_now_us()) of the last speed/stop command sent to
+// the bridge and of its last SPEED/STOPPED acknowledgement. The ack time is
+// taken when loop() processes it, so includes MQTT and loop latency.
+uint64_t mqtt_get_speed_command_us();
+uint64_t mqtt_get_speed_ack_us();
+
+// Publish a momentum profile (JSON) to {prefix}/speed-cal/{name}/momentum
+void mqtt_publish_momentum(const String& json);
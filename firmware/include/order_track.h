@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+// Speed-synchronous order tracking for vibration captures.
+//
+// Mechanism faults repeat once per wheel (or motor) revolution, so a
+// capture taken during a pass is resampled from time to wheel angle using
+// the pass's speed fit: wheel travel x(t) = v t + a/2 t^2 with t measured
+// from the fit's reference time, revolutions = x / (pi * wheel diameter).
+// Each output sample is the mean of the input samples over 1/perRev of a
+// revolution (boxcar anti-aliasing). Over a whole number of revolutions
+// an order lands exactly on a DFT bin, so the 1x, 2x and gear-mesh levels
+// are comparable across speed steps and locos.
+//
+// A pass can take many seconds at crawl speed, so the capture is not kept
+// at the full sample rate: it is boxcar-decimated into a fixed buffer as
+// it is drained, and resampled once the speed fit arrives.
+//
+// Pure computation, no allocation; unit-tested natively.
+
+struct OrderResult {
+    bool valid;
+    float revHz;            // Wheel revolutions per second at the capture midpoint
+    int revs;               // Whole revolutions analysed
+    int samplesPerRev;
+    float totalRms;         // RMS of the resampled signal, ADC counts
+    float amp1x;            // Amplitude at 1x, 2x and the mesh order, ADC counts
+    float amp2x;
+    float ampMesh;          // 0 if no mesh order configured
+    float frac1x;           // Share of the total energy at each order (0..1)
+    float frac2x;
+    float fracMesh;
+};
+
+// Progressive boxcar decimator for a pass-length capture. Input samples
+// are averaged in groups of `factor`; each time the buffer fills, its
+// samples are averaged in pairs and the factor doubles, so the whole pass
+// fits at the highest rate the buffer allows. Output sample i is the mean
+// of input samples [i * factor, (i + 1) * factor).
+struct OrderDecimator {
+    uint16_t* buf;
+    int capacity;           // Even
+    int count;
+    int factor;
+    uint32_t sum;           // Input samples of the output sample in progress
+    int sumCount;
+};
+
+void order_decim_reset(OrderDecimator& d, uint16_t* buf, int capacity, int factor);
+
+// Fold in n input samples.
+void order_decim_add(OrderDecimator& d, const uint16_t* samples, int n);
+
+// Output rate for input at inputHz, and the time of output sample 0 after
+// input sample 0 (the centre of its boxcar).
+float order_decim_rate_hz(const OrderDecimator& d, float inputHz);
+float order_decim_offset_s(const OrderDecimator& d, float inputHz);
+
+// Wheel revolutions travelled by time tS (seconds from the reference time).
+float order_track_revs(float tS, float velocityMmS, float accelMmS2, float wheelDiaMm);
+
+// Resample `count` samples taken at sampleHz, the first at t0S, to perRev
+// samples per wheel revolution starting at the first sample. Mean removed.
+// Writes whole revolutions only, at most maxOut samples; returns the
+// number written (0 if the capture covers less than one revolution, the
+// wheel is not moving forwards, or a revolution has fewer input samples
+// than perRev).
+int order_track_resample(const uint16_t* samples, int count, float sampleHz, float t0S,
+                         float velocityMmS, float accelMmS2, float wheelDiaMm,
+                         int perRev, float* out, int maxOut);
+
+// Amplitude of `order` (cycles per revolution) over n resampled samples,
+// n a whole number of revolutions.
+float order_track_amplitude(const float* x, int n, int perRev, int order);
+
+// Resample and measure 1x, 2x and meshOrder (0 = none; must be below
+// perRev / 2). scratch holds maxScratch floats. Returns out.valid.
+bool order_track_analyse(const uint16_t* samples, int count, float sampleHz, float t0S,
+                         float velocityMmS, float accelMmS2, float wheelDiaMm,
+                         int meshOrder, int perRev, float* scratch, int maxScratch,
+                         OrderResult& out);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// Robust aggregation of repeated speed measurements at one speed step.
+//
+// Every pass is kept (up to PASS_STATS_MAX). After each pass the median
+// and MAD of all passes decide which are inliers; wheel slip or a missed
+// sensor lands far from the median and is rejected. Mean and variance of
+// the inliers come from a Welford pass, and the step is converged once
+// the 95% confidence half-width of the mean is within the target.
+//
+// Pure computation, no allocation; unit-tested natively.
+
+struct PassStats {
+    float values[PASS_STATS_MAX];   // Every pass, in arrival order
+    bool inlier[PASS_STATS_MAX];    // Current inlier/outlier decision
+    int count;                      // Passes added
+    float lastCi95;                 // Per-pass CI of the latest pass (0 if unknown)
+
+    // Derived after each add
+    int inliers;
+    float median;
+    float mad;                      // Median absolute deviation (all passes)
+    float mean;                     // Welford mean of inliers
+    float variance;                 // Welford sample variance of inliers
+};
+
+// Clear all passes.
+void pass_stats_reset(PassStats& s);
+
+// Add one pass. ci95 is the pass's own 95% half-width (e.g. from the
+// position/time fit), used when only one pass is required; 0 if unknown.
+// Returns true if the pass is currently an inlier. Ignored when full.
+bool pass_stats_add(PassStats& s, float value, float ci95 = 0.0f);
+
+// Sample standard deviation of the inliers.
+float pass_stats_stddev(const PassStats& s);
+
+// 95% confidence half-width of the inlier mean (Student t).
+float pass_stats_ci95(const PassStats& s);
+
+// Number of passes rejected as outliers.
+int pass_stats_rejected(const PassStats& s);
+
+// True once at least minPasses inliers are in and the 95% half-width is
+// within relTarget of the mean (e.g. 0.02 = +/-2%). With minPasses = 1,
+// a single pass converges on its own ci95.
+bool pass_stats_converged(const PassStats& s, float relTarget, int minPasses);
@@ -0,0 +1,23 @@
+#pragma once
+
+// Helpers for the continuous ramp pull test.
+//
+// The throttle climbs one speed step at a time at a fixed rate while the
+// load cell, vibration and audio stream into bins step_inc steps wide
+// (the same rows as the stepped test: step_inc, 2*step_inc, ..., 126).
+// The ramp stops as soon as the binned pull has plateaued: the adhesion
+// limit (wheels slipping) or a stall.
+//
+// Pure computation, no allocation; unit-tested natively.
+
+// Bin (0-based) holding speed step `step` (1..126) for bins stepInc wide.
+int pull_ramp_bin(int step, int stepInc);
+
+// Row step of a bin: its top speed step (126 for the last, partial bin).
+int pull_ramp_bin_step(int bin, int stepInc);
+
+// True once the pull has plateaued: the largest bin is at least minPeak
+// and no bin in the `holdBins` since the last significant rise (more than
+// relTol of the peak so far) has improved on it.
+bool pull_ramp_plateau(const float* binGrams, int n, int holdBins, float relTol,
+                       float minPeak);
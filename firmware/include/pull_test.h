@@ -4,13 +4,27 @@
 
 // Automated drawbar pull test.
 // Ramps loco speed in steps, reads load cell at each step,
-// builds a pull-vs-speed table. Requires throttle acquired
+// builds a pull-vs-speed table. Each reading is the load cell window
+// (PULL_STATS_WINDOW_MS) ending at the reading: mean, median, stddev,
+// min/max and slope. Requires throttle acquired
 // and load cell ready before starting.
 
 // Start a pull test.
 // step_inc: speed step increment (e.g. 5 = steps 5,10,...125,126)
-// settle_ms: time to wait at each speed before reading load cell
-void pull_test_start(int step_inc, unsigned long settle_ms);
+// settle_ms: time to wait at each speed before reading load cell; with
+//   auto_settle, the most to wait
+// auto_settle: read as soon as the load has been steady for
+//   PULL_SETTLE_WINDOW_MS (slope and stddev under PULL_SETTLE_* limits)
+//   and has moved off the previous step's reading, or has stayed steady
+//   for two windows
+void pull_test_start(int step_inc, unsigned long settle_ms, bool auto_settle);
+
+// Start a continuous ramp pull test: the throttle climbs one step at a
+// time at steps_per_s (0 = PULL_RAMP_STEPS_PER_S) from step 1, the load
+// cell, vibration and audio stream into bins step_inc wide (same table
+// as the stepped test), and the ramp stops as soon as the pull plateaus
+// (adhesion limit or stall).
+void pull_test_start_ramp(int step_inc, float steps_per_s);
 
 // Abort a running test. Stops the loco, keeps partial results.
 void pull_test_abort();
@@ -31,7 +45,10 @@ int pull_test_total_steps();
 int pull_test_current_step_num();
 
 // Build complete results JSON. Valid after test completes or aborts.
-String pull_test_build_json();
+// includeEntries = false gives a summary small enough for one MQTT
+// message: the step and pull of each entry as compact arrays, without
+// the load, vibration and audio detail.
+String pull_test_build_json(bool includeEntries);
 
 // Build progress JSON for the current step.
 String pull_test_build_progress_json();
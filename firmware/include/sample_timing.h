@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+// Achieved rate and jitter of a sampled stream.
+//
+// Fed with each sample's timestamp (low 32 bits of timebase_now_us(), so
+// wrap-around is handled by unsigned subtraction). Tracks the mean and
+// standard deviation of the inter-sample interval (Welford), the longest
+// gap, and how many intervals overran the nominal period by more than
+// half a period (ticks the sampler could not keep up with).
+//
+// Pure computation, no allocation; unit-tested natively.
+
+struct SampleTiming {
+    uint32_t nominalUs;     // Intended sample period
+    uint32_t count;         // Samples added
+    uint32_t lastUs;
+    uint64_t spanUs;        // First to last sample
+    float meanIntervalUs;
+    float m2;               // Welford sum of squared interval deviations
+    uint32_t maxIntervalUs;
+    uint32_t late;          // Intervals > 1.5 x nominal
+};
+
+void sample_timing_reset(SampleTiming& t, uint32_t nominalUs);
+
+// Add the next sample's timestamp.
+void sample_timing_add(SampleTiming& t, uint32_t timestampUs);
+
+// Achieved sample rate over the span (0 if fewer than 2 samples).
+float sample_timing_rate_hz(const SampleTiming& t);
+
+// Standard deviation of the inter-sample interval (0 if fewer than 3 samples).
+float sample_timing_jitter_us(const SampleTiming& t);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// =============================================================================
+// Compile-time scale and sensor geometry.
+//
+// Each supported scale is a traits type; SpeedCalculator<Scale> (speed_calc.cpp)
+// is instantiated once per scale so conversion factors fold to constants.
+// The active scale is picked at runtime with speed_set_scale().
+// =============================================================================
+
+enum ScaleId : uint8_t {
+    SCALE_N = 0,
+    SCALE_HO,
+    SCALE_S,
+    SCALE_O,
+    SCALE_COUNT
+};
+
+template <ScaleId S> struct ScaleTraits;
+
+template <> struct ScaleTraits<SCALE_N> {
+    static constexpr float ratio() { return 160.0f; }
+    static constexpr const char* name() { return "N"; }
+};
+
+template <> struct ScaleTraits<SCALE_HO> {
+    static constexpr float ratio() { return HO_SCALE_FACTOR; }
+    static constexpr const char* name() { return "HO"; }
+};
+
+template <> struct ScaleTraits<SCALE_S> {
+    static constexpr float ratio() { return 64.0f; }
+    static constexpr const char* name() { return "S"; }
+};
+
+template <> struct ScaleTraits<SCALE_O> {
+    static constexpr float ratio() { return 48.0f; }
+    static constexpr const char* name() { return "O"; }
+};
+
+// Model mm/s → prototype mph for a scale ratio.
+constexpr float scale_mms_to_mph(float ratio) {
+    return ratio * 3600.0f / (1000000.0f * 1.609344f);
+}
+
+// --- Sensor geometry ---
+// Gap between sensor i and i+1. Uniform SENSOR_SPACING_MM unless the board
+// defines SENSOR_GAPS_MM as a brace list of NUM_SENSORS - 1 measured gaps.
+#ifdef SENSOR_GAPS_MM
+static constexpr float SENSOR_GAP_TABLE_MM[] = SENSOR_GAPS_MM;
+static_assert(sizeof(SENSOR_GAP_TABLE_MM) / sizeof(SENSOR_GAP_TABLE_MM[0]) == NUM_SENSORS - 1,
+              "SENSOR_GAPS_MM must list NUM_SENSORS - 1 gaps");
+constexpr float sensor_gap_mm(int i) { return SENSOR_GAP_TABLE_MM[i]; }
+#else
+constexpr float sensor_gap_mm(int) { return SENSOR_SPACING_MM; }
+#endif
+
+// Distance of sensor i from sensor 0.
+constexpr float sensor_position_mm(int i) {
+    return (i <= 0) ? 0.0f : sensor_position_mm(i - 1) + sensor_gap_mm(i - 1);
+}
+
+static_assert(sensor_position_mm(NUM_SENSORS - 1) > 0.0f, "Sensor array has no length");
@@ -2,13 +2,14 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "timebase.h"
 
 // Run states
 enum RunState {
     STATE_IDLE,       // Not armed, ignoring triggers
     STATE_ARMED,      // Waiting for first sensor trigger
     STATE_MEASURING,  // First sensor triggered, collecting timestamps
-    STATE_COMPLETE    // All sensors triggered (or timeout) — results ready
+    STATE_COMPLETE    // All sensors blocked and cleared (or timeout) — results ready
 };
 
 // Direction of travel
@@ -21,39 +22,103 @@ enum Direction {
 // Result of a single pass
 struct RunResult {
     int sensorsTriggered;
-    uint32_t timestamps[NUM_SENSORS];  // micros() at each trigger
+    uint64_t timestamps[NUM_SENSORS];  // timebase_now_us() at each trigger (block)
     bool triggered[NUM_SENSORS];       // Which sensors fired
     Direction direction;
-    uint32_t runStartMillis;           // millis() when first sensor fired
+    uint64_t runStartUs;               // timebase_now_us() when first sensor fired
     uint32_t runDurationUs;            // Total time from first to last trigger
+
+    // Trailing edges: when each sensor cleared after the loco passed
+    int sensorsCleared;                     // Triggered sensors that also cleared
+    uint64_t clearTimestamps[NUM_SENSORS];  // timebase_now_us() of the final clear
+    bool cleared[NUM_SENSORS];              // Which sensors cleared
+    uint32_t dwellUs[NUM_SENSORS];          // Block-to-clear time (0 if not cleared)
+
+    uint32_t sequence;                 // Completed-run counter since boot (1, 2, ...)
+    bool earlyTerminated;              // Ended by the interval-agreement policy,
+                                       // before the loco crossed the whole array
 };
 
-// ISR-callable: record that an interrupt occurred and capture timestamp.
+// One adjacent sensor pair crossed while a run is in progress. Queued by the
+// sensor task as soon as the second leading edge arrives, so consumers get
+// a speed within one sensor spacing instead of at the end of the pass.
+struct IntervalEvent {
+    uint32_t sequence;      // RunResult::sequence the run will complete with
+    Direction direction;
+    uint8_t index;          // Interval position in direction of travel (0 = first pair)
+    uint8_t fromSensor;     // Physical sensor indices
+    uint8_t toSensor;
+    uint32_t intervalUs;    // Leading edge to leading edge
+    float gapMm;            // Distance between the two sensors
+    uint64_t timestampUs;   // timebase_now_us() of the second edge
+};
+
+// ISR-callable: queue a timestamped interrupt event and wake the sensor task.
 // Called from the GPIO ISR attached to MCP23017_INT_PIN.
 void IRAM_ATTR sensor_isr();
 
 // Initialize sensor array state. Call once in setup().
 void sensor_init();
 
+// Start the high-priority sensor task. It waits for ISR task notifications,
+// reads INTCAP and runs the detection state machine (settle guard, re-trigger
+// guard, direction, timeout), independent of how long loop() takes.
+// The timeout is per interval: once a speed has been measured, a run ends
+// when the next sensor is overdue (see speed_next_edge_timeout_us()).
+// Call once in setup() after sensor_init(), before attaching the interrupt.
+void sensor_start_task();
+
 // Arm the sensor array to detect the next pass.
 void sensor_arm();
 
-// Disarm / cancel a run in progress.
+// Disarm / cancel a run in progress. Also leaves streaming mode.
 void sensor_disarm();
 
+// Streaming mode: the sensor task re-arms itself as soon as a run completes,
+// so back-to-back passes need no host round trip. Every completed run is
+// still queued for sensor_take_result(); gaps in RunResult::sequence show
+// runs lost to a full queue. Enabling arms immediately if not already armed.
+void sensor_set_streaming(bool enabled);
+bool sensor_is_streaming();
+
+// Early termination: complete a run as soon as the latest `intervals`
+// leading-edge intervals agree within +/- tolerance (fraction) of their mean,
+// instead of waiting for the whole array. The run is flagged earlyTerminated
+// and an exit is raised so a shuttle can reverse straight away.
+// intervals = 0 disables (the default, EARLY_STOP_INTERVALS).
+void sensor_set_early_stop(int intervals, float tolerance);
+int sensor_get_early_stop_intervals();
+float sensor_get_early_stop_tolerance();
+
 // Get current state.
 RunState sensor_get_state();
 
-// Call from loop(). Handles:
-// - Reading MCP23017 after ISR fires to identify which sensor triggered
-// - Timeout detection
-// - Transition to STATE_COMPLETE when all sensors have fired
-// Returns true if state just transitioned to STATE_COMPLETE.
-bool sensor_update();
+// Call from loop(). Pops the next completed run queued by the sensor task.
+// Returns true if a result was copied into out.
+bool sensor_take_result(RunResult& out);
+
+// Call from loop(). True once per run when the loco clears the last sensor in
+// its direction of travel (sensor N-1 for A→B, sensor 0 for B→A), i.e. it
+// has left the array, or when the run is early-terminated. Raised before the
+// run's result is queued.
+bool sensor_take_exit(Direction& dir);
+
+// Call from loop(). Pops the next interval event of the run in progress.
+// Events that find the queue full are dropped (the completed result still
+// carries every interval).
+bool sensor_take_interval(IntervalEvent& out);
+
+// Snapshot of the run in progress (or the last completed run).
+RunResult sensor_get_result();
+
+// ISR events dropped because the event ring was full (since boot).
+uint32_t sensor_get_event_overflows();
+
+// Deepest the ISR event ring has been (since boot).
+uint32_t sensor_get_event_high_water();
 
-// Get the result of the last completed run.
-// Only valid when state == STATE_COMPLETE.
-const RunResult& sensor_get_result();
+// Completed runs dropped because loop() left the result queue full (since boot).
+uint32_t sensor_get_results_dropped();
 
 // Get a human-readable state name.
 const char* sensor_state_name(RunState state);
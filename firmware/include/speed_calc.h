@@ -3,6 +3,26 @@
 #include <Arduino.h>
 #include "config.h"
 #include "sensor_array.h"
+#include "scale.h"
+
+// Least-squares fit of sensor position against leading-edge time:
+//   x(t) = x0 + v (t - tMean) + a/2 (t - tMean)^2
+// Velocity is evaluated at the mean crossing time, so it is the pass speed
+// even when intervals are missing. With 4+ points the quadratic term gives
+// acceleration; with 2-3 points a straight line is fitted (accel = 0).
+struct SpeedFit {
+    bool valid;                // At least 2 usable points
+    int points;                // Sensors used in the fit
+    bool quadratic;            // Acceleration term fitted
+    float velocityMmS;         // Model-scale mm/s at mean crossing time
+    float accelMmS2;           // Model-scale mm/s^2 (positive = speeding up)
+    float residualRmsMm;       // RMS of position residuals
+    float velocityCi95MmS;     // 95% CI half-width on velocity (0 if no residual dof)
+    float scaleSpeedMph;       // velocityMmS as prototype mph
+    float scaleCi95Mph;        // velocityCi95MmS as prototype mph
+    uint64_t firstEdgeUs;      // Timebase time of the first edge in the fit
+    float meanTimeS;           // Mean crossing time, seconds after firstEdgeUs
+};
 
 // Computed speed data from a completed run
 struct SpeedResult {
@@ -11,12 +31,69 @@ struct SpeedResult {
     float scaleSpeedsMph[NUM_SENSORS];      // Prototype mph per interval
     float avgScaleSpeedMph;                 // Mean prototype speed
     uint32_t intervalsUs[NUM_SENSORS];      // Time between adjacent sensors
+
+    // Second, independent estimate from trailing (clear) edges
+    int trailingIntervalCount;
+    float trailingSpeedsMmS[NUM_SENSORS];
+    float trailingScaleSpeedsMph[NUM_SENSORS];
+    uint32_t trailingIntervalsUs[NUM_SENSORS];
+    float trailingAvgScaleSpeedMph;
+
+    float combinedAvgScaleSpeedMph;         // Mean over leading + trailing intervals
+    float locoLengthMm;                     // Mean speed x dwell (0 if no dwell data)
+
+    SpeedFit fit;                           // Regression over all leading edges
 };
 
-// Compute speeds from a completed run result.
-// Timestamps are reordered by direction of travel.
+// Compute speeds from a completed run result, using the active scale.
+// Timestamps are reordered by direction of travel. Leading (block) and
+// trailing (clear) edges give two independent sets of intervals; dwell
+// times give the measured loco length.
+// The fit regresses position on time over every triggered sensor.
 // Returns true if at least one valid interval was computed.
 bool speed_calculate(const RunResult& run, SpeedResult& out);
 
+// Early-termination policy: true if the latest `count` leading-edge
+// intervals (in direction of travel, gaps skipped) all lie within
+// +/- tolerance (fraction) of their mean speed. Needs a known direction.
+// Scale-independent; safe to call on a run in progress.
+bool speed_intervals_agree(const RunResult& run, int count, float tolerance);
+
+// Adaptive per-interval timeout for a run in progress: how long after the
+// latest leading edge the next sensor may take, from the most recent
+// measured speed and the gap to the next sensor:
+//   max(EDGE_TIMEOUT_MIN_MS, EDGE_TIMEOUT_FACTOR * gap / speed)
+// Returns 0 if no speed is known yet (fewer than two edges, or direction
+// unknown) and UINT32_MAX if the far-end sensor has already blocked.
+uint32_t speed_next_edge_timeout_us(const RunResult& run);
+
+// Model-scale mm/s to prototype mph at the active scale.
+float speed_mms_to_mph(float mmS);
+
+// Fit position against time for one set of edge timestamps (sensors in
+// physical order, reordered by direction). Allocation-free, sized by
+// NUM_SENSORS. Returns out.valid.
+bool speed_fit(const uint64_t* timestamps, const bool* valid, Direction direction,
+               SpeedFit& out);
+
+// Time at which the fitted velocity is zero, v(t) = v + a (t - tMean):
+// when an accelerating loco started moving, or when a decelerating one
+// will stop. Assumes constant acceleration outside the array too.
+// Returns false unless the fit is quadratic with an acceleration that
+// reaches zero speed within DETECTION_TIMEOUT_MS of the mean crossing.
+bool speed_fit_zero_velocity_us(const SpeedFit& fit, uint64_t& outUs);
+
 // Print a speed result to Serial in human-readable format.
 void speed_print_result(const RunResult& run, const SpeedResult& speed);
+
+// Select the scale used for mph conversion. Each scale is a separate
+// compile-time instantiation; this only picks which one runs.
+void speed_set_scale(ScaleId scale);
+ScaleId speed_get_scale();
+
+// Scale name ("N", "HO", "S", "O") and ratio (e.g. 87.1 for HO).
+const char* speed_scale_name(ScaleId scale);
+float speed_scale_ratio(ScaleId scale);
+
+// Parse a scale name (case-insensitive). Returns false if unknown.
+bool speed_scale_from_name(const char* name, ScaleId& out);
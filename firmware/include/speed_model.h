@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+// Speed-vs-step model for sparse calibration sweeps.
+//
+// Decoder speed curves are smooth and monotone, so a handful of measured
+// steps (knots) plus a monotone piecewise-cubic (PCHIP, Fritsch-Carlson)
+// interpolant reproduces the full 126-step table. The planner picks the
+// initial knots, then asks for more only where the model is poor: new
+// steps between a stationary and a moving knot (start of motion not yet
+// located) and around knots whose leave-one-out residual is outside
+// tolerance, and extra passes at knots whose own confidence is poor.
+//
+// Pure computation, no allocation; unit-tested natively.
+
+// One measured step.
+struct SpeedKnot {
+    int step;
+    float mph;          // Measured speed (0 if the loco did not move)
+    float ci95;         // 95% half-width of mph (0 if unknown)
+    bool moving;        // At least one valid pass
+};
+
+// One row of the interpolated table.
+struct SpeedTableEntry {
+    float mph;
+    float ci95;         // Measured CI, or estimated interpolation uncertainty
+    bool measured;      // Step was a knot
+};
+
+// --- PCHIP ---
+
+// Fritsch-Carlson slopes for knots (x strictly increasing, n >= 2).
+// Slopes are zero where the data is flat or changes direction, so the
+// interpolant never overshoots.
+void pchip_slopes(const float* x, const float* y, int n, float* d);
+
+// Evaluate the PCHIP interpolant at xq. Outside [x0, xn-1] the end
+// segment's cubic is extended linearly with the end slope.
+float pchip_eval(const float* x, const float* y, const float* d, int n, float xq);
+
+// --- Planner ---
+
+// Spread `count` steps evenly over [minStep, maxStep], ends included.
+// Returns the number written to out (at most count, no duplicates).
+int speed_model_initial_steps(int minStep, int maxStep, int count, int* out);
+
+// Leave-one-out residual of moving knot k: model built without it,
+// evaluated at its step, minus its measured speed. 0 for the first and
+// last moving knots (would be extrapolation) or if too few knots.
+// Knots must be sorted by step.
+float speed_model_loo_residual(const SpeedKnot* knots, int n, int k);
+
+// Steps to measure next: the midpoint of each gap (wider than one step)
+// that brackets the start of motion, or where an end knot's leave-one-out
+// residual, less the noise its own and its neighbours' CIs explain, is
+// above relTol of its speed. Knots must be sorted by step.
+// Returns the number written to out (at most maxOut).
+int speed_model_refine_steps(const SpeedKnot* knots, int n, float relTol,
+                             int* out, int maxOut);
+
+// Knots to re-measure with extra passes: moving knots whose CI is above
+// relTol of their speed. Returns the number written to out (at most maxOut).
+int speed_model_remeasure_steps(const SpeedKnot* knots, int n, float relTol,
+                                int* out, int maxOut);
+
+// Fill table[0 .. maxStep-minStep] from the knots (sorted by step). Steps
+// at or below the highest stationary knot under the first moving knot are
+// 0 mph. Interpolated CI is the bracketing knots' CI blended linearly,
+// plus their larger leave-one-out residual weighted by 4t(1-t) (largest
+// mid-gap). Returns false if there is no moving knot.
+bool speed_model_table(const SpeedKnot* knots, int n, int minStep, int maxStep,
+                       SpeedTableEntry* table);
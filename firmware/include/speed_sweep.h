@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Arduino.h>
+#include "sensor_array.h"
+
+// Automated speed calibration sweep.
+// Steps the throttle through a range of DCC speed steps, arms the sensors
+// for one or more shuttle passes at each step and aggregates the measured
+// speeds on the ESP32. Each finished step is streamed as it completes, so
+// the host only starts the sweep and collects results.
+// Requires throttle acquired and the track in DCC programming mode.
+
+struct SweepParams {
+    int minStep;                // First speed step (1-126)
+    int maxStep;                // Last speed step (1-126)
+    int stepInc;                // Step increment
+    unsigned long settleMs;     // Wait after each speed change before arming
+    int passes;                 // Passes per step (maximum when targetPct is set)
+    int lowPasses;              // Passes for the first lowRange steps above minStep
+    int lowRange;               // Steps above minStep that use lowPasses (0 = off)
+    unsigned long timeoutMs;    // Max wait for a pass before recording no detection
+    bool shuttle;               // Reverse at each end-of-array exit instead of
+                                // stopping, settling and re-arming per pass
+    float targetPct;            // End a step early once the 95% CI of its mean
+                                // is within +/- this percent (0 = fixed passes)
+    int minPasses;              // Inlier passes required before targetPct applies
+    int earlyStop;              // Early-terminate passes once this many intervals
+                                // agree (0 = keep the sensor array's setting)
+    float earlyTolPct;          // Agreement tolerance for earlyStop, percent
+    bool sparse;                // Measure `knots` steps, then refine where the
+                                // PCHIP model is poor (stepInc is ignored)
+    int knots;                  // Initial steps for a sparse sweep
+    float refineTolPct;         // Refine around knots whose leave-one-out
+                                // residual or CI exceeds this percent
+};
+
+// Defaults matching calibrate_speed.py.
+SweepParams speed_sweep_default_params();
+
+// Parameters from a JSON object (min_step, max_step, step_inc, settle_ms,
+// passes, low_passes, low_range, timeout_ms, shuttle, target_pct, min_passes,
+// early_stop, early_tol_pct, sparse, knots, refine_tol_pct).
+// Missing keys keep defaults.
+SweepParams speed_sweep_params_from_json(const char* json);
+
+// Start a sweep. Ignored if one is already running or preconditions fail.
+void speed_sweep_start(const SweepParams& params);
+
+// Abort a running sweep. Stops the loco, keeps completed steps.
+void speed_sweep_abort();
+
+// Non-blocking state machine. Call from loop().
+void speed_sweep_process();
+
+// Feed an exit event from sensor_take_exit(). In shuttle mode this stops
+// and reverses the loco straight away; the return pass is the next sample.
+void speed_sweep_on_exit(Direction dir);
+
+// Feed a completed run from sensor_take_result(). Ignored unless the sweep
+// is waiting for a pass.
+void speed_sweep_on_result(const RunResult& run);
+
+// True if a sweep is currently running.
+bool speed_sweep_is_running();
+
+// Current speed step (0 if not running).
+int speed_sweep_current_step();
+
+// Total number of steps in the sweep. Grows during a sparse sweep as
+// refinement adds steps.
+int speed_sweep_total_steps();
+
+// Number of steps finished so far, sparse re-measures included. Changes
+// once per step.
+int speed_sweep_completed_steps();
+
+// JSON for the most recently completed step.
+String speed_sweep_build_step_json();
+
+// JSON for the full minStep..maxStep table: measured steps plus PCHIP
+// interpolation between them, each with a 95% half-width. Compact arrays,
+// small enough for one MQTT message at 126 steps. Empty if nothing moved.
+String speed_sweep_build_table_json();
+
+// JSON for the whole sweep. includeEntries = false gives a summary small
+// enough for one MQTT message; the per-step detail was already streamed.
+String speed_sweep_build_json(bool includeEntries);
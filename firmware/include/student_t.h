@@ -0,0 +1,14 @@
+#pragma once
+
+// Two-sided Student t critical value for 95% confidence at the given
+// degrees of freedom. Beyond the table the normal value is used.
+// Shared by the speed fit (speed_calc) and pass aggregation (pass_stats).
+static inline float student_t95(int dof) {
+    static const float T95[] = {
+        12.706f, 4.303f, 3.182f, 2.776f, 2.571f, 2.447f, 2.365f, 2.306f, 2.262f, 2.228f,
+        2.201f, 2.179f, 2.160f, 2.145f, 2.131f, 2.120f, 2.110f, 2.101f, 2.093f, 2.086f,
+    };
+    if (dof <= 0) return 0;
+    if (dof <= (int)(sizeof(T95) / sizeof(T95[0]))) return T95[dof - 1];
+    return 1.960f;
+}
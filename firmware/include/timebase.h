@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Monotonic 64-bit microsecond timebase shared by every module.
+//
+// micros()/millis() are 32-bit and wrap (micros() after ~71 minutes), so
+// timestamps from different modules cannot be compared over a long session.
+// esp_timer counts microseconds since boot in 64 bits (no practical wrap),
+// is the same clock on both cores, and is safe to read from an ISR.
+//
+// Use this for any event time that may be correlated across modules:
+// sensor crossings, vibration/audio capture windows, load cell samples.
+static inline uint64_t timebase_now_us() {
+    return (uint64_t)esp_timer_get_time();
+}
+
+// Convenience: milliseconds on the same timebase.
+static inline uint64_t timebase_now_ms() {
+    return timebase_now_us() / 1000ULL;
+}
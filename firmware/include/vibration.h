@@ -2,16 +2,29 @@
 
 #include <Arduino.h>
 
-// Initialize piezo ADC pin. Call once in setup().
+// Piezo vibration capture on ADC1_CH0.
+// A hardware timer wakes a sampler task at VIBRATION_SAMPLE_HZ; the task
+// reads the ADC into a double buffer that loop() drains, so the rate does
+// not depend on how busy loop() is. Peak-to-peak, RMS, crest factor and
+// an amplitude histogram are accumulated in a single pass, so captures of
+// any length cost constant memory; only the first VIBRATION_MAX_SAMPLES
+// samples are buffered, for the spectrum. Each result reports the achieved rate
+// and inter-sample jitter, and a Welch-averaged Q15 FFT of the capture
+// gives the dominant peaks, band levels, spectral centroid and a compact
+// per-band spectrum.
+
+// Initialize piezo ADC pin, sampler task and timer. Call once in setup().
 void vibration_init();
 
-// Start a timed capture window. Samples will be collected in process().
-void vibration_start_capture();
+// Start a capture window of ms (clamped to 10ms .. VIBRATION_MAX_CAPTURE_MS).
+// Samples will be collected in process(). Test modes use
+// VIBRATION_CAPTURE_MS; only manual captures take a user length.
+void vibration_start_capture(unsigned long ms);
 
 // True if a capture is currently in progress.
 bool vibration_is_capturing();
 
-// Non-blocking sample collection. Call from loop().
+// Drain sampled blocks and finish the capture. Non-blocking. Call from loop().
 void vibration_process();
 
 // True if results are available from a completed capture.
@@ -24,6 +37,61 @@ String vibration_build_json();
 uint16_t vibration_get_peak_to_peak();
 float vibration_get_rms();
 
+// Capture window of the last result on the shared timebase (timebase_now_us()).
+uint64_t vibration_get_start_us();
+uint64_t vibration_get_end_us();
+
+// Achieved sample rate and inter-sample jitter (stddev) of the last result.
+float vibration_get_rate_hz();
+float vibration_get_jitter_us();
+
+// Spectrum of the last result: strongest peak, power-weighted centroid.
+// 0 (and an all-zero compact spectrum) if blocks were dropped.
+float vibration_get_peak_hz();
+float vibration_get_centroid_hz();
+
+// Compact spectrum: VIBRATION_SPECTRUM_BANDS equal bands up to Nyquist,
+// dB re 1 ADC count^2 (0 = at or below one count). out must hold
+// VIBRATION_SPECTRUM_BANDS bytes.
+void vibration_get_spectrum_db(uint8_t* out);
+float vibration_get_spectrum_band_hz();
+
+// Time `runs` windowed 1024-point FFTs on the last capture (or a synthetic
+// tone). Returns microseconds per FFT. Blocks loop() while running.
+uint32_t vibration_fft_benchmark(int runs);
+
+// --- Order tracking ---
+// With a wheel diameter set, main starts a capture on the first sensor
+// edge of each pass and ends it with the pass. The whole capture is kept
+// decimated (ORDER_DECIM_*); once it is done it is resampled to wheel
+// revolutions with the pass's speed fit (see order_track.h).
+
+// Model wheel diameter in mm (0 = off) and gear-mesh order (0 = none).
+void vibration_set_order_tracking(float wheelDiaMm, int meshOrder);
+bool vibration_order_tracking_enabled();
+float vibration_get_wheel_dia_mm();
+int vibration_get_mesh_order();
+
+// Start a pass capture (up to ORDER_MAX_CAPTURE_MS), unless order
+// tracking is off or another capture is in progress.
+void vibration_order_begin_pass();
+
+// End the pass capture early; its result follows from vibration_process().
+// No effect on other captures.
+void vibration_order_end_pass();
+
+// A pass completed: speed fit x(t) = v (t - refUs) + a/2 (t - refUs)^2.
+// Analysed against the capture that started after runStartUs.
+void vibration_order_on_pass(uint32_t sequence, uint64_t runStartUs, uint64_t refUs,
+                             float velocityMmS, float accelMmS2);
+
+// True once, when the pending pass has been analysed (result may be
+// invalid if the capture is under one revolution). Call from loop().
+bool vibration_order_take_result();
+
+// Build JSON string with the last order tracking result.
+String vibration_build_order_json();
+
 // --- Analysis functions (exposed for unit testing) ---
 
 // Compute peak-to-peak from a sample buffer.
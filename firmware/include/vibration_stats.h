@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// Single-pass statistics of a piezo capture.
+//
+// Samples are folded in as they are drained, so a capture of any length
+// costs the same few bytes (like the audio capture's running sums).
+// Sums are kept exactly in integers, relative to a bias near the piezo's
+// DC level (the previous capture's mean), which keeps the variance free
+// of cancellation. The histogram counts |sample - bias| in octave bins:
+// bin 0 holds 0, bin k holds 2^(k-1) .. 2^k - 1.
+//
+// Pure computation, no allocation; unit-tested natively.
+
+struct VibrationAccumulator {
+    uint16_t bias;          // Reference level the sums are taken against
+    uint32_t count;
+    int64_t sum;            // Sum of (sample - bias)
+    uint64_t sumSq;         // Sum of (sample - bias)^2
+    uint16_t minVal;
+    uint16_t maxVal;
+    uint32_t histogram[VIBRATION_HIST_BINS];
+};
+
+void vibration_acc_reset(VibrationAccumulator& a, uint16_t bias);
+
+// Fold in n samples.
+void vibration_acc_add(VibrationAccumulator& a, const uint16_t* samples, int n);
+
+// Mean level in ADC counts (bias if empty).
+float vibration_acc_mean(const VibrationAccumulator& a);
+
+// RMS about the mean (AC component), ADC counts. 0 if empty.
+float vibration_acc_rms(const VibrationAccumulator& a);
+
+// Largest minus smallest sample. 0 if empty.
+uint16_t vibration_acc_peak_to_peak(const VibrationAccumulator& a);
+
+// Largest excursion from the mean over the RMS (0 if the RMS is 0).
+// About 1.41 for a sine; impacts and rattles push it up.
+float vibration_acc_crest(const VibrationAccumulator& a);
@@ -1,13 +1,17 @@
 #pragma once
 
 #include <Arduino.h>
+#include "sensor_array.h"
 
 // Initialize the async web server and WebSocket.
 void web_init();
 
 // Send a run result to all connected WebSocket clients as JSON.
 // Call this when a measurement completes.
-void web_send_result();
+void web_send_result(const RunResult& run);
+
+// Send one interval of a pass in progress to WebSocket clients and MQTT.
+void web_send_interval(const IntervalEvent& ev);
 
 // Send current status to all connected WebSocket clients.
 void web_send_status();
@@ -18,6 +22,9 @@ void web_send_load();
 // Send vibration analysis to WebSocket clients and MQTT.
 void web_send_vibration();
 
+// Send order tracking result to WebSocket clients and MQTT.
+void web_send_order();
+
 // Send audio analysis to WebSocket clients and MQTT.
 void web_send_audio();
 
@@ -30,5 +37,17 @@ void web_send_pull_test();
 // Send pull test progress to WebSocket clients.
 void web_send_pull_progress();
 
+// Send the most recently completed sweep step to WebSocket clients and MQTT.
+void web_send_sweep_step();
+
+// Send sweep results (full table over WebSocket, summary over MQTT).
+void web_send_sweep();
+
+// Send start-of-motion search results to WebSocket clients and MQTT.
+void web_send_motion_search();
+
+// Send a momentum (acceleration/deceleration) profile to WebSocket clients and MQTT.
+void web_send_momentum();
+
 // Send track switch mode to WebSocket clients and MQTT.
 void web_send_track_mode();
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// Summary statistics over a window of timestamped samples.
+//
+// Used on the load cell history: a pull reading is the whole last few
+// seconds of samples rather than one EMA value, so noise averages out and
+// the slope shows whether the reading had settled.
+//
+// Pure computation, no allocation; unit-tested natively.
+
+struct WindowStats {
+    int count;
+    float mean;
+    float median;
+    float stddev;       // Sample standard deviation (0 if count < 2)
+    float min;
+    float max;
+    float slopePerS;    // Least-squares slope against time, units per second
+    float spanS;        // First to last sample
+};
+
+// True if the window is steady: |slope| and stddev within their limits,
+// the stddev limit widened to relTol * |mean| when that is larger. The
+// slope limit stays absolute: a heavy pull still climbing is not settled.
+bool window_stats_steady(const WindowStats& s, float maxSlopePerS, float maxStddev,
+                         float relTol);
+
+// Statistics of values[i] taken at timesUs[i] (ascending), n <= WINDOW_STATS_MAX.
+// Returns false (out zeroed) if n < 1.
+bool window_stats_compute(const float* values, const uint64_t* timesUs, int n,
+                          WindowStats& out);
@@ -1,5 +1,6 @@
 #include "audio_capture.h"
 #include "config.h"
+#include "timebase.h"
 
 #include <driver/i2s.h>
 #include <ArduinoJson.h>
@@ -8,7 +9,7 @@
 static bool i2sInitialized = false;
 static bool capturing = false;
 static bool hasResult = false;
-static unsigned long captureStartMs = 0;
+static uint64_t captureStartUs = 0;
 static unsigned long captureDurationMs = AUDIO_CAPTURE_MS;
 
 // Running accumulators (avoid storing all samples)
@@ -21,6 +22,8 @@ static float resultRmsDb = -100.0f;
 static float resultPeakDb = -100.0f;
 static int32_t resultSamples = 0;
 static unsigned long resultDurationMs = 0;
+static uint64_t resultStartUs = 0;  // Capture window on the shared timebase
+static uint64_t resultEndUs = 0;
 
 // Temporary DMA read buffer
 static int16_t dmaBuf[AUDIO_DMA_BUF_LEN];
@@ -103,7 +106,7 @@ void audio_start_capture() {
 
     capturing = true;
     hasResult = false;
-    captureStartMs = millis();
+    captureStartUs = timebase_now_us();
 
     Serial.println("Audio capture started...");
 }
@@ -115,14 +118,16 @@ bool audio_is_capturing() {
 void audio_process() {
     if (!capturing) return;
 
-    unsigned long now = millis();
+    uint64_t now = timebase_now_us();
 
     // Check if capture window has elapsed
-    if ((now - captureStartMs) >= captureDurationMs) {
+    if ((now - captureStartUs) >= captureDurationMs * 1000ULL) {
         capturing = false;
         hasResult = true;
         resultSamples = totalSamples;
-        resultDurationMs = now - captureStartMs;
+        resultDurationMs = (unsigned long)((now - captureStartUs) / 1000ULL);
+        resultStartUs = captureStartUs;
+        resultEndUs = now;
 
         // Compute final results from accumulators
         if (totalSamples > 0) {
@@ -170,6 +175,14 @@ float audio_get_peak_db() {
     return resultPeakDb;
 }
 
+uint64_t audio_get_start_us() {
+    return resultStartUs;
+}
+
+uint64_t audio_get_end_us() {
+    return resultEndUs;
+}
+
 String audio_build_json() {
     JsonDocument doc;
     doc["type"] = "audio";
@@ -177,6 +190,8 @@ String audio_build_json() {
     doc["peak_db"] = serialized(String(resultPeakDb, 1));
     doc["samples"] = resultSamples;
     doc["duration_ms"] = resultDurationMs;
+    doc["t_start_us"] = resultStartUs;
+    doc["t_end_us"] = resultEndUs;
 
     String json;
     serializeJson(doc, json);
@@ -0,0 +1,129 @@
+#include "fft.h"
+
+#include <math.h>
+
+// cos/sin(2*pi*k/FFT_MAX_SIZE) for k < FFT_MAX_SIZE/2, Q15
+static int16_t cosTable[FFT_MAX_SIZE / 2];
+static int16_t sinTable[FFT_MAX_SIZE / 2];
+static bool tablesReady = false;
+
+static void initTables() {
+    const double twoPi = 6.283185307179586;
+    for (int k = 0; k < FFT_MAX_SIZE / 2; k++) {
+        double a = twoPi * k / FFT_MAX_SIZE;
+        cosTable[k] = (int16_t)lround(cos(a) * 32767.0);
+        sinTable[k] = (int16_t)lround(sin(a) * 32767.0);
+    }
+    tablesReady = true;
+}
+
+void fft_q15(int16_t* re, int16_t* im, int log2n) {
+    if (log2n < 1 || log2n > FFT_MAX_LOG2) return;
+    if (!tablesReady) initTables();
+    int n = 1 << log2n;
+
+    // Bit-reversal permutation
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        while (j & bit) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+        if (i < j) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    // Butterflies, halving each stage
+    for (int len = 2; len <= n; len <<= 1) {
+        int half = len >> 1;
+        int stride = FFT_MAX_SIZE / len;
+        for (int i = 0; i < n; i += len) {
+            for (int j = 0; j < half; j++) {
+                int32_t wr = cosTable[j * stride];
+                int32_t wi = -sinTable[j * stride];   // e^{-i theta}
+                int a = i + j;
+                int b = a + half;
+                // Rounded, so the per-stage halving does not drift downwards
+                int32_t tr = (re[b] * wr - im[b] * wi + 0x4000) >> 15;
+                int32_t ti = (re[b] * wi + im[b] * wr + 0x4000) >> 15;
+                int32_t ar = re[a];
+                int32_t ai = im[a];
+                re[b] = (int16_t)((ar - tr + 1) >> 1);
+                im[b] = (int16_t)((ai - ti + 1) >> 1);
+                re[a] = (int16_t)((ar + tr + 1) >> 1);
+                im[a] = (int16_t)((ai + ti + 1) >> 1);
+            }
+        }
+    }
+}
+
+void fft_window_hann(int16_t* x, int n) {
+    if (n < 2) return;
+    if (!tablesReady) initTables();
+    // w[i] = 0.5 - 0.5 cos(2 pi i / n), cos from the table when n divides it
+    int stride = (n <= FFT_MAX_SIZE && FFT_MAX_SIZE % n == 0) ? FFT_MAX_SIZE / n : 0;
+    for (int i = 0; i < n; i++) {
+        int32_t c;
+        if (stride) {
+            int k = i * stride;   // 0 .. FFT_MAX_SIZE-1
+            c = (k < FFT_MAX_SIZE / 2) ? cosTable[k] : -cosTable[k - FFT_MAX_SIZE / 2];
+        } else {
+            c = (int32_t)lround(cos(6.283185307179586 * i / n) * 32767.0);
+        }
+        int32_t w = (32767 - c) >> 1;
+        x[i] = (int16_t)((x[i] * w) >> 15);
+    }
+}
+
+void fft_accumulate_power(const int16_t* re, const int16_t* im, int n, float* power) {
+    for (int k = 0; k <= n / 2; k++) {
+        power[k] += (float)re[k] * re[k] + (float)im[k] * im[k];
+    }
+}
+
+int spectrum_peaks(const float* mag, int bins, float binHz, float minMag,
+                   SpectrumPeak* out, int maxPeaks) {
+    int found = 0;
+    for (int k = 1; k < bins - 1; k++) {
+        if (mag[k] < minMag || mag[k] <= mag[k - 1] || mag[k] < mag[k + 1]) continue;
+
+        // Parabolic interpolation through the peak and its neighbours
+        float a = mag[k - 1], b = mag[k], c = mag[k + 1];
+        float denom = a - 2 * b + c;
+        float p = (denom != 0) ? 0.5f * (a - c) / denom : 0.0f;
+        SpectrumPeak pk;
+        pk.hz = (k + p) * binHz;
+        pk.magnitude = b - 0.25f * (a - c) * p;
+
+        // Insert keeping out[] sorted by magnitude, largest first
+        int pos = found;
+        while (pos > 0 && out[pos - 1].magnitude < pk.magnitude) pos--;
+        if (pos >= maxPeaks) continue;
+        int last = (found < maxPeaks) ? found : maxPeaks - 1;
+        for (int i = last; i > pos; i--) out[i] = out[i - 1];
+        out[pos] = pk;
+        if (found < maxPeaks) found++;
+    }
+    return found;
+}
+
+float spectrum_band_power(const float* power, int bins, float binHz, float loHz, float hiHz) {
+    float sum = 0;
+    for (int k = 0; k < bins; k++) {
+        float hz = k * binHz;
+        if (hz >= loHz && hz < hiHz) sum += power[k];
+    }
+    return sum;
+}
+
+float spectrum_centroid(const float* power, int bins, float binHz) {
+    float num = 0, den = 0;
+    for (int k = 1; k < bins; k++) {
+        num += k * binHz * power[k];
+        den += power[k];
+    }
+    return (den > 0) ? num / den : 0.0f;
+}
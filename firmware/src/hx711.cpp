@@ -0,0 +1,100 @@
+#include "hx711.h"
+#include "config.h"
+#include "event_ring.h"
+#include "timebase.h"
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// --- ISR state (ISR stamps, driver task reads) ---
+static volatile uint64_t readyUs = 0;       // DOUT falling edge of the pending conversion
+static volatile bool clocking = false;      // Frame in progress: DOUT edges are data, not ready
+
+// --- Driver state ---
+static SPIClass hx711Spi(HSPI);
+static TaskHandle_t hx711Task = NULL;
+static EventRing<Hx711Sample, HX711_RING_SIZE> samples;   // Task produces, loop() consumes
+static volatile uint32_t sampleCount = 0;
+
+static void IRAM_ATTR hx711_isr() {
+    if (clocking) {
+        return;
+    }
+    readyUs = timebase_now_us();
+    if (hx711Task != NULL) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(hx711Task, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+// Clock one reading out. DOUT must be LOW (conversion ready).
+static int32_t readFrame() {
+    uint8_t frame[HX711_FRAME_BYTES];
+    hx711_clock_pattern(frame);
+
+    clocking = true;
+    hx711Spi.beginTransaction(SPISettings(HX711_SPI_HZ, MSBFIRST, SPI_MODE0));
+    hx711Spi.transferBytes(frame, frame, HX711_FRAME_BYTES);
+    hx711Spi.endTransaction();
+    clocking = false;   // DOUT is HIGH again until the next conversion
+
+    return hx711_decode_frame(frame);
+}
+
+static void hx711TaskMain(void* arg) {
+    // Wait a little over two conversions, so a ready edge missed while
+    // clocking (or present at boot) is picked up by polling DOUT
+    const TickType_t wait = pdMS_TO_TICKS(2 * 1000 / HX711_SPS + 1);
+    for (;;) {
+        bool notified = ulTaskNotifyTake(pdTRUE, wait) > 0;
+        if (digitalRead(HX711_DOUT_PIN) == HIGH) {
+            continue;   // Not ready (or a stray edge)
+        }
+
+        Hx711Sample s;
+        s.timestampUs = notified ? readyUs : timebase_now_us();
+        s.raw = readFrame();
+        samples.push(s);    // Full ring: dropped and counted in overflows()
+        sampleCount = sampleCount + 1;
+    }
+}
+
+// --- Public API ---
+
+void hx711_init() {
+    if (hx711Task != NULL) {
+        return;
+    }
+    // SPI clock is not needed on a pin: the HX711 clock is the MOSI pattern
+    hx711Spi.begin(-1, HX711_DOUT_PIN, HX711_SCK_PIN, -1);
+    pinMode(HX711_DOUT_PIN, INPUT);
+
+    // Idle the clock LOW before the HX711 sees a long HIGH (power-down)
+    uint8_t idle = 0;
+    hx711Spi.beginTransaction(SPISettings(HX711_SPI_HZ, MSBFIRST, SPI_MODE0));
+    hx711Spi.transferBytes(&idle, NULL, 1);
+    hx711Spi.endTransaction();
+
+    xTaskCreatePinnedToCore(hx711TaskMain, "hx711", HX711_TASK_STACK,
+                            NULL, HX711_TASK_PRIORITY, &hx711Task, HX711_TASK_CORE);
+    attachInterrupt(digitalPinToInterrupt(HX711_DOUT_PIN), hx711_isr, FALLING);
+}
+
+bool hx711_take(Hx711Sample& sample) {
+    return samples.pop(sample);
+}
+
+uint32_t hx711_sample_count() {
+    return sampleCount;
+}
+
+uint32_t hx711_high_water() {
+    return samples.high_water();
+}
+
+uint32_t hx711_overflows() {
+    return samples.overflows();
+}
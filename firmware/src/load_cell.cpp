@@ -1,6 +1,8 @@
 #include "load_cell.h"
 #include "mqtt_log.h"
 #include "config.h"
+#include "timebase.h"
+#include "hx711.h"
 
 #include <ArduinoJson.h>
 #include <Preferences.h>
@@ -11,52 +13,15 @@ static float smoothedRaw = 0.0f;
 static int32_t tareOffset = 0;
 static bool tared = false;
 static bool ready = false;
-static unsigned long lastReadMs = 0;
-static uint32_t notReadyCount = 0;
-static const uint32_t HX711_TIMEOUT_POLLS = 50;  // ~5s at 100ms sample interval
+static unsigned long lastSampleMs = 0;
+static bool timeoutWarned = false;
+static uint64_t sampleTimeUs = 0;    // timebase_now_us() of the latest reading
 static float calFactor = LOAD_CELL_CAL_FACTOR;    // Loaded from NVS, falls back to config.h
 
-// --- HX711 bit-bang protocol ---
-
-// Read 24-bit signed value from HX711.
-// Returns true if data was available and read successfully.
-static bool hx711_read_raw(int32_t& value) {
-    // DOUT LOW means data is ready
-    if (digitalRead(HX711_DOUT_PIN) == HIGH) {
-        return false;  // Not ready
-    }
-
-    // Clock out 24 data bits (MSB first)
-    int32_t raw = 0;
-    for (int i = 0; i < 24; i++) {
-        digitalWrite(HX711_SCK_PIN, HIGH);
-        delayMicroseconds(1);
-        raw = (raw << 1) | digitalRead(HX711_DOUT_PIN);
-        digitalWrite(HX711_SCK_PIN, LOW);
-        delayMicroseconds(1);
-    }
-
-    // 25th pulse: set gain to 128 for next reading (Channel A)
-    digitalWrite(HX711_SCK_PIN, HIGH);
-    delayMicroseconds(1);
-    digitalWrite(HX711_SCK_PIN, LOW);
-    delayMicroseconds(1);
-
-    // Sign-extend 24-bit to 32-bit
-    if (raw & 0x800000) {
-        raw |= 0xFF000000;
-    }
-
-    value = raw;
-    return true;
-}
-
-// Power down HX711 by holding SCK HIGH for >60us
-// (not used currently, but available if needed)
-// static void hx711_power_down() {
-//     digitalWrite(HX711_SCK_PIN, HIGH);
-//     delayMicroseconds(100);
-// }
+// Sample history for window statistics (loop() only)
+static int32_t historyRaw[LOAD_CELL_HISTORY_SIZE];
+static uint64_t historyUs[LOAD_CELL_HISTORY_SIZE];
+static uint32_t historyCount = 0;     // Samples ever added; slot = count % size
 
 // --- Conversion ---
 
@@ -73,46 +38,54 @@ float load_cell_ema(float previous, float sample, float alpha) {
 // --- Public API ---
 
 void load_cell_init() {
-    pinMode(HX711_DOUT_PIN, INPUT);
-    pinMode(HX711_SCK_PIN, OUTPUT);
-    digitalWrite(HX711_SCK_PIN, LOW);
-
     // Load calibration factor from NVS (falls back to LOAD_CELL_CAL_FACTOR)
     Preferences prefs;
     prefs.begin("loadcell", true);
     calFactor = prefs.getFloat("cal", LOAD_CELL_CAL_FACTOR);
     prefs.end();
 
+    hx711_init();
+    lastSampleMs = millis();
+
     logInfo("HX711 load cell initialized");
-    Serial.printf("  DOUT=GPIO%d, SCK=GPIO%d, cal=%.1f\n",
+    Serial.printf("  DOUT=GPIO%d, SCK=GPIO%d (SPI), cal=%.1f\n",
                   HX711_DOUT_PIN, HX711_SCK_PIN, calFactor);
 }
 
-void load_cell_process() {
-    unsigned long now = millis();
-    if (now - lastReadMs < LOAD_CELL_SAMPLE_MS) {
-        return;
-    }
-    lastReadMs = now;
-
-    int32_t raw;
-    if (!hx711_read_raw(raw)) {
-        notReadyCount++;
-        if (notReadyCount == HX711_TIMEOUT_POLLS) {
-            logWarn("HX711: not responding (DOUT stuck HIGH). Check wiring");
-        }
-        return;  // HX711 not ready yet
-    }
-    notReadyCount = 0;
+// Apply one sample from the driver.
+static void addSample(const Hx711Sample& s) {
+    rawValue = s.raw;
+    sampleTimeUs = s.timestampUs;
 
-    rawValue = raw;
+    historyRaw[historyCount % LOAD_CELL_HISTORY_SIZE] = s.raw;
+    historyUs[historyCount % LOAD_CELL_HISTORY_SIZE] = s.timestampUs;
+    historyCount++;
 
     if (!ready) {
         // First reading: initialize EMA
-        smoothedRaw = (float)raw;
+        smoothedRaw = (float)s.raw;
         ready = true;
     } else {
-        smoothedRaw = load_cell_ema(smoothedRaw, (float)raw, LOAD_CELL_EMA_ALPHA);
+        smoothedRaw = load_cell_ema(smoothedRaw, (float)s.raw, LOAD_CELL_EMA_ALPHA);
+    }
+}
+
+void load_cell_process() {
+    // Drain everything the driver task read since the last call
+    Hx711Sample s;
+    bool any = false;
+    while (hx711_take(s)) {
+        addSample(s);
+        any = true;
+    }
+
+    unsigned long now = millis();
+    if (any) {
+        lastSampleMs = now;
+        timeoutWarned = false;
+    } else if (!timeoutWarned && now - lastSampleMs >= HX711_TIMEOUT_MS) {
+        logWarn("HX711: not responding (DOUT stuck HIGH). Check wiring");
+        timeoutWarned = true;
     }
 }
 
@@ -134,6 +107,32 @@ int32_t load_cell_get_raw() {
     return rawValue;
 }
 
+uint64_t load_cell_get_sample_us() {
+    return sampleTimeUs;
+}
+
+bool load_cell_window_stats(uint64_t fromUs, uint64_t toUs, WindowStats& out) {
+    static float grams[LOAD_CELL_HISTORY_SIZE];
+    static uint64_t times[LOAD_CELL_HISTORY_SIZE];
+
+    uint32_t kept = historyCount < LOAD_CELL_HISTORY_SIZE ? historyCount : LOAD_CELL_HISTORY_SIZE;
+    int n = 0;
+    for (uint32_t i = historyCount - kept; i < historyCount; i++) {
+        uint32_t slot = i % LOAD_CELL_HISTORY_SIZE;
+        if (historyUs[slot] < fromUs || historyUs[slot] > toUs) continue;
+        grams[n] = load_cell_raw_to_grams(historyRaw[slot], tareOffset, calFactor);
+        times[n] = historyUs[slot];
+        n++;
+    }
+    return window_stats_compute(grams, times, n, out);
+}
+
+bool load_cell_recent_stats(uint32_t windowMs, WindowStats& out) {
+    uint64_t windowUs = (uint64_t)windowMs * 1000;
+    uint64_t fromUs = sampleTimeUs > windowUs ? sampleTimeUs - windowUs : 0;
+    return load_cell_window_stats(fromUs, sampleTimeUs, out);
+}
+
 bool load_cell_is_ready() {
     return ready;
 }
@@ -148,6 +147,7 @@ String load_cell_build_json() {
     doc["grams"] = serialized(String(load_cell_get_grams(), 1));
     doc["raw"] = rawValue;
     doc["tared"] = tared;
+    doc["t_us"] = sampleTimeUs;
 
     String json;
     serializeJson(doc, json);
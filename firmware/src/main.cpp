@@ -9,9 +9,13 @@
 #include "mqtt_manager.h"
 #include "mqtt_log.h"
 #include "load_cell.h"
+#include "hx711.h"
 #include "vibration.h"
 #include "audio_capture.h"
 #include "pull_test.h"
+#include "speed_sweep.h"
+#include "motion_search.h"
+#include "momentum_profile.h"
 #include "track_switch.h"
 
 // Serial command buffer
@@ -23,29 +27,41 @@ static void printHelp() {
     Serial.println("Speed Calibration Track v0.4");
     Serial.println("Commands:");
     Serial.println("  arm       - Arm sensors for next pass");
-    Serial.println("  disarm    - Cancel active measurement");
+    Serial.println("  stream    - Re-arm automatically after every pass");
+    Serial.println("  disarm    - Cancel active measurement / stop streaming");
     Serial.println("  status    - Show current state");
     Serial.println("  read      - Read raw sensor state");
+    Serial.println("  scale X   - Set scale (N, HO, S, O)");
+    Serial.println("  early N [P] - End runs once N intervals agree within P% (0 = off)");
     Serial.println("  load      - Read load cell (grams)");
     Serial.println("  tare      - Tare (zero) load cell");
-    Serial.println("  vibration - Start vibration capture");
+    Serial.println("  order D [T] - Order tracking: wheel diameter D mm, T-tooth mesh (0 = off)");
+    Serial.println("  vibration [ms] - Start vibration capture (default length if ms omitted)");
     Serial.println("  audio     - Start audio capture");
+    Serial.println("  fftbench  - Time the vibration FFT on this board");
     Serial.println("  help      - Show this message");
     Serial.println();
 }
 
 static void printStatus() {
-    Serial.printf("State: %s\n", sensor_state_name(sensor_get_state()));
+    Serial.printf("State: %s%s\n", sensor_state_name(sensor_get_state()),
+                  sensor_is_streaming() ? " (streaming)" : "");
     if (sensor_get_state() == STATE_MEASURING) {
         const RunResult& r = sensor_get_result();
         Serial.printf("Sensors triggered: %d / %d\n", r.sensorsTriggered, NUM_SENSORS);
     }
+    Serial.printf("ISR events: high water %lu / %d, overflows %lu\n",
+                  (unsigned long)sensor_get_event_high_water(), SENSOR_EVENT_RING_SIZE,
+                  (unsigned long)sensor_get_event_overflows());
+    Serial.printf("Results dropped: %lu\n", (unsigned long)sensor_get_results_dropped());
     Serial.printf("MQTT: %s\n", mqtt_is_connected() ? "connected" : "disconnected");
     Serial.printf("Load cell: %s", load_cell_is_ready() ? "ready" : "not ready");
     if (load_cell_is_ready()) {
         Serial.printf(", %.1fg%s", load_cell_get_grams(), load_cell_is_tared() ? " (tared)" : "");
     }
-    Serial.println();
+    Serial.printf(" (%lu samples, ring high water %lu / %d, overflows %lu)\n",
+                  (unsigned long)hx711_sample_count(), (unsigned long)hx711_high_water(),
+                  HX711_RING_SIZE, (unsigned long)hx711_overflows());
     Serial.printf("Vibration: %s\n", vibration_is_capturing() ? "capturing" : "idle");
     Serial.printf("Audio: %s\n", audio_is_capturing() ? "capturing" : "idle");
     Serial.printf("Track mode: %s%s\n",
@@ -54,10 +70,10 @@ static void printStatus() {
 }
 
 static void readSensors() {
-    uint8_t raw = mcp23017_read_sensors();
-    Serial.printf("Port A raw: 0x%02X  [", raw);
+    uint16_t raw = mcp23017_read_sensors();
+    Serial.printf("Ports B:A raw: 0x%04X  [", raw);
     for (int i = 0; i < NUM_SENSORS; i++) {
-        bool detected = !(raw & (1 << i));  // LOW = detection
+        bool detected = !(raw & (1u << i));  // LOW = detection
         Serial.printf(" S%d:%s", i, detected ? "DET" : "---");
     }
     Serial.println(" ]");
@@ -72,6 +88,14 @@ static void processCommand(const char* cmd) {
             Serial.println("Armed. Waiting for locomotive pass...");
         }
         web_send_status();
+    } else if (strcmp(cmd, "stream") == 0) {
+        if (!track_switch_allow_operation()) {
+            Serial.println("Stream blocked: track is in layout mode (switch to programming track).");
+        } else {
+            sensor_set_streaming(true);
+            Serial.println("Streaming. Every pass is measured; 'disarm' to stop.");
+        }
+        web_send_status();
     } else if (strcmp(cmd, "disarm") == 0) {
         sensor_disarm();
         Serial.println("Disarmed.");
@@ -80,6 +104,41 @@ static void processCommand(const char* cmd) {
         printStatus();
     } else if (strcmp(cmd, "read") == 0) {
         readSensors();
+    } else if (strncmp(cmd, "scale", 5) == 0) {
+        ScaleId scale;
+        if (cmd[5] == ' ' && speed_scale_from_name(cmd + 6, scale)) {
+            speed_set_scale(scale);
+            web_send_status();
+        }
+        Serial.printf("Scale: %s (1:%.1f)\n", speed_scale_name(speed_get_scale()),
+                      speed_scale_ratio(speed_get_scale()));
+    } else if (strncmp(cmd, "early", 5) == 0) {
+        int intervals = 0;
+        float tolPct = 0;
+        if (sscanf(cmd + 5, "%d %f", &intervals, &tolPct) >= 1) {
+            sensor_set_early_stop(intervals, tolPct / 100.0f);
+            web_send_status();
+        }
+        if (sensor_get_early_stop_intervals() > 0) {
+            Serial.printf("Early stop: %d intervals within +/-%.1f%%\n",
+                          sensor_get_early_stop_intervals(),
+                          sensor_get_early_stop_tolerance() * 100.0f);
+        } else {
+            Serial.println("Early stop: off");
+        }
+    } else if (strncmp(cmd, "order", 5) == 0) {
+        float wheelMm = 0;
+        int mesh = 0;
+        if (sscanf(cmd + 5, "%f %d", &wheelMm, &mesh) >= 1) {
+            vibration_set_order_tracking(wheelMm, mesh);
+            web_send_status();
+        }
+        if (vibration_order_tracking_enabled()) {
+            Serial.printf("Order tracking: wheel %.2fmm, mesh order %d\n",
+                          vibration_get_wheel_dia_mm(), vibration_get_mesh_order());
+        } else {
+            Serial.println("Order tracking: off");
+        }
     } else if (strcmp(cmd, "load") == 0) {
         if (load_cell_is_ready()) {
             Serial.printf("Load: %.1f g (raw=%d%s)\n",
@@ -92,10 +151,20 @@ static void processCommand(const char* cmd) {
     } else if (strcmp(cmd, "tare") == 0) {
         load_cell_tare();
         web_send_load();
-    } else if (strcmp(cmd, "vibration") == 0) {
-        vibration_start_capture();
+    } else if (strncmp(cmd, "vibration", 9) == 0) {
+        unsigned long ms = VIBRATION_CAPTURE_MS;
+        sscanf(cmd + 9, "%lu", &ms);
+        vibration_start_capture(ms);
     } else if (strcmp(cmd, "audio") == 0) {
         audio_start_capture();
+    } else if (strcmp(cmd, "fftbench") == 0) {
+        if (vibration_is_capturing()) {
+            Serial.println("Vibration capture in progress, try again when it finishes.");
+        } else {
+            uint32_t us = vibration_fft_benchmark(50);
+            Serial.printf("FFT: %d points + Hann window = %luus each (50 runs)\n",
+                          1 << VIBRATION_FFT_LOG2, (unsigned long)us);
+        }
     } else if (strcmp(cmd, "help") == 0) {
         printHelp();
     } else if (strlen(cmd) > 0) {
@@ -110,7 +179,8 @@ void setup() {
     Serial.println();
     Serial.println("================================");
     Serial.println("Speed Calibration Track v0.4");
-    Serial.printf("Sensors: %d @ %dmm spacing\n", NUM_SENSORS, (int)SENSOR_SPACING_MM);
+    Serial.printf("Sensors: %d @ %dmm spacing, %s scale\n", NUM_SENSORS, (int)SENSOR_SPACING_MM,
+                  speed_scale_name(speed_get_scale()));
     Serial.println("================================");
 
     // Initialize I2C
@@ -142,8 +212,9 @@ void setup() {
     }
     Serial.println("MCP23017 initialized.");
 
-    // Initialize sensor array logic
+    // Initialize sensor array logic and start its high-priority task
     sensor_init();
+    sensor_start_task();
 
     // Attach interrupt on MCP23017 INT pin (active-low, falling edge)
     pinMode(MCP23017_INT_PIN, INPUT_PULLUP);
@@ -179,6 +250,19 @@ void setup() {
 }
 
 void loop() {
+    // End-of-array exit first: a shuttling loco is reversed before any
+    // networking housekeeping can delay it
+    Direction exitDir;
+    if (sensor_take_exit(exitDir)) {
+        speed_sweep_on_exit(exitDir);
+    }
+
+    // Stream each interval of the pass in progress as soon as it is measured
+    IntervalEvent interval;
+    while (sensor_take_interval(interval)) {
+        web_send_interval(interval);
+    }
+
     // WiFi housekeeping (DNS for captive portal)
     wifi_process();
 
@@ -194,6 +278,20 @@ void loop() {
         web_send_vibration();
     }
 
+    // Order tracking: capture from the first sensor edge of each pass to
+    // its end, analysed once both the capture and the run result are in
+    static RunState lastSensorState = STATE_IDLE;
+    RunState sensorState = sensor_get_state();
+    if (sensorState == STATE_MEASURING && lastSensorState != STATE_MEASURING) {
+        vibration_order_begin_pass();
+    } else if (sensorState != STATE_MEASURING && lastSensorState == STATE_MEASURING) {
+        vibration_order_end_pass();
+    }
+    lastSensorState = sensorState;
+    if (vibration_order_take_result()) {
+        web_send_order();
+    }
+
     bool audioWasCapturing = audio_is_capturing();
     audio_process();
     if (audioWasCapturing && !audio_is_capturing()) {
@@ -224,6 +322,34 @@ void loop() {
         lastPullStep = -1;
     }
 
+    // Speed sweep state machine: stream each step as it finishes
+    bool sweepWasRunning = speed_sweep_is_running();
+    static int lastSweepSteps = 0;
+    speed_sweep_process();
+    if (speed_sweep_completed_steps() != lastSweepSteps) {
+        lastSweepSteps = speed_sweep_completed_steps();
+        if (lastSweepSteps > 0) {
+            web_send_sweep_step();
+        }
+    }
+    if (sweepWasRunning && !speed_sweep_is_running()) {
+        web_send_sweep();
+    }
+
+    // Start-of-motion search: one message with both thresholds
+    bool searchWasRunning = motion_search_is_running();
+    motion_search_process();
+    if (searchWasRunning && !motion_search_is_running()) {
+        web_send_motion_search();
+    }
+
+    // Momentum profiling: one message with both passes
+    bool momentumWasRunning = momentum_is_running();
+    momentum_process();
+    if (momentumWasRunning && !momentum_is_running()) {
+        web_send_momentum();
+    }
+
     // Process serial commands
     while (Serial.available()) {
         char c = Serial.read();
@@ -239,13 +365,13 @@ void loop() {
         }
     }
 
-    // Update sensor detection state machine
-    bool justCompleted = sensor_update();
-
-    if (justCompleted) {
-        const RunResult& run = sensor_get_result();
-
+    // Collect runs completed by the sensor task
+    RunResult run;
+    if (sensor_take_result(run)) {
+        // Streaming may re-arm before loop() sees the state change
+        vibration_order_end_pass();
         Serial.println();
+        Serial.printf("Run #%lu\n", (unsigned long)run.sequence);
 
         if (run.sensorsTriggered < 2) {
             Serial.println("Run ended with fewer than 2 sensors triggered.");
@@ -254,15 +380,25 @@ void loop() {
             SpeedResult speed;
             if (speed_calculate(run, speed)) {
                 speed_print_result(run, speed);
+                if (speed.fit.valid) {
+                    uint64_t refUs = speed.fit.firstEdgeUs + (uint64_t)(speed.fit.meanTimeS * 1e6f);
+                    vibration_order_on_pass(run.sequence, run.runStartUs, refUs,
+                                            speed.fit.velocityMmS, speed.fit.accelMmS2);
+                }
             } else {
                 Serial.println("Run complete but could not compute speeds.");
             }
         }
 
         // Send result to web clients and MQTT
-        web_send_result();
+        web_send_result(run);
+        speed_sweep_on_result(run);
+        momentum_on_result(run);
 
-        Serial.println("Type 'arm' to measure again.");
+        if (!sensor_is_streaming() && !speed_sweep_is_running() &&
+            !motion_search_is_running() && !momentum_is_running()) {
+            Serial.println("Type 'arm' to measure again.");
+        }
         Serial.print("> ");
     }
 }
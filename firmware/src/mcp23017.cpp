@@ -1,11 +1,29 @@
 #include "mcp23017.h"
 #include "mqtt_log.h"
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Register access happens from both the sensor task and loop(). A register
+// read is two I2C transactions (set pointer, then read), so hold a lock
+// across the pair to keep another context from moving the pointer.
+static SemaphoreHandle_t busLock = NULL;
+
+static void busTake() {
+    if (busLock != NULL) xSemaphoreTake(busLock, portMAX_DELAY);
+}
+
+static void busGive() {
+    if (busLock != NULL) xSemaphoreGive(busLock);
+}
+
 bool mcp23017_write_reg(uint8_t reg, uint8_t value) {
+    busTake();
     Wire.beginTransmission(MCP23017_ADDR);
     Wire.write(reg);
     Wire.write(value);
     uint8_t err = Wire.endTransmission();
+    busGive();
     if (err != 0) {
         logErrorf("MCP23017: I2C write error %d (reg 0x%02X)", err, reg);
         return false;
@@ -14,38 +32,72 @@ bool mcp23017_write_reg(uint8_t reg, uint8_t value) {
 }
 
 uint8_t mcp23017_read_reg(uint8_t reg) {
+    busTake();
     Wire.beginTransmission(MCP23017_ADDR);
     Wire.write(reg);
     uint8_t err = Wire.endTransmission();
     if (err != 0) {
+        busGive();
         logErrorf("MCP23017: I2C write error %d (reg 0x%02X)", err, reg);
         return 0xFF;
     }
     Wire.requestFrom((uint8_t)MCP23017_ADDR, (uint8_t)1);
     if (Wire.available() < 1) {
+        busGive();
         logErrorf("MCP23017: I2C read error (reg 0x%02X)", reg);
         return 0xFF;
     }
-    return Wire.read();
+    uint8_t value = Wire.read();
+    busGive();
+    return value;
+}
+
+bool mcp23017_read_regs(uint8_t reg, uint8_t* buf, uint8_t len) {
+    busTake();
+    Wire.beginTransmission(MCP23017_ADDR);
+    Wire.write(reg);
+    uint8_t err = Wire.endTransmission(false);  // Repeated start, keep the bus
+    if (err != 0) {
+        busGive();
+        logErrorf("MCP23017: I2C write error %d (reg 0x%02X)", err, reg);
+        return false;
+    }
+    // IOCON.SEQOP=0: the address pointer auto-increments across the burst
+    Wire.requestFrom((uint8_t)MCP23017_ADDR, len);
+    if (Wire.available() < len) {
+        busGive();
+        logErrorf("MCP23017: I2C burst read error (reg 0x%02X, %u bytes)", reg, len);
+        return false;
+    }
+    for (uint8_t i = 0; i < len; i++) {
+        buf[i] = Wire.read();
+    }
+    busGive();
+    return true;
 }
 
 bool mcp23017_init() {
+    if (busLock == NULL) {
+        busLock = xSemaphoreCreateMutex();
+    }
+
     // Check device is present
     Wire.beginTransmission(MCP23017_ADDR);
     if (Wire.endTransmission() != 0) {
         return false;
     }
 
-    // Build input mask for our sensors (GPA0 through GPA[NUM_SENSORS-1])
-    uint8_t sensorMask = (1 << NUM_SENSORS) - 1;  // e.g., 0x0F for 4 sensors
+    // Sensor pins: GPA0-7 then GPB0-7, low byte = port A, high byte = port B
+    uint8_t maskA = SENSOR_PIN_MASK & 0xFF;         // e.g., 0x0F for 4 sensors
+    uint8_t maskB = (SENSOR_PIN_MASK >> 8) & 0xFF;  // 0x00 until NUM_SENSORS > 8
 
     // IOCON: MIRROR=1 (INTA=INTB mirrored), INTPOL=0 (active-low)
-    // BANK=0 (sequential registers), ODR=0 (active driver)
+    // BANK=0 (sequential registers), SEQOP=0 (address auto-increment),
+    // ODR=0 (active driver)
     mcp23017_write_reg(MCP_IOCON, 0x40);
 
-    // Port A: sensor pins as inputs
+    // Both ports: all inputs (unused pins are safe as inputs)
     mcp23017_write_reg(MCP_IODIRA, 0xFF);
-    // Port B: all inputs (unused, but safe default)
     mcp23017_write_reg(MCP_IODIRB, 0xFF);
 
     // No internal pullups — we use external 10k pullups
@@ -53,30 +105,51 @@ bool mcp23017_init() {
     mcp23017_write_reg(MCP_GPPUB, 0x00);
 
     // No polarity inversion — TCRT5000 with pullup reads HIGH when clear,
-    // LOW when locomotive is over sensor. We detect falling edges.
+    // LOW when locomotive is over sensor. Falling edge = block, rising = clear.
     mcp23017_write_reg(MCP_IPOLA, 0x00);
+    mcp23017_write_reg(MCP_IPOLB, 0x00);
 
     // Interrupt-on-change for sensor pins only
-    mcp23017_write_reg(MCP_GPINTENA, sensorMask);
-    mcp23017_write_reg(MCP_GPINTENB, 0x00);
+    mcp23017_write_reg(MCP_GPINTENA, maskA);
+    mcp23017_write_reg(MCP_GPINTENB, maskB);
 
-    // Compare against default value (HIGH = no detection)
-    // INTCON=1 means compare to DEFVAL, not previous value
-    mcp23017_write_reg(MCP_INTCONA, sensorMask);
-    mcp23017_write_reg(MCP_DEFVALA, sensorMask);  // Default = all HIGH (no loco)
+    // Compare against previous value (INTCON=0), so both the block
+    // (falling) and clear (rising) edge of every sensor interrupt.
+    // DEFVAL is unused in this mode; keep it at "all clear" for reference.
+    mcp23017_write_reg(MCP_INTCONA, 0x00);
+    mcp23017_write_reg(MCP_INTCONB, 0x00);
+    mcp23017_write_reg(MCP_DEFVALA, maskA);
+    mcp23017_write_reg(MCP_DEFVALB, maskB);
 
     // Read INTCAP and GPIO to clear any pending interrupt
-    mcp23017_read_reg(MCP_INTCAPA);
-    mcp23017_read_reg(MCP_GPIOA);
+    uint16_t flags, captured, current;
+    mcp23017_read_interrupt(flags, captured, current);
 
     return true;
 }
 
-uint8_t mcp23017_read_interrupt() {
-    // INTCAPA captures port state at time of interrupt — reading clears it
-    return mcp23017_read_reg(MCP_INTCAPA);
+bool mcp23017_read_interrupt(uint16_t& flags, uint16_t& captured, uint16_t& current) {
+    // One burst: INTFA, INTFB, INTCAPA, INTCAPB, GPIOA, GPIOB (0x0E-0x13).
+    // INTCAP holds the port state at the time of the interrupt — reading clears it.
+    // GPIO shows any further change that happened while the interrupt was
+    // pending (those do not raise a second interrupt).
+    uint8_t buf[6];
+    if (!mcp23017_read_regs(MCP_INTFA, buf, sizeof(buf))) {
+        flags = 0;
+        captured = 0xFFFF;  // All HIGH = nothing detected
+        current = 0xFFFF;
+        return false;
+    }
+    flags = (uint16_t)buf[0] | ((uint16_t)buf[1] << 8);
+    captured = (uint16_t)buf[2] | ((uint16_t)buf[3] << 8);
+    current = (uint16_t)buf[4] | ((uint16_t)buf[5] << 8);
+    return true;
 }
 
-uint8_t mcp23017_read_sensors() {
-    return mcp23017_read_reg(MCP_GPIOA);
+uint16_t mcp23017_read_sensors() {
+    uint8_t buf[2];
+    if (!mcp23017_read_regs(MCP_GPIOA, buf, sizeof(buf))) {
+        return 0xFFFF;
+    }
+    return (uint16_t)buf[0] | ((uint16_t)buf[1] << 8);
 }
@@ -0,0 +1,314 @@
+#include "momentum_profile.h"
+#include "config.h"
+#include "speed_calc.h"
+#include "mqtt_manager.h"
+#include "track_switch.h"
+#include "speed_sweep.h"
+#include "motion_search.h"
+#include "pull_test.h"
+
+#include <ArduinoJson.h>
+
+// --- State machine ---
+
+enum MomentumState {
+    MP_IDLE,
+    MP_STARTING,      // Stopped, direction forward, sensors armed
+    MP_ACCEL,         // Speed commanded from rest, waiting for the pass
+    MP_ACCEL_STOP,    // Pass done, loco stopping
+    MP_REVERSING,     // Direction reversed, waiting before the run-up
+    MP_DECEL_ENTRY,   // Running back toward the array, waiting for the first edge
+    MP_DECEL,         // Stop commanded at the first edge, waiting for the pass
+    MP_DONE
+};
+
+struct MomentumResult {
+    bool valid;
+    float cmdToAckMs;         // Speed/stop command to bridge ack (-1 if none)
+    float cmdToZeroMs;        // Accel: command to start of motion.
+                              // Decel: stop command to standstill (overrun time).
+                              // -1 if the fit has no usable acceleration
+    float accelMmS2;          // Fitted (negative when decelerating)
+    float accelMphS;          // Same, in prototype mph per second
+    float cmdMph;             // Decel: fitted speed at the stop command
+    float overrunMm;          // Decel: distance from stop command to standstill
+    int points;
+    float tMs[NUM_SENSORS];   // Interval mid-time after the command
+    float mph[NUM_SENSORS];   // Interval speed
+};
+
+// Configuration
+static MomentumParams params;
+
+// State
+static MomentumState state = MP_IDLE;
+static unsigned long stateEnteredMs = 0;
+static bool profileComplete = false;
+static uint64_t commandUs = 0;    // Speed (accel) or stop (decel) command time
+static int savedEarlyStop = 0;
+static float savedEarlyTol = 0;
+
+// Results
+static MomentumResult accelResult;
+static MomentumResult decelResult;
+
+// --- Helpers ---
+
+static void setSpeed(int step) {
+    float throttle = (float)step / 126.0f;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%.3f", throttle);
+    mqtt_publish_throttle("speed", String(buf));
+}
+
+static void stopLoco() {
+    mqtt_publish_throttle("stop", "");
+}
+
+static void enterState(MomentumState s) {
+    state = s;
+    stateEnteredMs = millis();
+}
+
+static void finishProfile(bool complete) {
+    stopLoco();
+    sensor_disarm();
+    sensor_set_early_stop(savedEarlyStop, savedEarlyTol);
+    profileComplete = complete;
+    enterState(MP_DONE);
+}
+
+// Analyse one pass against the command that started it.
+static void analyse(const RunResult& run, bool decel, MomentumResult& out) {
+    memset(&out, 0, sizeof(out));
+    out.cmdToAckMs = -1;
+    out.cmdToZeroMs = -1;
+
+    uint64_t ackUs = mqtt_get_speed_ack_us();
+    if (ackUs >= commandUs) {
+        out.cmdToAckMs = (ackUs - commandUs) / 1000.0f;
+    }
+
+    SpeedResult speed;
+    if (run.sensorsTriggered < 2 || !speed_calculate(run, speed) || !speed.fit.valid) {
+        return;
+    }
+    out.valid = true;
+    out.accelMmS2 = speed.fit.accelMmS2;
+    out.accelMphS = speed_mms_to_mph(speed.fit.accelMmS2);
+
+    uint64_t zeroUs;
+    if (speed_fit_zero_velocity_us(speed.fit, zeroUs)) {
+        out.cmdToZeroMs = ((int64_t)(zeroUs - commandUs)) / 1000.0f;
+    }
+    if (decel) {
+        // Speed when the stop went out, and the distance to stand still
+        double tCmd = ((int64_t)(commandUs - speed.fit.firstEdgeUs)) / 1000000.0;
+        float vCmd = speed.fit.velocityMmS + speed.fit.accelMmS2 * (float)(tCmd - speed.fit.meanTimeS);
+        out.cmdMph = speed_mms_to_mph(vCmd);
+        if (speed.fit.accelMmS2 < 0) {
+            out.overrunMm = vCmd * vCmd / (-2.0f * speed.fit.accelMmS2);
+        }
+    }
+
+    // Interval speeds against time since the command (same pairs, same
+    // order as speed_calculate)
+    for (int i = 0; i < NUM_SENSORS - 1 && out.points < speed.intervalCount; i++) {
+        int a = (run.direction == DIR_B_TO_A) ? (NUM_SENSORS - 1 - i) : i;
+        int b = (run.direction == DIR_B_TO_A) ? (a - 1) : (a + 1);
+        if (!run.triggered[a] || !run.triggered[b] || run.timestamps[b] <= run.timestamps[a]) {
+            continue;
+        }
+        uint64_t mid = run.timestamps[a] + (run.timestamps[b] - run.timestamps[a]) / 2;
+        out.tMs[out.points] = ((int64_t)(mid - commandUs)) / 1000.0f;
+        out.mph[out.points] = speed.scaleSpeedsMph[out.points];
+        out.points++;
+    }
+}
+
+static void printResult(const char* name, const MomentumResult& r) {
+    if (!r.valid) {
+        Serial.printf("Momentum: %s pass had no usable fit\n", name);
+        return;
+    }
+    Serial.printf("Momentum: %s %.1f mm/s^2 (%.2f mph/s), cmd→ack %.0fms, cmd→v=0 %.0fms\n",
+                  name, r.accelMmS2, r.accelMphS, r.cmdToAckMs, r.cmdToZeroMs);
+}
+
+// --- Public API ---
+
+MomentumParams momentum_default_params() {
+    MomentumParams p;
+    p.step = MOMENTUM_DEFAULT_STEP;
+    p.cv3 = -1;
+    p.cv4 = -1;
+    p.stopWaitMs = MOMENTUM_STOP_WAIT_MS;
+    return p;
+}
+
+MomentumParams momentum_params_from_json(const char* json) {
+    MomentumParams p = momentum_default_params();
+    JsonDocument doc;
+    if (json == NULL || deserializeJson(doc, json) != DeserializationError::Ok) {
+        return p;
+    }
+    p.step = doc["step"] | p.step;
+    p.cv3 = doc["cv3"] | p.cv3;
+    p.cv4 = doc["cv4"] | p.cv4;
+    p.stopWaitMs = doc["stop_wait_ms"] | p.stopWaitMs;
+    return p;
+}
+
+void momentum_start(const MomentumParams& p) {
+    if (state != MP_IDLE && state != MP_DONE) return;
+    // The other test modes drive the same loco and sensor array
+    if (speed_sweep_is_running() || motion_search_is_running() || pull_test_is_running()) {
+        Serial.println("Momentum: another test mode is running");
+        return;
+    }
+    if (!mqtt_get_throttle_acquired()) {
+        Serial.println("Momentum: throttle not acquired");
+        return;
+    }
+    if (!track_switch_allow_dcc_test()) {
+        Serial.println("Momentum: blocked by track switch (not in DCC programming mode)");
+        return;
+    }
+
+    params = p;
+    params.step = constrain(params.step, 1, 126);
+    if (params.stopWaitMs == 0) params.stopWaitMs = MOMENTUM_STOP_WAIT_MS;
+
+    memset(&accelResult, 0, sizeof(accelResult));
+    memset(&decelResult, 0, sizeof(decelResult));
+    profileComplete = false;
+
+    // Full passes only: early termination would cut the curve short
+    savedEarlyStop = sensor_get_early_stop_intervals();
+    savedEarlyTol = sensor_get_early_stop_tolerance();
+    sensor_set_early_stop(0, 0);
+
+    stopLoco();
+    sensor_disarm();
+    mqtt_publish_throttle("direction", "FORWARD");
+    sensor_arm();
+    enterState(MP_STARTING);
+
+    Serial.printf("Momentum profile started: step %d, CV3=%d CV4=%d\n",
+                  params.step, params.cv3, params.cv4);
+}
+
+void momentum_abort() {
+    if (state == MP_IDLE || state == MP_DONE) return;
+
+    finishProfile(false);
+    Serial.println("Momentum profile aborted");
+}
+
+void momentum_on_result(const RunResult& run) {
+    if (state == MP_ACCEL) {
+        analyse(run, false, accelResult);
+        printResult("accel", accelResult);
+        stopLoco();
+        enterState(MP_ACCEL_STOP);
+    } else if (state == MP_DECEL) {
+        analyse(run, true, decelResult);
+        printResult("decel", decelResult);
+        finishProfile(true);
+    }
+}
+
+void momentum_process() {
+    if (state == MP_IDLE || state == MP_DONE) return;
+
+    unsigned long elapsed = millis() - stateEnteredMs;
+
+    switch (state) {
+        case MP_STARTING:
+            if (elapsed >= 500) {
+                // Zero settle: the array times the pickup from this command
+                setSpeed(params.step);
+                commandUs = mqtt_get_speed_command_us();
+                enterState(MP_ACCEL);
+            }
+            break;
+
+        case MP_ACCEL:
+        case MP_DECEL:
+        case MP_DECEL_ENTRY:
+            if (elapsed >= MOMENTUM_TIMEOUT_MS) {
+                Serial.println("Momentum: no pass detected");
+                finishProfile(false);
+                break;
+            }
+            if (state == MP_DECEL_ENTRY && sensor_get_state() == STATE_MEASURING) {
+                // Nose at the first sensor: cut the throttle and let the
+                // array record the coast-down
+                stopLoco();
+                commandUs = mqtt_get_speed_command_us();
+                enterState(MP_DECEL);
+            }
+            break;
+
+        case MP_ACCEL_STOP:
+            if (elapsed >= params.stopWaitMs) {
+                mqtt_publish_throttle("direction", "REVERSE");
+                enterState(MP_REVERSING);
+            }
+            break;
+
+        case MP_REVERSING:
+            if (elapsed >= 500) {
+                sensor_arm();
+                setSpeed(params.step);
+                enterState(MP_DECEL_ENTRY);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool momentum_is_running() {
+    return state != MP_IDLE && state != MP_DONE;
+}
+
+static void addResult(JsonObject o, const MomentumResult& r, bool decel) {
+    o["valid"] = r.valid;
+    if (r.cmdToAckMs >= 0) o["cmd_to_ack_ms"] = serialized(String(r.cmdToAckMs, 1));
+    if (!r.valid) return;
+    o["accel_mm_s2"] = serialized(String(r.accelMmS2, 1));
+    o["accel_mph_s"] = serialized(String(r.accelMphS, 2));
+    if (r.cmdToZeroMs >= 0) {
+        o[decel ? "overrun_ms" : "cmd_to_motion_ms"] = serialized(String(r.cmdToZeroMs, 0));
+    }
+    if (decel) {
+        o["cmd_mph"] = serialized(String(r.cmdMph, 1));
+        if (r.overrunMm > 0) o["overrun_mm"] = serialized(String(r.overrunMm, 0));
+    }
+    JsonArray t = o["t_ms"].to<JsonArray>();
+    JsonArray mph = o["mph"].to<JsonArray>();
+    for (int i = 0; i < r.points; i++) {
+        t.add(serialized(String(r.tMs[i], 0)));
+        mph.add(serialized(String(r.mph[i], 1)));
+    }
+}
+
+String momentum_build_json() {
+    JsonDocument doc;
+    doc["type"] = "momentum";
+    doc["complete"] = profileComplete;
+    doc["step"] = params.step;
+    if (params.cv3 >= 0) doc["cv3"] = params.cv3;
+    if (params.cv4 >= 0) doc["cv4"] = params.cv4;
+    doc["scale"] = speed_scale_name(speed_get_scale());
+    addResult(doc["accel"].to<JsonObject>(), accelResult, false);
+    if (profileComplete || decelResult.valid) {
+        addResult(doc["decel"].to<JsonObject>(), decelResult, true);
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
@@ -0,0 +1,312 @@
+#include "motion_search.h"
+#include "config.h"
+#include "sensor_array.h"
+#include "load_cell.h"
+#include "vibration.h"
+#include "mqtt_manager.h"
+#include "track_switch.h"
+#include "speed_sweep.h"
+#include "pull_test.h"
+#include "momentum_profile.h"
+
+#include <ArduinoJson.h>
+
+// --- State machine ---
+
+enum MotionSearchState {
+    MS_IDLE,
+    MS_BASELINE,      // Loco stopped, capturing vibration baseline
+    MS_DIRECTION,     // Direction set, waiting before first probe
+    MS_PROBING,       // Speed set, watching for onset
+    MS_STOPPING,      // Probe done, loco stopping
+    MS_DONE
+};
+
+// How onset was detected on a probe
+enum MotionSource {
+    SRC_NONE,
+    SRC_SENSOR,       // Sensor edge after arming
+    SRC_VIBRATION,    // Piezo RMS above baseline
+    SRC_LOAD          // Load cell away from baseline
+};
+
+struct MotionProbe {
+    bool forward;
+    uint8_t step;
+    MotionSource source;
+    uint16_t onsetMs;     // Speed command to onset (0 if no motion)
+};
+
+static const char* sourceName(MotionSource s) {
+    switch (s) {
+        case SRC_SENSOR:    return "sensor";
+        case SRC_VIBRATION: return "vibration";
+        case SRC_LOAD:      return "load";
+        default:            return "none";
+    }
+}
+
+// Configuration
+static int lowBound = MOTION_SEARCH_LOW;
+static int highBound = MOTION_SEARCH_HIGH;
+
+// State
+static MotionSearchState state = MS_IDLE;
+static unsigned long stateEnteredMs = 0;
+static unsigned long searchStartMs = 0;
+static bool forward = true;
+static int low = 0, high = 0, best = 0, probeStep = 0;
+static bool vibStarted = false;
+static bool searchComplete = false;
+
+// Baselines (loco stopped)
+static float baselineRms = 0.0f;
+static float baselineGrams = 0.0f;
+static bool haveLoadBaseline = false;
+
+// Results
+static int forwardStep = 0;     // 0 = not found / not searched
+static int reverseStep = 0;
+static const int MAX_PROBES = 32;
+static MotionProbe probes[MAX_PROBES];
+static int probeCount = 0;
+
+// --- Helpers ---
+
+static void setSpeed(int step) {
+    float throttle = (float)step / 126.0f;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%.3f", throttle);
+    mqtt_publish_throttle("speed", String(buf));
+}
+
+static void stopLoco() {
+    mqtt_publish_throttle("stop", "");
+}
+
+static void enterState(MotionSearchState s) {
+    state = s;
+    stateEnteredMs = millis();
+}
+
+static void beginDirection(bool fwd) {
+    forward = fwd;
+    mqtt_publish_throttle("direction", fwd ? "FORWARD" : "REVERSE");
+    low = lowBound;
+    high = highBound;
+    best = highBound;  // Fallback: assume start at high bound
+    enterState(MS_DIRECTION);
+}
+
+static void beginProbe() {
+    probeStep = (low + high) / 2;
+    vibStarted = false;
+    sensor_arm();
+    setSpeed(probeStep);
+    enterState(MS_PROBING);
+}
+
+// Check every onset source. Returns SRC_NONE if the loco is still stationary.
+static MotionSource detectOnset() {
+    // A sensor edge is unambiguous motion
+    if (sensor_get_state() != STATE_ARMED) {
+        return SRC_SENSOR;
+    }
+
+    // Drawbar load changes as soon as the loco pulls against the fixture
+    if (haveLoadBaseline && load_cell_is_ready() &&
+        fabsf(load_cell_get_grams() - baselineGrams) > MOTION_LOAD_DELTA_G) {
+        return SRC_LOAD;
+    }
+
+    // Motor and gear noise: one capture window after the spin-up delay
+    if (vibStarted && !vibration_is_capturing() && vibration_has_result()) {
+        float rms = vibration_get_rms();
+        if (rms > baselineRms * MOTION_VIB_RMS_FACTOR + MOTION_VIB_RMS_MARGIN) {
+            return SRC_VIBRATION;
+        }
+    }
+    return SRC_NONE;
+}
+
+static void recordProbe(MotionSource src, unsigned long elapsed) {
+    if (probeCount < MAX_PROBES) {
+        MotionProbe& p = probes[probeCount++];
+        p.forward = forward;
+        p.step = (uint8_t)probeStep;
+        p.source = src;
+        p.onsetMs = (src != SRC_NONE) ? (uint16_t)min(elapsed, 65535UL) : 0;
+    }
+    Serial.printf("Motion search: %s step %d %s%s\n",
+                  forward ? "fwd" : "rev", probeStep,
+                  src != SRC_NONE ? "MOVEMENT via " : "no movement",
+                  src != SRC_NONE ? sourceName(src) : "");
+}
+
+static void finishSearch(bool complete) {
+    stopLoco();
+    sensor_disarm();
+    searchComplete = complete;
+    enterState(MS_DONE);
+}
+
+// --- Public API ---
+
+void motion_search_start(int low_step, int high_step) {
+    if (state != MS_IDLE && state != MS_DONE) return;
+    // The other test modes drive the same loco and sensor array
+    if (speed_sweep_is_running() || pull_test_is_running() || momentum_is_running()) {
+        Serial.println("Motion search: another test mode is running");
+        return;
+    }
+    if (!mqtt_get_throttle_acquired()) {
+        Serial.println("Motion search: throttle not acquired");
+        return;
+    }
+    if (!track_switch_allow_dcc_test()) {
+        Serial.println("Motion search: blocked by track switch (not in DCC programming mode)");
+        return;
+    }
+
+    lowBound = constrain(low_step > 0 ? low_step : MOTION_SEARCH_LOW, 1, 126);
+    highBound = constrain(high_step > 0 ? high_step : MOTION_SEARCH_HIGH, lowBound, 126);
+
+    // Reset results
+    forwardStep = 0;
+    reverseStep = 0;
+    probeCount = 0;
+    searchComplete = false;
+
+    stopLoco();
+    sensor_disarm();
+
+    // Baseline with the loco stopped
+    haveLoadBaseline = load_cell_is_ready();
+    baselineGrams = haveLoadBaseline ? load_cell_get_grams() : 0.0f;
+    vibration_start_capture(VIBRATION_CAPTURE_MS);
+
+    searchStartMs = millis();
+    enterState(MS_BASELINE);
+
+    Serial.printf("Motion search started: steps %d-%d\n", lowBound, highBound);
+}
+
+void motion_search_abort() {
+    if (state == MS_IDLE || state == MS_DONE) return;
+
+    finishSearch(false);
+    Serial.println("Motion search aborted");
+}
+
+void motion_search_process() {
+    if (state == MS_IDLE || state == MS_DONE) return;
+
+    unsigned long elapsed = millis() - stateEnteredMs;
+
+    switch (state) {
+        case MS_BASELINE:
+            // Wait for the stopped-loco vibration capture
+            if (!vibration_is_capturing()) {
+                baselineRms = vibration_get_rms();
+                Serial.printf("Motion search: baseline vib rms=%.1f, load=%.1fg\n",
+                              baselineRms, baselineGrams);
+                beginDirection(true);
+            }
+            break;
+
+        case MS_DIRECTION:
+            if (elapsed >= 500) {
+                beginProbe();
+            }
+            break;
+
+        case MS_PROBING: {
+            // Start the vibration window once the motor has had time to spin up
+            if (!vibStarted && elapsed >= MOTION_SPINUP_MS && !vibration_is_capturing()) {
+                vibration_start_capture(VIBRATION_CAPTURE_MS);
+                vibStarted = true;
+            }
+
+            MotionSource src = detectOnset();
+            bool windowOver = elapsed >= MOTION_PROBE_MS &&
+                              (!vibStarted || !vibration_is_capturing());
+            if (src == SRC_NONE && !windowOver) {
+                break;  // Keep watching
+            }
+
+            stopLoco();
+            sensor_disarm();
+            recordProbe(src, elapsed);
+            if (src != SRC_NONE) {
+                best = probeStep;
+                high = probeStep - 1;  // Try lower
+            } else {
+                low = probeStep + 1;   // Need more power
+            }
+            enterState(MS_STOPPING);
+            break;
+        }
+
+        case MS_STOPPING:
+            if (elapsed >= MOTION_STOP_MS) {
+                if (low <= high) {
+                    beginProbe();
+                    break;
+                }
+
+                // This direction is done
+                Serial.printf("Motion search: %s threshold step %d\n",
+                              forward ? "forward" : "reverse", best);
+                if (forward) {
+                    forwardStep = best;
+                    beginDirection(false);
+                } else {
+                    reverseStep = best;
+                    finishSearch(true);
+                    Serial.printf("Motion search complete in %lums: forward=%d reverse=%d\n",
+                                  millis() - searchStartMs, forwardStep, reverseStep);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool motion_search_is_running() {
+    return state != MS_IDLE && state != MS_DONE;
+}
+
+String motion_search_build_json() {
+    JsonDocument doc;
+    doc["type"] = "motion_search";
+    doc["complete"] = searchComplete;
+    doc["low_step"] = lowBound;
+    doc["high_step"] = highBound;
+    if (forwardStep > 0) {
+        doc["forward_step"] = forwardStep;
+        doc["forward_throttle_pct"] = serialized(String(forwardStep / 126.0f * 100.0f, 1));
+    }
+    if (reverseStep > 0) {
+        doc["reverse_step"] = reverseStep;
+        doc["reverse_throttle_pct"] = serialized(String(reverseStep / 126.0f * 100.0f, 1));
+    }
+    doc["baseline_vib_rms"] = serialized(String(baselineRms, 1));
+
+    JsonArray arr = doc["probes"].to<JsonArray>();
+    for (int i = 0; i < probeCount; i++) {
+        JsonObject p = arr.add<JsonObject>();
+        p["dir"] = probes[i].forward ? "fwd" : "rev";
+        p["step"] = probes[i].step;
+        p["moved"] = probes[i].source != SRC_NONE;
+        if (probes[i].source != SRC_NONE) {
+            p["via"] = sourceName(probes[i].source);
+            p["onset_ms"] = probes[i].onsetMs;
+        }
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
@@ -2,10 +2,14 @@
 #include "mqtt_log.h"
 #include "config.h"
 #include "sensor_array.h"
+#include "speed_calc.h"
 #include "web_server.h"
 #include "load_cell.h"
 #include "vibration.h"
 #include "audio_capture.h"
+#include "speed_sweep.h"
+#include "motion_search.h"
+#include "momentum_profile.h"
 
 #include <WiFi.h>
 #include <PubSubClient.h>
@@ -27,6 +31,10 @@ static float throttleSpeed = 0.0f;
 static bool throttleForward = true;
 static String lastThrottleStatus = "";
 
+// Speed command / bridge acknowledgement times (timebase_now_us())
+static uint64_t speedCommandUs = 0;
+static uint64_t speedAckUs = 0;
+
 // Build a full sensor topic: {prefix}/speed-cal/{name}/{suffix}
 static String buildTopic(const char* suffix) {
     char buf[128];
@@ -58,6 +66,7 @@ static void parseThrottleStatus(const String& status) {
         throttleAcquired = false;
     } else if (status.startsWith("SPEED")) {
         // "SPEED 0.500"
+        speedAckUs = timebase_now_us();
         int space = status.indexOf(' ');
         if (space > 0) {
             throttleSpeed = constrain(status.substring(space + 1).toFloat(), 0.0f, 1.0f);
@@ -67,6 +76,7 @@ static void parseThrottleStatus(const String& status) {
     } else if (status == "REVERSE") {
         throttleForward = false;
     } else if (status == "STOPPED") {
+        speedAckUs = timebase_now_us();
         throttleSpeed = 0.0f;
     } else if (status == "ESTOPPED") {
         throttleSpeed = 0.0f;
@@ -89,6 +99,52 @@ static void mqttCallback(char* topic, byte* payload, unsigned int length) {
         logInfo("MQTT: Armed");
         web_send_status();
         mqtt_publish_status("");
+    } else if (topicStr == buildTopic("stream")) {
+        // Payload "off" (or "0") stops streaming; anything else starts it
+        bool en = !(length > 0 && (payload[0] == '0' ||
+                    (length >= 3 && strncasecmp((const char*)payload, "off", 3) == 0)));
+        sensor_set_streaming(en);
+        logInfof("MQTT: Streaming %s", en ? "on" : "off");
+        web_send_status();
+    } else if (topicStr == buildTopic("scale")) {
+        char buf[8];
+        unsigned int copyLen = length < sizeof(buf) - 1 ? length : sizeof(buf) - 1;
+        memcpy(buf, payload, copyLen);
+        buf[copyLen] = '\0';
+        ScaleId scale;
+        if (speed_scale_from_name(buf, scale)) {
+            speed_set_scale(scale);
+            logInfof("MQTT: Scale %s", speed_scale_name(scale));
+        } else {
+            logWarnf("MQTT: Unknown scale '%s'", buf);
+        }
+        web_send_status();
+    } else if (topicStr == buildTopic("early_stop")) {
+        // Payload "<intervals> [tolerance %]", "0" disables
+        char buf[24];
+        unsigned int copyLen = length < sizeof(buf) - 1 ? length : sizeof(buf) - 1;
+        memcpy(buf, payload, copyLen);
+        buf[copyLen] = '\0';
+        int intervals = 0;
+        float tolPct = 0;
+        sscanf(buf, "%d %f", &intervals, &tolPct);
+        sensor_set_early_stop(intervals, tolPct / 100.0f);
+        logInfof("MQTT: Early stop %d intervals, +/-%.1f%%", sensor_get_early_stop_intervals(),
+                 sensor_get_early_stop_tolerance() * 100.0f);
+        web_send_status();
+    } else if (topicStr == buildTopic("order/set")) {
+        // Payload "<wheel mm> [mesh order]", "0" disables order tracking
+        char buf[24];
+        unsigned int copyLen = length < sizeof(buf) - 1 ? length : sizeof(buf) - 1;
+        memcpy(buf, payload, copyLen);
+        buf[copyLen] = '\0';
+        float wheelMm = 0;
+        int mesh = 0;
+        sscanf(buf, "%f %d", &wheelMm, &mesh);
+        vibration_set_order_tracking(wheelMm, mesh);
+        logInfof("MQTT: Order tracking wheel %.2fmm, mesh order %d", vibration_get_wheel_dia_mm(),
+                 vibration_get_mesh_order());
+        web_send_status();
     } else if (topicStr == buildTopic("stop")) {
         sensor_disarm();
         Serial.println("MQTT: Disarmed");
@@ -104,12 +160,58 @@ static void mqttCallback(char* topic, byte* payload, unsigned int length) {
         Serial.println("MQTT: Load requested");
         web_send_load();
     } else if (topicStr == buildTopic("vibration")) {
-        vibration_start_capture();
+        // Optional payload: capture length in ms
+        char buf[16];
+        unsigned int copyLen = length < sizeof(buf) - 1 ? length : sizeof(buf) - 1;
+        memcpy(buf, payload, copyLen);
+        buf[copyLen] = '\0';
+        unsigned long ms = VIBRATION_CAPTURE_MS;
+        sscanf(buf, "%lu", &ms);
+        vibration_start_capture(ms);
         Serial.println("MQTT: Vibration capture started");
     } else if (topicStr == buildTopic("audio")) {
         audio_start_capture();
         Serial.println("MQTT: Audio capture started");
 
+    // --- Speed sweep ---
+    } else if (topicStr == buildTopic("sweep/start")) {
+        char buf[256];
+        unsigned int copyLen = length < sizeof(buf) - 1 ? length : sizeof(buf) - 1;
+        memcpy(buf, payload, copyLen);
+        buf[copyLen] = '\0';
+        speed_sweep_start(speed_sweep_params_from_json(buf));
+        logInfo("MQTT: Sweep start");
+    } else if (topicStr == buildTopic("sweep/abort")) {
+        speed_sweep_abort();
+        logInfo("MQTT: Sweep abort");
+
+    // --- Start-of-motion search ---
+    } else if (topicStr == buildTopic("motion_search/start")) {
+        char buf[64];
+        unsigned int copyLen = length < sizeof(buf) - 1 ? length : sizeof(buf) - 1;
+        memcpy(buf, payload, copyLen);
+        buf[copyLen] = '\0';
+        // Optional "low high" step range
+        int lowStep = 0, highStep = 0;
+        sscanf(buf, "%d %d", &lowStep, &highStep);
+        motion_search_start(lowStep, highStep);
+        logInfo("MQTT: Motion search start");
+    } else if (topicStr == buildTopic("motion_search/abort")) {
+        motion_search_abort();
+        logInfo("MQTT: Motion search abort");
+
+    // --- Momentum profiling ---
+    } else if (topicStr == buildTopic("momentum/start")) {
+        char buf[128];
+        unsigned int copyLen = length < sizeof(buf) - 1 ? length : sizeof(buf) - 1;
+        memcpy(buf, payload, copyLen);
+        buf[copyLen] = '\0';
+        momentum_start(momentum_params_from_json(buf));
+        logInfo("MQTT: Momentum profile start");
+    } else if (topicStr == buildTopic("momentum/abort")) {
+        momentum_abort();
+        logInfo("MQTT: Momentum profile abort");
+
     // --- Log level control ---
     } else if (topicStr == buildTopic("log/set")) {
         char buf[16];
@@ -150,12 +252,28 @@ static void mqttConnect() {
 
         // Subscribe to sensor command topics
         mqttClient.subscribe(buildTopic("arm").c_str());
+        mqttClient.subscribe(buildTopic("stream").c_str());
+        mqttClient.subscribe(buildTopic("scale").c_str());
+        mqttClient.subscribe(buildTopic("early_stop").c_str());
         mqttClient.subscribe(buildTopic("stop").c_str());
         mqttClient.subscribe(buildTopic("status").c_str());
         mqttClient.subscribe(buildTopic("tare").c_str());
         mqttClient.subscribe(buildTopic("load").c_str());
         mqttClient.subscribe(buildTopic("vibration").c_str());
         mqttClient.subscribe(buildTopic("audio").c_str());
+        mqttClient.subscribe(buildTopic("order/set").c_str());
+
+        // Subscribe to sweep control
+        mqttClient.subscribe(buildTopic("sweep/start").c_str());
+        mqttClient.subscribe(buildTopic("sweep/abort").c_str());
+
+        // Subscribe to start-of-motion search control
+        mqttClient.subscribe(buildTopic("motion_search/start").c_str());
+        mqttClient.subscribe(buildTopic("motion_search/abort").c_str());
+
+        // Subscribe to momentum profiling control
+        mqttClient.subscribe(buildTopic("momentum/start").c_str());
+        mqttClient.subscribe(buildTopic("momentum/abort").c_str());
 
         // Subscribe to log level control
         mqttClient.subscribe(buildTopic("log/set").c_str());
@@ -163,7 +281,7 @@ static void mqttConnect() {
         // Subscribe to throttle bridge status
         mqttClient.subscribe(buildThrottleTopic("status").c_str());
 
-        Serial.printf("MQTT: Subscribed to %s/{arm,stop,status,tare,load,vibration,audio}\n",
+        Serial.printf("MQTT: Subscribed to %s/{arm,stream,scale,early_stop,stop,status,tare,load,vibration,audio}\n",
             (prefix + "/speed-cal/" + deviceName).c_str());
         Serial.printf("MQTT: Subscribed to %s/status\n",
             (prefix + "/speed-cal/" THROTTLE_TOPIC_NAME).c_str());
@@ -248,6 +366,12 @@ void mqtt_publish_result(const String& json) {
     }
 }
 
+void mqtt_publish_interval(const String& json) {
+    if (mqttClient.connected()) {
+        mqttClient.publish(buildTopic("interval").c_str(), json.c_str());
+    }
+}
+
 void mqtt_publish_status(const String& json) {
     if (mqttClient.connected()) {
         mqttClient.publish(buildTopic("status").c_str(), json.c_str());
@@ -272,6 +396,12 @@ void mqtt_publish_vibration(const String& json) {
     }
 }
 
+void mqtt_publish_order(const String& json) {
+    if (mqttClient.connected()) {
+        mqttClient.publish(buildTopic("order").c_str(), json.c_str());
+    }
+}
+
 void mqtt_publish_audio(const String& json) {
     if (mqttClient.connected()) {
         mqttClient.publish(buildTopic("audio").c_str(), json.c_str());
@@ -284,6 +414,36 @@ void mqtt_publish_pull_test(const String& json) {
     }
 }
 
+void mqtt_publish_sweep_step(const String& json) {
+    if (mqttClient.connected()) {
+        mqttClient.publish(buildTopic("sweep_step").c_str(), json.c_str());
+    }
+}
+
+void mqtt_publish_sweep(const String& json) {
+    if (mqttClient.connected()) {
+        mqttClient.publish(buildTopic("sweep").c_str(), json.c_str());
+    }
+}
+
+void mqtt_publish_speed_table(const String& json) {
+    if (mqttClient.connected()) {
+        mqttClient.publish(buildTopic("speed_table").c_str(), json.c_str());
+    }
+}
+
+void mqtt_publish_momentum(const String& json) {
+    if (mqttClient.connected()) {
+        mqttClient.publish(buildTopic("momentum").c_str(), json.c_str());
+    }
+}
+
+void mqtt_publish_motion_search(const String& json) {
+    if (mqttClient.connected()) {
+        mqttClient.publish(buildTopic("motion_search").c_str(), json.c_str());
+    }
+}
+
 void mqtt_publish_track_mode(const String& json) {
     if (mqttClient.connected()) {
         mqttClient.publish(buildTopic("track_mode").c_str(), json.c_str());
@@ -302,6 +462,9 @@ void mqtt_publish_log(const char* msg) {
 
 void mqtt_publish_throttle(const char* suffix, const String& payload) {
     if (mqttClient.connected()) {
+        if (strcmp(suffix, "speed") == 0 || strcmp(suffix, "stop") == 0) {
+            speedCommandUs = timebase_now_us();
+        }
         String topic = buildThrottleTopic(suffix);
         mqttClient.publish(topic.c_str(), payload.c_str(), false);  // retained=false
         Serial.printf("MQTT: Throttle %s: %s\n", suffix, payload.c_str());
@@ -313,3 +476,5 @@ int mqtt_get_throttle_address() { return throttleAddress; }
 float mqtt_get_throttle_speed() { return throttleSpeed; }
 bool mqtt_get_throttle_is_forward() { return throttleForward; }
 String mqtt_get_throttle_status() { return lastThrottleStatus; }
+uint64_t mqtt_get_speed_command_us() { return speedCommandUs; }
+uint64_t mqtt_get_speed_ack_us() { return speedAckUs; }
@@ -0,0 +1,149 @@
+#include "order_track.h"
+
+#include <math.h>
+#include <string.h>
+
+static const double PI_D = 3.14159265358979323846;
+
+void order_decim_reset(OrderDecimator& d, uint16_t* buf, int capacity, int factor) {
+    d.buf = buf;
+    d.capacity = capacity & ~1;
+    d.count = 0;
+    d.factor = (factor > 0) ? factor : 1;
+    d.sum = 0;
+    d.sumCount = 0;
+}
+
+void order_decim_add(OrderDecimator& d, const uint16_t* samples, int n) {
+    if (d.capacity < 2) return;
+    for (int i = 0; i < n; i++) {
+        d.sum += samples[i];
+        if (++d.sumCount < d.factor) continue;
+        d.buf[d.count++] = (uint16_t)((d.sum + d.factor / 2) / d.factor);
+        d.sum = 0;
+        d.sumCount = 0;
+        if (d.count == d.capacity) {
+            // Full: halve the rate
+            for (int j = 0; j < d.count / 2; j++) {
+                d.buf[j] = (uint16_t)((d.buf[2 * j] + d.buf[2 * j + 1] + 1) / 2);
+            }
+            d.count /= 2;
+            d.factor *= 2;
+        }
+    }
+}
+
+float order_decim_rate_hz(const OrderDecimator& d, float inputHz) {
+    return inputHz / d.factor;
+}
+
+float order_decim_offset_s(const OrderDecimator& d, float inputHz) {
+    return 0.5f * (d.factor - 1) / inputHz;
+}
+
+float order_track_revs(float tS, float velocityMmS, float accelMmS2, float wheelDiaMm) {
+    if (wheelDiaMm <= 0) return 0.0f;
+    double x = (double)velocityMmS * tS + 0.5 * (double)accelMmS2 * tS * tS;
+    return (float)(x / (PI_D * wheelDiaMm));
+}
+
+int order_track_resample(const uint16_t* samples, int count, float sampleHz, float t0S,
+                         float velocityMmS, float accelMmS2, float wheelDiaMm,
+                         int perRev, float* out, int maxOut) {
+    if (count < 2 || sampleHz <= 0 || wheelDiaMm <= 0 || perRev < 2) return 0;
+
+    // Whole revolutions covered while the wheel keeps moving forwards
+    double circ = PI_D * wheelDiaMm;
+    double r0 = ((double)velocityMmS * t0S + 0.5 * (double)accelMmS2 * t0S * t0S) / circ;
+    double lastRev = 0;
+    int usable = 1;
+    for (int i = 1; i < count; i++) {
+        double t = t0S + i / (double)sampleHz;
+        double r = ((double)velocityMmS * t + 0.5 * (double)accelMmS2 * t * t) / circ - r0;
+        if (r <= lastRev) break;
+        lastRev = r;
+        usable = i + 1;
+    }
+    int revs = (int)lastRev;
+    if (revs > maxOut / perRev) revs = maxOut / perRev;
+    if (revs < 1) return 0;
+    int n = revs * perRev;
+
+    // Boxcar-average the input over each 1/perRev of a revolution
+    int bin = 0;
+    double sum = 0;
+    int binCount = 0;
+    for (int i = 0; i < usable; i++) {
+        double t = t0S + i / (double)sampleHz;
+        double r = ((double)velocityMmS * t + 0.5 * (double)accelMmS2 * t * t) / circ - r0;
+        int j = (int)(r * perRev);
+        if (j != bin) {
+            if (binCount == 0 || j != bin + 1) return 0;   // Too few samples per revolution
+            out[bin] = (float)(sum / binCount);
+            if (j >= n) break;
+            bin = j;
+            sum = 0;
+            binCount = 0;
+        }
+        sum += samples[i];
+        binCount++;
+    }
+    if (bin < n - 1) return 0;
+    if (bin == n - 1) {
+        // Capture ended inside the last bin
+        if (binCount == 0) return 0;
+        out[bin] = (float)(sum / binCount);
+    }
+
+    double mean = 0;
+    for (int j = 0; j < n; j++) mean += out[j];
+    mean /= n;
+    for (int j = 0; j < n; j++) out[j] -= (float)mean;
+    return n;
+}
+
+float order_track_amplitude(const float* x, int n, int perRev, int order) {
+    if (n < 1 || perRev < 1 || order < 0) return 0.0f;
+    // Single DFT bin: `order` cycles per perRev samples
+    double re = 0, im = 0;
+    double w = 2.0 * PI_D * order / perRev;
+    for (int j = 0; j < n; j++) {
+        re += x[j] * cos(w * j);
+        im -= x[j] * sin(w * j);
+    }
+    double scale = (order == 0 || 2 * order == perRev) ? 1.0 : 2.0;
+    return (float)(scale * sqrt(re * re + im * im) / n);
+}
+
+bool order_track_analyse(const uint16_t* samples, int count, float sampleHz, float t0S,
+                         float velocityMmS, float accelMmS2, float wheelDiaMm,
+                         int meshOrder, int perRev, float* scratch, int maxScratch,
+                         OrderResult& out) {
+    memset(&out, 0, sizeof(out));
+    out.samplesPerRev = perRev;
+    int n = order_track_resample(samples, count, sampleHz, t0S, velocityMmS, accelMmS2,
+                                 wheelDiaMm, perRev, scratch, maxScratch);
+    if (n == 0) return false;
+
+    double sumSq = 0;
+    for (int j = 0; j < n; j++) sumSq += (double)scratch[j] * scratch[j];
+    float meanSq = (float)(sumSq / n);
+
+    float tMid = t0S + 0.5f * (count - 1) / sampleHz;
+    out.revHz = (velocityMmS + accelMmS2 * tMid) / (float)(PI_D * wheelDiaMm);
+    out.revs = n / perRev;
+    out.totalRms = sqrtf(meanSq);
+    out.amp1x = order_track_amplitude(scratch, n, perRev, 1);
+    out.amp2x = order_track_amplitude(scratch, n, perRev, 2);
+    if (meshOrder > 0 && 2 * meshOrder < perRev) {
+        out.ampMesh = order_track_amplitude(scratch, n, perRev, meshOrder);
+    }
+    // A sinusoid of amplitude A carries A^2 / 2 of the mean square
+    if (meanSq > 0) {
+        out.frac1x = 0.5f * out.amp1x * out.amp1x / meanSq;
+        out.frac2x = 0.5f * out.amp2x * out.amp2x / meanSq;
+        out.fracMesh = 0.5f * out.ampMesh * out.ampMesh / meanSq;
+    }
+    out.valid = true;
+    return true;
+}
@@ -0,0 +1,101 @@
+#include "pass_stats.h"
+#include "student_t.h"
+
+#include <math.h>
+#include <string.h>
+
+// MAD → standard deviation for normally distributed data
+static const float MAD_TO_SIGMA = 1.4826f;
+
+// Median of n values (n <= PASS_STATS_MAX). Sorts a local copy.
+static float medianOf(const float* v, int n) {
+    float tmp[PASS_STATS_MAX];
+    memcpy(tmp, v, n * sizeof(float));
+    // Insertion sort: n is a handful of passes
+    for (int i = 1; i < n; i++) {
+        float x = tmp[i];
+        int j = i - 1;
+        while (j >= 0 && tmp[j] > x) {
+            tmp[j + 1] = tmp[j];
+            j--;
+        }
+        tmp[j + 1] = x;
+    }
+    return (n % 2) ? tmp[n / 2] : 0.5f * (tmp[n / 2 - 1] + tmp[n / 2]);
+}
+
+// Re-derive median/MAD, inlier flags and Welford mean/variance.
+static void update(PassStats& s) {
+    int n = s.count;
+    s.median = medianOf(s.values, n);
+
+    float dev[PASS_STATS_MAX];
+    for (int i = 0; i < n; i++) {
+        dev[i] = fabsf(s.values[i] - s.median);
+    }
+    s.mad = medianOf(dev, n);
+
+    // Rejection needs a majority to define "normal": with fewer than three
+    // passes, keep everything. Identical passes give MAD = 0, so the
+    // threshold has a floor relative to the median.
+    float threshold = PASS_STATS_REJECT_K * MAD_TO_SIGMA * s.mad;
+    float floor = PASS_STATS_MIN_SPREAD * fabsf(s.median);
+    if (threshold < floor) threshold = floor;
+
+    double mean = 0, m2 = 0;
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+        s.inlier[i] = (n < 3) || (dev[i] <= threshold);
+        if (!s.inlier[i]) continue;
+        // Welford update
+        k++;
+        double delta = s.values[i] - mean;
+        mean += delta / k;
+        m2 += delta * (s.values[i] - mean);
+    }
+    s.inliers = k;
+    s.mean = (float)mean;
+    s.variance = (k > 1) ? (float)(m2 / (k - 1)) : 0.0f;
+}
+
+void pass_stats_reset(PassStats& s) {
+    memset(&s, 0, sizeof(s));
+}
+
+bool pass_stats_add(PassStats& s, float value, float ci95) {
+    if (s.count >= PASS_STATS_MAX) {
+        return false;
+    }
+    s.values[s.count++] = value;
+    s.lastCi95 = ci95;
+    update(s);
+    return s.inlier[s.count - 1];
+}
+
+float pass_stats_stddev(const PassStats& s) {
+    return sqrtf(s.variance);
+}
+
+float pass_stats_ci95(const PassStats& s) {
+    if (s.inliers < 2) {
+        return 0.0f;
+    }
+    return student_t95(s.inliers - 1) * sqrtf(s.variance / s.inliers);
+}
+
+int pass_stats_rejected(const PassStats& s) {
+    return s.count - s.inliers;
+}
+
+bool pass_stats_converged(const PassStats& s, float relTarget, int minPasses) {
+    if (minPasses < 1) minPasses = 1;
+    if (s.inliers < minPasses || s.inliers == 0 || relTarget <= 0) {
+        return false;
+    }
+    float limit = relTarget * fabsf(s.mean);
+    if (s.inliers == 1) {
+        // Single pass: trust its own fit confidence, if it has one
+        return s.lastCi95 > 0 && s.lastCi95 <= limit;
+    }
+    return pass_stats_ci95(s) <= limit;
+}
@@ -0,0 +1,33 @@
+#include "pull_ramp.h"
+
+#include <math.h>
+
+int pull_ramp_bin(int step, int stepInc) {
+    if (stepInc < 1) stepInc = 1;
+    if (step < 1) step = 1;
+    return (step - 1) / stepInc;
+}
+
+int pull_ramp_bin_step(int bin, int stepInc) {
+    if (stepInc < 1) stepInc = 1;
+    int step = (bin + 1) * stepInc;
+    return step > 126 ? 126 : step;
+}
+
+bool pull_ramp_plateau(const float* binGrams, int n, int holdBins, float relTol,
+                       float minPeak) {
+    if (n < 1) return false;
+
+    // Small gains after the peak (noise, creep) do not restart the hold
+    float peak = binGrams[0];
+    int riseBin = 0;
+    for (int i = 1; i < n; i++) {
+        if (binGrams[i] > peak + relTol * fabsf(peak)) {
+            riseBin = i;
+        }
+        if (binGrams[i] > peak) {
+            peak = binGrams[i];
+        }
+    }
+    return peak >= minPeak && (n - 1 - riseBin) >= holdBins;
+}
@@ -5,6 +5,11 @@
 #include "audio_capture.h"
 #include "mqtt_manager.h"
 #include "track_switch.h"
+#include "timebase.h"
+#include "pull_ramp.h"
+#include "speed_sweep.h"
+#include "motion_search.h"
+#include "momentum_profile.h"
 
 #include <ArduinoJson.h>
 
@@ -14,25 +19,34 @@ enum PullTestState {
     PT_IDLE,
     PT_TARING,
     PT_SETTLING,
-    PT_VIB_CAPTURE,    // Vibration capture in progress
-    PT_AUDIO_CAPTURE,  // Audio capture in progress
+    PT_CAPTURE,        // Vibration and audio captures in progress (load cell streaming)
     PT_READING,
+    PT_RAMP,           // Ramp mode: throttle climbing, everything streaming into bins
     PT_DONE
 };
 
 struct PullTestEntry {
     int speedStep;
     float throttlePct;
-    float pullGrams;
+    float pullGrams;        // Window mean (EMA value if the window was empty)
+    WindowStats load;       // Load cell window ending at the reading
+    unsigned long settleMs; // Speed change to settled (auto) or the fixed wait
+    bool settled;           // Auto settle detected steady load (false: cap reached)
     uint16_t vibPeakToPeak;
     float vibRms;
+    float vibPeakHz;        // Strongest vibration spectral peak
+    float vibCentroidHz;
+    uint8_t vibSpectrumDb[VIBRATION_SPECTRUM_BANDS];  // Compact spectrum (see vibration.h)
     float audioRmsDb;
     float audioPeakDb;
 };
 
 // Configuration
 static int stepInc = 5;
-static unsigned long settleMs = 3000;
+static unsigned long settleMs = 3000;  // Fixed wait, or the cap with autoSettle
+static bool autoSettle = true;
+static bool rampMode = false;
+static float rampRate = PULL_RAMP_STEPS_PER_S;   // Steps per second
 
 // State
 static PullTestState state = PT_IDLE;
@@ -41,6 +55,17 @@ static int currentStep = 0;          // Current DCC speed step being tested
 static int currentStepNum = 0;       // 1-based index into sequence
 static int totalSteps = 0;
 static bool testComplete = false;
+static uint64_t stepStartUs = 0;     // Speed command for the current step
+static uint64_t steadyFromUs = 0;    // Reading window starts no earlier than this
+static uint64_t steadySinceUs = 0;   // Start of the current run of steady windows (0: none)
+static unsigned long stepSettleMs = 0;
+static bool stepSettled = false;
+
+// Ramp state (one bin per entry, bins are consecutive in time)
+static unsigned long rampStepMs = 500;
+static unsigned long lastRampStepMs = 0;
+static bool stalled = false;
+static int stallStep = 0;
 
 // Results
 static const int MAX_ENTRIES = 128;
@@ -48,6 +73,9 @@ static PullTestEntry entries[MAX_ENTRIES];
 static int entryCount = 0;
 static float peakGrams = 0.0f;
 static int peakStep = 0;
+static uint64_t binStartUs[MAX_ENTRIES];
+static int binVibCount[MAX_ENTRIES];
+static int binAudioCount[MAX_ENTRIES];
 
 // --- Helpers ---
 
@@ -56,6 +84,7 @@ static void setSpeed(int step) {
     char buf[16];
     snprintf(buf, sizeof(buf), "%.3f", throttle);
     mqtt_publish_throttle("speed", String(buf));
+    stepStartUs = timebase_now_us();
 }
 
 static void stopLoco() {
@@ -96,25 +125,140 @@ static int countSteps() {
     return count;
 }
 
+// Auto settle: the last PULL_SETTLE_WINDOW_MS of load since the speed
+// change is steady, and either the load has moved off the previous step's
+// reading or it has stayed steady for a second full window (the first
+// steady window can be the old plateau before the loco responds). On
+// success steadyFromUs is the window start.
+static bool loadSteady() {
+    // Only re-test when the load cell has a new sample
+    static uint64_t lastSampleUs = 0;
+    if (load_cell_get_sample_us() == lastSampleUs) return false;
+    lastSampleUs = load_cell_get_sample_us();
+
+    uint64_t nowUs = timebase_now_us();
+    uint64_t windowUs = (uint64_t)PULL_SETTLE_WINDOW_MS * 1000;
+    if (nowUs < stepStartUs + windowUs) return false;
+
+    WindowStats w;
+    if (!load_cell_window_stats(nowUs - windowUs, nowUs, w) ||
+        w.count < PULL_SETTLE_MIN_SAMPLES) {
+        return false;
+    }
+    if (!window_stats_steady(w, PULL_SETTLE_MAX_SLOPE, PULL_SETTLE_MAX_SD, PULL_SETTLE_REL_TOL)) {
+        steadySinceUs = 0;
+        return false;
+    }
+    if (steadySinceUs < stepStartUs) steadySinceUs = nowUs - windowUs;
+
+    // Previous step's reading (0 after the tare for the first step)
+    float prevGrams = (entryCount > 0) ? entries[entryCount - 1].pullGrams : 0.0f;
+    float minChange = PULL_SETTLE_REL_TOL * fabsf(prevGrams);
+    if (minChange < PULL_SETTLE_MIN_CHANGE) minChange = PULL_SETTLE_MIN_CHANGE;
+    bool moved = fabsf(w.mean - prevGrams) > minChange;
+    if (!moved && nowUs < steadySinceUs + 2 * windowUs) return false;
+
+    steadyFromUs = nowUs - windowUs;
+    return true;
+}
+
+// --- Ramp bins ---
+
+// Open a bin for currentStep as a new entry.
+static void openBin() {
+    if (entryCount >= MAX_ENTRIES) return;
+    PullTestEntry& e = entries[entryCount];
+    memset(&e, 0, sizeof(e));
+    e.speedStep = pull_ramp_bin_step(pull_ramp_bin(currentStep, stepInc), stepInc);
+    e.throttlePct = (float)e.speedStep / 126.0f * 100.0f;
+    binStartUs[entryCount] = timebase_now_us();
+    binVibCount[entryCount] = 0;
+    binAudioCount[entryCount] = 0;
+    entryCount++;
+    currentStepNum = entryCount;
+}
+
+// Close the open bin: load statistics over everything it spanned.
+static void closeBin() {
+    if (entryCount == 0) return;
+    PullTestEntry& e = entries[entryCount - 1];
+    e.pullGrams = load_cell_window_stats(binStartUs[entryCount - 1], timebase_now_us(), e.load)
+        ? e.load.mean : load_cell_get_grams();
+
+    if (e.pullGrams > peakGrams) {
+        peakGrams = e.pullGrams;
+        peakStep = e.speedStep;
+    }
+    Serial.printf("Pull ramp: step %d = %.1fg (sd %.1f, slope %.2fg/s, n=%d)\n",
+                  e.speedStep, e.pullGrams, e.load.stddev, e.load.slopePerS, e.load.count);
+}
+
+// Entry whose bin was open at time t.
+static int binAt(uint64_t tUs) {
+    for (int i = entryCount - 1; i > 0; i--) {
+        if (binStartUs[i] <= tUs) return i;
+    }
+    return 0;
+}
+
+// Fold a finished capture into the bin open at its midpoint.
+static void addVibration() {
+    if (entryCount == 0 || !vibration_has_result()) return;
+    int i = binAt(vibration_get_start_us() + (vibration_get_end_us() - vibration_get_start_us()) / 2);
+    PullTestEntry& e = entries[i];
+    int n = ++binVibCount[i];
+    e.vibRms += (vibration_get_rms() - e.vibRms) / n;
+    if (vibration_get_peak_to_peak() > e.vibPeakToPeak) e.vibPeakToPeak = vibration_get_peak_to_peak();
+    // Spectrum: running mean of the band levels, peak from the latest capture
+    uint8_t spec[VIBRATION_SPECTRUM_BANDS];
+    vibration_get_spectrum_db(spec);
+    for (int b = 0; b < VIBRATION_SPECTRUM_BANDS; b++) {
+        e.vibSpectrumDb[b] = (uint8_t)lroundf(e.vibSpectrumDb[b] + (spec[b] - e.vibSpectrumDb[b]) / (float)n);
+    }
+    e.vibCentroidHz += (vibration_get_centroid_hz() - e.vibCentroidHz) / n;
+    e.vibPeakHz = vibration_get_peak_hz();
+}
+
+static void addAudio() {
+    if (entryCount == 0 || !audio_has_result()) return;
+    int i = binAt(audio_get_start_us() + (audio_get_end_us() - audio_get_start_us()) / 2);
+    PullTestEntry& e = entries[i];
+    int n = ++binAudioCount[i];
+    e.audioRmsDb += (audio_get_rms_db() - e.audioRmsDb) / n;
+    if (n == 1 || audio_get_peak_db() > e.audioPeakDb) e.audioPeakDb = audio_get_peak_db();
+}
+
+static bool rampPlateau() {
+    float grams[MAX_ENTRIES];
+    for (int i = 0; i < entryCount; i++) grams[i] = entries[i].pullGrams;
+    return pull_ramp_plateau(grams, entryCount, PULL_RAMP_PLATEAU_BINS,
+                             PULL_RAMP_PLATEAU_REL, PULL_RAMP_MIN_PEAK_G);
+}
+
 // --- Public API ---
 
-void pull_test_start(int step_inc, unsigned long settle_ms) {
-    if (state != PT_IDLE) return;
+// Preconditions and reset shared by both modes. False if not started.
+static bool beginTest(int step_inc) {
+    if (state != PT_IDLE && state != PT_DONE) return false;
+    // The other test modes drive the same loco
+    if (speed_sweep_is_running() || motion_search_is_running() || momentum_is_running()) {
+        Serial.println("Pull test: another test mode is running");
+        return false;
+    }
     if (!load_cell_is_ready()) {
         Serial.println("Pull test: load cell not ready");
-        return;
+        return false;
     }
     if (!mqtt_get_throttle_acquired()) {
         Serial.println("Pull test: throttle not acquired");
-        return;
+        return false;
     }
     if (!track_switch_allow_dcc_test()) {
         Serial.println("Pull test: blocked by track switch (not in DCC programming mode)");
-        return;
+        return false;
     }
 
     stepInc = step_inc > 0 ? step_inc : 5;
-    settleMs = settle_ms > 0 ? settle_ms : 3000;
 
     // Reset results
     entryCount = 0;
@@ -123,6 +267,8 @@ void pull_test_start(int step_inc, unsigned long settle_ms) {
     currentStep = 0;
     currentStepNum = 0;
     testComplete = false;
+    stalled = false;
+    stallStep = 0;
 
     totalSteps = countSteps();
 
@@ -131,15 +277,34 @@ void pull_test_start(int step_inc, unsigned long settle_ms) {
 
     state = PT_TARING;
     stateEnteredMs = millis();
+    return true;
+}
+
+void pull_test_start(int step_inc, unsigned long settle_ms, bool auto_settle) {
+    if (!beginTest(step_inc)) return;
+    settleMs = settle_ms > 0 ? settle_ms : 3000;
+    autoSettle = auto_settle;
+    rampMode = false;
 
-    Serial.printf("Pull test started: inc=%d, settle=%lums, %d steps\n",
-                  stepInc, settleMs, totalSteps);
+    Serial.printf("Pull test started: inc=%d, settle=%lums%s, %d steps\n",
+                  stepInc, settleMs, autoSettle ? " max (auto)" : "", totalSteps);
+}
+
+void pull_test_start_ramp(int step_inc, float steps_per_s) {
+    if (!beginTest(step_inc)) return;
+    rampRate = steps_per_s > 0 ? constrain(steps_per_s, 0.1f, 20.0f) : PULL_RAMP_STEPS_PER_S;
+    rampStepMs = (unsigned long)(1000.0f / rampRate);
+    rampMode = true;
+
+    Serial.printf("Pull ramp started: inc=%d, %.1f steps/s, %d bins\n",
+                  stepInc, rampRate, totalSteps);
 }
 
 void pull_test_abort() {
     if (state == PT_IDLE || state == PT_DONE) return;
 
     stopLoco();
+    if (state == PT_RAMP) closeBin();
     testComplete = false;
     state = PT_DONE;
 
@@ -170,42 +335,102 @@ void pull_test_process() {
                 }
                 currentStepNum = 1;
 
+                if (rampMode) {
+                    // Ramp: climb from step 1, vibration and audio each
+                    // capturing back to back
+                    currentStep = 1;
+                    setSpeed(currentStep);
+                    openBin();
+                    lastRampStepMs = now;
+                    vibration_start_capture(VIBRATION_CAPTURE_MS);
+                    audio_start_capture();
+                    state = PT_RAMP;
+                    stateEnteredMs = now;
+                    break;
+                }
+
                 setSpeed(currentStep);
                 state = PT_SETTLING;
                 stateEnteredMs = now;
             }
             break;
 
-        case PT_SETTLING:
-            if (elapsed >= settleMs) {
-                // Start vibration capture before reading
-                vibration_start_capture();
-                state = PT_VIB_CAPTURE;
-                stateEnteredMs = now;
+        case PT_RAMP: {
+            // Both were started with the ramp, so idle means just finished
+            if (!vibration_is_capturing()) {
+                addVibration();
+                vibration_start_capture(VIBRATION_CAPTURE_MS);
+            }
+            if (!audio_is_capturing()) {
+                addAudio();
+                audio_start_capture();
+            }
+
+            if (now - lastRampStepMs < rampStepMs) break;
+            lastRampStepMs += rampStepMs;
+
+            int next = currentStep + 1;
+            bool newBin = next > 126 ||
+                pull_ramp_bin(next, stepInc) != pull_ramp_bin(currentStep, stepInc);
+            if (newBin) {
+                closeBin();
+                if (rampPlateau()) {
+                    stalled = true;
+                    stallStep = currentStep;
+                }
+                if (stalled || next > 126) {
+                    stopLoco();
+                    testComplete = true;
+                    state = PT_DONE;
+                    Serial.printf("Pull ramp %s: %d bins, peak=%.1fg at step %d\n",
+                                  stalled ? "stopped at plateau" : "complete",
+                                  entryCount, peakGrams, peakStep);
+                    break;
+                }
             }
+            currentStep = next;
+            setSpeed(currentStep);
+            if (newBin) openBin();
             break;
+        }
 
-        case PT_VIB_CAPTURE:
-            // Wait for vibration capture to complete (driven by vibration_process() in main loop)
-            if (!vibration_is_capturing()) {
-                // Start audio capture next
+        case PT_SETTLING: {
+            bool steady = autoSettle && loadSteady();
+            if (steady || elapsed >= settleMs) {
+                stepSettleMs = elapsed;
+                stepSettled = steady;
+                if (!steady) steadyFromUs = stepStartUs;
+                // One capture phase: piezo ADC and I2S are independent, and
+                // the load cell streams throughout
+                vibration_start_capture(VIBRATION_CAPTURE_MS);
                 audio_start_capture();
-                state = PT_AUDIO_CAPTURE;
+                state = PT_CAPTURE;
                 stateEnteredMs = now;
             }
             break;
+        }
 
-        case PT_AUDIO_CAPTURE:
-            // Wait for audio capture to complete (driven by audio_process() in main loop)
-            if (!audio_is_capturing()) {
+        case PT_CAPTURE:
+            // Both captures are driven by vibration_process() and
+            // audio_process() in the main loop; read once both are done
+            if (!vibration_is_capturing() && !audio_is_capturing()) {
                 state = PT_READING;
                 stateEnteredMs = now;
             }
             break;
 
         case PT_READING: {
-            // Read load cell, vibration, and audio results
-            float grams = load_cell_get_grams();
+            // Load cell: the last PULL_STATS_WINDOW_MS of raw samples (the
+            // capture phase and the steady time before it), never reaching
+            // back before the load settled (or the speed change, if it was
+            // a fixed wait)
+            uint64_t nowUs = timebase_now_us();
+            uint64_t windowUs = (uint64_t)PULL_STATS_WINDOW_MS * 1000;
+            uint64_t fromUs = nowUs > windowUs ? nowUs - windowUs : 0;
+            if (fromUs < steadyFromUs) fromUs = steadyFromUs;
+            WindowStats load;
+            float grams = load_cell_window_stats(fromUs, nowUs, load)
+                ? load.mean : load_cell_get_grams();
             float pct = (float)currentStep / 126.0f * 100.0f;
 
             // Get vibration results from the just-completed capture
@@ -221,8 +446,14 @@ void pull_test_process() {
                 entries[entryCount].speedStep = currentStep;
                 entries[entryCount].throttlePct = pct;
                 entries[entryCount].pullGrams = grams;
+                entries[entryCount].load = load;
+                entries[entryCount].settleMs = stepSettleMs;
+                entries[entryCount].settled = stepSettled;
                 entries[entryCount].vibPeakToPeak = vibPP;
                 entries[entryCount].vibRms = vibRms;
+                entries[entryCount].vibPeakHz = vibration_get_peak_hz();
+                entries[entryCount].vibCentroidHz = vibration_get_centroid_hz();
+                vibration_get_spectrum_db(entries[entryCount].vibSpectrumDb);
                 entries[entryCount].audioRmsDb = audRmsDb;
                 entries[entryCount].audioPeakDb = audPeakDb;
                 entryCount++;
@@ -234,8 +465,10 @@ void pull_test_process() {
                 peakStep = currentStep;
             }
 
-            Serial.printf("Pull test: step %d (%.1f%%) = %.1fg, vib p2p=%u rms=%.1f, audio rms=%.1fdB peak=%.1fdB\n",
-                          currentStep, pct, grams, vibPP, vibRms, audRmsDb, audPeakDb);
+            Serial.printf("Pull test: step %d (%.1f%%) = %.1fg (sd %.1f, slope %.2fg/s, n=%d, settle %lums%s), vib p2p=%u rms=%.1f, audio rms=%.1fdB peak=%.1fdB\n",
+                          currentStep, pct, grams, load.stddev, load.slopePerS, load.count,
+                          stepSettleMs, (autoSettle && !stepSettled) ? " cap" : "",
+                          vibPP, vibRms, audRmsDb, audPeakDb);
 
             // Advance to next step
             int next = nextStep(currentStep);
@@ -277,23 +510,62 @@ int pull_test_current_step_num() {
     return currentStepNum;
 }
 
-String pull_test_build_json() {
+String pull_test_build_json(bool includeEntries) {
     JsonDocument doc;
     doc["type"] = "pull_test";
     doc["complete"] = testComplete;
     doc["step_inc"] = stepInc;
-    doc["settle_ms"] = settleMs;
+    doc["mode"] = rampMode ? "ramp" : "step";
+    if (rampMode) {
+        doc["ramp_rate"] = serialized(String(rampRate, 1));
+        doc["stalled"] = stalled;
+        if (stalled) doc["stall_step"] = stallStep;
+    } else {
+        doc["settle_ms"] = settleMs;
+        doc["auto_settle"] = autoSettle;
+    }
     doc["peak_grams"] = serialized(String(peakGrams, 1));
     doc["peak_step"] = peakStep;
 
+    if (!includeEntries) {
+        // Pull curve only, as compact arrays
+        JsonArray steps = doc["steps"].to<JsonArray>();
+        JsonArray grams = doc["grams"].to<JsonArray>();
+        for (int i = 0; i < entryCount; i++) {
+            steps.add(entries[i].speedStep);
+            grams.add(serialized(String(entries[i].pullGrams, 1)));
+        }
+        String json;
+        serializeJson(doc, json);
+        return json;
+    }
+
+    doc["vib_spec_band_hz"] = serialized(String(vibration_get_spectrum_band_hz(), 1));
     JsonArray arr = doc["entries"].to<JsonArray>();
     for (int i = 0; i < entryCount; i++) {
         JsonObject e = arr.add<JsonObject>();
         e["step"] = entries[i].speedStep;
         e["pct"] = serialized(String(entries[i].throttlePct, 1));
         e["grams"] = serialized(String(entries[i].pullGrams, 1));
+        if (!rampMode) {
+            e["settle_ms"] = entries[i].settleMs;
+            if (autoSettle) e["settled"] = entries[i].settled;
+        }
+        const WindowStats& w = entries[i].load;
+        if (w.count > 0) {
+            e["grams_median"] = serialized(String(w.median, 1));
+            e["grams_sd"] = serialized(String(w.stddev, 2));
+            e["grams_min"] = serialized(String(w.min, 1));
+            e["grams_max"] = serialized(String(w.max, 1));
+            e["grams_slope"] = serialized(String(w.slopePerS, 2));
+            e["load_n"] = w.count;
+        }
         e["vib_pp"] = entries[i].vibPeakToPeak;
         e["vib_rms"] = serialized(String(entries[i].vibRms, 1));
+        e["vib_peak_hz"] = serialized(String(entries[i].vibPeakHz, 0));
+        e["vib_centroid_hz"] = serialized(String(entries[i].vibCentroidHz, 0));
+        JsonArray spec = e["vib_spec"].to<JsonArray>();
+        for (int b = 0; b < VIBRATION_SPECTRUM_BANDS; b++) spec.add(entries[i].vibSpectrumDb[b]);
         e["aud_rms"] = serialized(String(entries[i].audioRmsDb, 1));
         e["aud_peak"] = serialized(String(entries[i].audioPeakDb, 1));
     }
@@ -0,0 +1,34 @@
+#include "sample_timing.h"
+
+#include <math.h>
+#include <string.h>
+
+void sample_timing_reset(SampleTiming& t, uint32_t nominalUs) {
+    memset(&t, 0, sizeof(t));
+    t.nominalUs = nominalUs;
+}
+
+void sample_timing_add(SampleTiming& t, uint32_t timestampUs) {
+    if (t.count > 0) {
+        uint32_t interval = timestampUs - t.lastUs;
+        uint32_t n = t.count;   // Intervals including this one
+        float delta = (float)interval - t.meanIntervalUs;
+        t.meanIntervalUs += delta / n;
+        t.m2 += delta * ((float)interval - t.meanIntervalUs);
+        t.spanUs += interval;
+        if (interval > t.maxIntervalUs) t.maxIntervalUs = interval;
+        if (t.nominalUs > 0 && interval > t.nominalUs + t.nominalUs / 2) t.late++;
+    }
+    t.lastUs = timestampUs;
+    t.count++;
+}
+
+float sample_timing_rate_hz(const SampleTiming& t) {
+    if (t.count < 2 || t.spanUs == 0) return 0.0f;
+    return (float)(t.count - 1) * 1000000.0f / (float)t.spanUs;
+}
+
+float sample_timing_jitter_us(const SampleTiming& t) {
+    if (t.count < 3) return 0.0f;
+    return sqrtf(t.m2 / (float)(t.count - 2));
+}
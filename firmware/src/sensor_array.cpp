@@ -1,52 +1,193 @@
 #include "sensor_array.h"
 #include "mcp23017.h"
+#include "event_ring.h"
+#include "speed_calc.h"
 
-// --- ISR state (volatile, accessed from ISR and main loop) ---
-static volatile bool isrFired = false;
-static volatile uint32_t isrTimestamp = 0;
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 
-// --- Run state ---
-static RunState state = STATE_IDLE;
+// --- ISR state (ISR produces, sensor task consumes) ---
+// Every MCP23017 interrupt is queued with its timestamp, so edges that
+// arrive while loop() is stalled in networking are delayed, not lost.
+struct SensorEvent {
+    uint64_t timestampUs;  // timebase_now_us() at the INT falling edge
+};
+static EventRing<SensorEvent, SENSOR_EVENT_RING_SIZE> isrEvents;
+
+// --- Run state (owned by the sensor task; arm/disarm take stateLock) ---
+static volatile RunState state = STATE_IDLE;
 static RunResult result;
-static uint32_t armTime = 0;
+static uint64_t armTimeUs = 0;
+static uint64_t lastLeadingUs = 0;  // Most recent block edge (re-trigger guard)
+static uint16_t portState = 0xFFFF; // Last known sensor levels (bit n = sensor n)
+static volatile bool streaming = false;  // Re-arm automatically after each run
+static uint32_t runSequence = 0;         // Completed runs since boot
+static volatile uint32_t resultsDropped = 0;
+
+// Early termination policy (see sensor_set_early_stop)
+static volatile int earlyStopIntervals = EARLY_STOP_INTERVALS;
+static volatile float earlyStopTolerance = EARLY_STOP_TOLERANCE;
+
+// Exit event: last sensor in the direction of travel has cleared
+static bool exitSignalled = false;           // Once per run (task only)
+static volatile bool exitPending = false;    // Set by task, taken by loop()
+static volatile Direction exitDirection = DIR_UNKNOWN;
+
+// --- Task plumbing ---
+static TaskHandle_t sensorTask = NULL;
+static SemaphoreHandle_t stateLock = NULL;  // Guards state, result, armTime
+static QueueHandle_t resultQueue = NULL;    // Completed RunResults → loop()
+static QueueHandle_t intervalQueue = NULL;  // IntervalEvents of the run in progress → loop()
+static bool intervalSent[NUM_SENSORS];      // Per travel-order pair, this run (task only)
 
 void IRAM_ATTR sensor_isr() {
-    isrTimestamp = micros();
-    isrFired = true;
+    SensorEvent ev;
+    ev.timestampUs = timebase_now_us();
+    isrEvents.push(ev);  // Full ring: dropped and counted in overflows()
+
+    // Wake the sensor task directly; it preempts loop() on return from ISR
+    if (sensorTask != NULL) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(sensorTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
 }
 
 void sensor_init() {
     state = STATE_IDLE;
     memset(&result, 0, sizeof(result));
+    if (stateLock == NULL) {
+        stateLock = xSemaphoreCreateMutex();
+    }
 }
 
-void sensor_arm() {
-    // Clear any pending interrupt state on MCP23017
-    mcp23017_read_interrupt();
-    mcp23017_read_sensors();
+// Reset the run and wait for the next pass. Caller holds stateLock.
+static void armLocked() {
+    // Clear any pending interrupt state on MCP23017. Edges are decoded
+    // against the levels seen now, so a sensor already occupied at arm
+    // time does not start a run.
+    uint16_t flags, captured, current;
+    mcp23017_read_interrupt(flags, captured, current);
+    portState = current;
+    lastLeadingUs = 0;
+    exitSignalled = false;
+    memset(intervalSent, 0, sizeof(intervalSent));
 
     // Reset result
     memset(&result, 0, sizeof(result));
     result.direction = DIR_UNKNOWN;
 
-    // Clear ISR flag
-    isrFired = false;
+    // Discard events queued before arming
+    isrEvents.clear();
 
-    armTime = millis();
+    armTimeUs = timebase_now_us();
     state = STATE_ARMED;
 }
 
+// Drop intervals queued for a run that will never complete: they carry
+// runSequence + 1, the sequence the next run gets. Streaming re-arms
+// (armLocked() from the task) keep them, their run did complete.
+static void flushIntervals() {
+    if (intervalQueue != NULL) {
+        xQueueReset(intervalQueue);
+    }
+}
+
+void sensor_arm() {
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    armLocked();
+    flushIntervals();
+    xSemaphoreGive(stateLock);
+
+    // Switch the task from idle blocking to timeout polling
+    if (sensorTask != NULL) {
+        xTaskNotifyGive(sensorTask);
+    }
+}
+
 void sensor_disarm() {
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    streaming = false;
+    exitPending = false;
     state = STATE_IDLE;
-    isrFired = false;
+    isrEvents.clear();
+    flushIntervals();
+    xSemaphoreGive(stateLock);
+}
+
+void sensor_set_streaming(bool enabled) {
+    streaming = enabled;
+    RunState s = state;
+    if (enabled && (s == STATE_IDLE || s == STATE_COMPLETE)) {
+        sensor_arm();
+    }
+}
+
+bool sensor_is_streaming() {
+    return streaming;
+}
+
+void sensor_set_early_stop(int intervals, float tolerance) {
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    earlyStopIntervals = (intervals > 0) ? min(intervals, NUM_SENSORS - 1) : 0;
+    earlyStopTolerance = (tolerance > 0) ? tolerance : EARLY_STOP_TOLERANCE;
+    xSemaphoreGive(stateLock);
+}
+
+int sensor_get_early_stop_intervals() {
+    return earlyStopIntervals;
+}
+
+float sensor_get_early_stop_tolerance() {
+    return earlyStopTolerance;
 }
 
 RunState sensor_get_state() {
     return state;
 }
 
-const RunResult& sensor_get_result() {
-    return result;
+RunResult sensor_get_result() {
+    xSemaphoreTake(stateLock, portMAX_DELAY);
+    RunResult snapshot = result;
+    xSemaphoreGive(stateLock);
+    return snapshot;
+}
+
+bool sensor_take_result(RunResult& out) {
+    if (resultQueue == NULL) {
+        return false;
+    }
+    return xQueueReceive(resultQueue, &out, 0) == pdTRUE;
+}
+
+bool sensor_take_interval(IntervalEvent& out) {
+    if (intervalQueue == NULL) {
+        return false;
+    }
+    return xQueueReceive(intervalQueue, &out, 0) == pdTRUE;
+}
+
+uint32_t sensor_get_event_overflows() {
+    return isrEvents.overflows();
+}
+
+uint32_t sensor_get_event_high_water() {
+    return isrEvents.high_water();
+}
+
+bool sensor_take_exit(Direction& dir) {
+    if (!exitPending) {
+        return false;
+    }
+    dir = exitDirection;
+    exitPending = false;
+    return true;
+}
+
+uint32_t sensor_get_results_dropped() {
+    return resultsDropped;
 }
 
 const char* sensor_state_name(RunState s) {
@@ -59,78 +200,153 @@ const char* sensor_state_name(RunState s) {
     }
 }
 
-bool sensor_update() {
-    if (state == STATE_IDLE || state == STATE_COMPLETE) {
-        return false;
-    }
-
-    // Check timeout
-    if (state == STATE_MEASURING) {
-        if (millis() - result.runStartMillis > DETECTION_TIMEOUT_MS) {
-            state = STATE_COMPLETE;
-            return true;
+// Fill in derived fields and mark the run complete.
+static void finishRun() {
+    uint64_t first = UINT64_MAX, last = 0;
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        if (result.triggered[i]) {
+            if (result.timestamps[i] < first) first = result.timestamps[i];
+            if (result.timestamps[i] > last) last = result.timestamps[i];
         }
+        result.dwellUs[i] = (result.triggered[i] && result.cleared[i])
+            ? (uint32_t)(result.clearTimestamps[i] - result.timestamps[i]) : 0;
     }
+    result.runDurationUs = (result.sensorsTriggered > 0) ? (uint32_t)(last - first) : 0;
 
-    // Process ISR event
-    if (!isrFired) {
-        return false;
+    result.sensorsCleared = 0;
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        if (result.triggered[i] && result.cleared[i]) result.sensorsCleared++;
     }
+    result.sequence = ++runSequence;
+    state = STATE_COMPLETE;
+}
 
-    // Capture ISR data and clear flag
-    uint32_t ts = isrTimestamp;
-    isrFired = false;
+// Record a block (falling) edge on sensor i.
+static void recordBlock(int i, uint64_t ts) {
+    if (result.triggered[i]) {
+        // Re-blocked after clearing: gap between loco and tender (or cars).
+        // The sensor is occupied again; its final clear comes later.
+        result.cleared[i] = false;
+        return;
+    }
 
-    // Settle guard: ignore triggers right after arming
-    if (state == STATE_ARMED && (millis() - armTime < ARM_SETTLE_MS)) {
-        // Read interrupt to clear it, but discard
-        mcp23017_read_interrupt();
-        return false;
+    // Check re-trigger guard
+    if (result.sensorsTriggered > 0 && ts - lastLeadingUs < MIN_RETRIGGER_US) {
+        return;  // Too fast, likely noise
     }
 
-    // Read which sensor(s) triggered — INTCAP has the port state at interrupt time
-    uint8_t captured = mcp23017_read_interrupt();
-    uint8_t sensorMask = (1 << NUM_SENSORS) - 1;
+    // Record this sensor
+    result.triggered[i] = true;
+    result.timestamps[i] = ts;
+    result.sensorsTriggered++;
+    lastLeadingUs = ts;
 
-    // The captured value shows pin states. Sensors read LOW when triggered
-    // (locomotive overhead blocks reflection, pullup goes low).
-    // Invert and mask to get "which sensors are currently detecting".
-    uint8_t active = (~captured) & sensorMask;
+    // First trigger starts the run
+    if (result.sensorsTriggered == 1) {
+        result.runStartUs = ts;
+        state = STATE_MEASURING;
+    }
+}
+
+// Record a clear (rising) edge on sensor i. Only sensors that blocked during
+// this run count; the last clear wins, so dwell spans the whole loco.
+static void recordClear(int i, uint64_t ts) {
+    if (!result.triggered[i]) {
+        return;  // Was already occupied when armed, or filtered as noise
+    }
+    result.clearTimestamps[i] = ts;
+    result.cleared[i] = true;
+}
 
-    // Find newly triggered sensors
+// Apply every level change between portState and newState at time ts.
+static void applyEdges(uint16_t newState, uint64_t ts) {
+    uint16_t changed = (portState ^ newState) & SENSOR_PIN_MASK;
+    portState = newState;
     for (int i = 0; i < NUM_SENSORS; i++) {
-        if (result.triggered[i]) {
-            continue;  // Already recorded
+        if (!(changed & (1u << i))) {
+            continue;
         }
-        if (!(active & (1 << i))) {
-            continue;  // Not triggered now
+        // Sensors read LOW when a locomotive blocks the reflection
+        if (newState & (1u << i)) {
+            recordClear(i, ts);
+        } else {
+            recordBlock(i, ts);
         }
+    }
+}
 
-        // Check re-trigger guard
-        if (result.sensorsTriggered > 0) {
-            uint32_t lastTs = 0;
-            for (int j = 0; j < NUM_SENSORS; j++) {
-                if (result.triggered[j] && result.timestamps[j] > lastTs) {
-                    lastTs = result.timestamps[j];
-                }
-            }
-            if (ts - lastTs < MIN_RETRIGGER_US) {
-                continue;  // Too fast, likely noise
-            }
+// Raise the exit event for this run (once).
+static void signalExit() {
+    if (!exitSignalled) {
+        exitSignalled = true;
+        exitDirection = result.direction;
+        exitPending = true;
+    }
+}
+
+// Queue an event for each adjacent pair (in direction of travel) whose
+// second leading edge has arrived since the last call.
+static void queueIntervals() {
+    if (intervalQueue == NULL || result.direction == DIR_UNKNOWN) {
+        return;
+    }
+    for (int i = 0; i < NUM_SENSORS - 1; i++) {
+        int a = (result.direction == DIR_B_TO_A) ? (NUM_SENSORS - 1 - i) : i;
+        int b = (result.direction == DIR_B_TO_A) ? (a - 1) : (a + 1);
+        if (intervalSent[i] || !result.triggered[a] || !result.triggered[b] ||
+            result.timestamps[b] <= result.timestamps[a]) {
+            continue;
         }
+        intervalSent[i] = true;
 
-        // Record this sensor
-        result.triggered[i] = true;
-        result.timestamps[i] = ts;
-        result.sensorsTriggered++;
+        IntervalEvent ev;
+        ev.sequence = runSequence + 1;
+        ev.direction = result.direction;
+        ev.index = (uint8_t)i;
+        ev.fromSensor = (uint8_t)a;
+        ev.toSensor = (uint8_t)b;
+        ev.intervalUs = (uint32_t)(result.timestamps[b] - result.timestamps[a]);
+        ev.gapMm = fabsf(sensor_position_mm(b) - sensor_position_mm(a));
+        ev.timestampUs = result.timestamps[b];
+        xQueueSend(intervalQueue, &ev, 0);  // Full: dropped, result has it
+    }
+}
 
-        // First trigger starts the run
-        if (result.sensorsTriggered == 1) {
-            result.runStartMillis = millis();
-            state = STATE_MEASURING;
-        }
+// True once every triggered sensor has also cleared.
+static bool allTriggeredCleared() {
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        if (result.triggered[i] && !result.cleared[i]) return false;
+    }
+    return true;
+}
+
+// Handle one queued interrupt: read INTCAP and record block/clear edges.
+// Returns true if this event completed the run.
+static bool processEvent(uint64_t ts) {
+    // One burst returns INTF, INTCAP (port state latched at interrupt time)
+    // and GPIO (state now) for both ports
+    uint16_t flags, captured, current;
+    if (!mcp23017_read_interrupt(flags, captured, current)) {
+        // I2C error: the all-HIGH fallback would read as every sensor
+        // clearing. Leave the run alone; the next interrupt or the
+        // timeout picks it up.
+        return false;
+    }
+    uint64_t readUs = timebase_now_us();
+
+    // Settle guard: ignore triggers right after arming (interrupt is
+    // already cleared by the read above)
+    if (state == STATE_ARMED && (ts - armTimeUs < ARM_SETTLE_MS * 1000ULL)) {
+        portState = current;
+        return false;
     }
 
+    // Edges latched by the interrupt get the ISR timestamp. Anything that
+    // changed afterwards, while the interrupt was still pending, raises no
+    // new interrupt — catch it from GPIO, stamped at read time.
+    applyEdges(captured, ts);
+    applyEdges(current, readUs);
+
     // Determine direction once we have enough data
     if (result.direction == DIR_UNKNOWN && result.sensorsTriggered >= 2) {
         if (result.triggered[0] && result.triggered[NUM_SENSORS - 1]) {
@@ -140,23 +356,143 @@ bool sensor_update() {
             result.direction = DIR_A_TO_B;  // End A fired first
         } else if (result.triggered[NUM_SENSORS - 1]) {
             result.direction = DIR_B_TO_A;  // End B fired first
+        } else {
+            // Run started mid-array (loco stopped or reversed on it after
+            // an early-terminated pass): order of the first two sensors
+            int first = -1, second = -1;
+            for (int i = 0; i < NUM_SENSORS; i++) {
+                if (!result.triggered[i]) continue;
+                if (first < 0) first = i;
+                else if (second < 0) second = i;
+            }
+            result.direction = (result.timestamps[first] < result.timestamps[second])
+                ? DIR_A_TO_B : DIR_B_TO_A;
         }
     }
 
-    // Check if all sensors have fired
-    if (result.sensorsTriggered >= NUM_SENSORS) {
-        // Calculate total run duration
-        uint32_t first = UINT32_MAX, last = 0;
-        for (int i = 0; i < NUM_SENSORS; i++) {
-            if (result.triggered[i]) {
-                if (result.timestamps[i] < first) first = result.timestamps[i];
-                if (result.timestamps[i] > last) last = result.timestamps[i];
-            }
+    queueIntervals();
+
+    // Exit: the loco has cleared the far end of the array. Flag it ahead of
+    // the result so a shuttle can stop and reverse without waiting for it.
+    int lastSensor = -1;
+    if (result.direction != DIR_UNKNOWN) {
+        lastSensor = (result.direction == DIR_A_TO_B) ? (NUM_SENSORS - 1) : 0;
+        if (result.cleared[lastSensor]) {
+            signalExit();
         }
-        result.runDurationUs = last - first;
-        state = STATE_COMPLETE;
+    }
+
+    // Complete once every triggered sensor has cleared and the loco has
+    // left the far end. A full pass has blocked every sensor by then; a run
+    // that started mid-array has fewer.
+    if (lastSensor >= 0 && result.cleared[lastSensor] && allTriggeredCleared()) {
+        finishRun();
+        return true;
+    }
+
+    // Early termination: the speed is already pinned down, no need to wait
+    // for the rest of the array (minutes at crawl speeds)
+    if (earlyStopIntervals > 0 && result.direction != DIR_UNKNOWN &&
+        speed_intervals_agree(result, earlyStopIntervals, earlyStopTolerance)) {
+        result.earlyTerminated = true;
+        signalExit();
+        finishRun();
         return true;
     }
 
     return false;
 }
+
+// Advance the run state machine. Called by the sensor task with stateLock held.
+// Returns true if the run just transitioned to STATE_COMPLETE.
+static bool serviceRun() {
+    if (state == STATE_IDLE || state == STATE_COMPLETE) {
+        return false;
+    }
+
+    // Drain every queued interrupt, oldest first. Anything left after the
+    // run completes belongs to the departing loco and is discarded on re-arm.
+    SensorEvent ev;
+    while (isrEvents.pop(ev)) {
+        if (processEvent(ev.timestampUs)) {
+            return true;
+        }
+    }
+
+    if (state == STATE_MEASURING) {
+        uint64_t now = timebase_now_us();
+        uint32_t edgeTimeoutUs = speed_next_edge_timeout_us(result);
+
+        if (edgeTimeoutUs == 0) {
+            // No speed yet (one sensor): fixed timeout
+            if (now - result.runStartUs > DETECTION_TIMEOUT_MS * 1000ULL) {
+                finishRun();
+                return true;
+            }
+        } else if (edgeTimeoutUs == UINT32_MAX) {
+            // Leading edges are in up to the far end but the loco is still
+            // over it (e.g. stopped against the bumper): stop waiting for
+            // trailing edges
+            if (now - lastLeadingUs > TRAILING_EDGE_TIMEOUT_MS * 1000ULL) {
+                finishRun();
+                return true;
+            }
+        } else if (now - lastLeadingUs > edgeTimeoutUs) {
+            // Next sensor overdue at the measured speed: stalled or stopped
+            finishRun();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Hand a completed run to loop(). If loop() has fallen behind far enough
+// to fill the queue, the oldest result is dropped in favour of the newest.
+static void publishResult(const RunResult& run) {
+    if (xQueueSend(resultQueue, &run, 0) != pdTRUE) {
+        RunResult stale;
+        xQueueReceive(resultQueue, &stale, 0);
+        xQueueSend(resultQueue, &run, 0);
+        resultsDropped = resultsDropped + 1;
+    }
+}
+
+static void sensorTaskMain(void* arg) {
+    RunResult completed;
+    for (;;) {
+        // Block until the ISR (or sensor_arm()) notifies us. While a run is
+        // active, also wake periodically for the settle and timeout checks.
+        RunState s = state;
+        TickType_t wait = (s == STATE_IDLE || s == STATE_COMPLETE)
+            ? portMAX_DELAY : pdMS_TO_TICKS(SENSOR_TASK_POLL_MS);
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        xSemaphoreTake(stateLock, portMAX_DELAY);
+        bool justCompleted = serviceRun();
+        if (justCompleted) {
+            completed = result;
+            // Streaming: ready for the next pass before loop() even sees
+            // this one. The departing loco is masked by the arm-time port
+            // state and ARM_SETTLE_MS.
+            if (streaming) {
+                armLocked();
+            }
+        }
+        xSemaphoreGive(stateLock);
+
+        if (justCompleted) {
+            publishResult(completed);
+        }
+    }
+}
+
+void sensor_start_task() {
+    if (sensorTask != NULL) {
+        return;
+    }
+    resultQueue = xQueueCreate(SENSOR_RESULT_QUEUE_LEN, sizeof(RunResult));
+    intervalQueue = xQueueCreate(SENSOR_INTERVAL_QUEUE_LEN, sizeof(IntervalEvent));
+    xTaskCreatePinnedToCore(sensorTaskMain, "sensor", SENSOR_TASK_STACK,
+                            NULL, SENSOR_TASK_PRIORITY, &sensorTask, SENSOR_TASK_CORE);
+}
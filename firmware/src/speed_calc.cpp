@@ -1,55 +1,380 @@
 #include "speed_calc.h"
+#include "student_t.h"
 
-// Conversion: mm/s model scale → prototype mph
-// prototype_mph = model_mm_s * scale_factor / 1_000_000 * 3600 / 1.609344
-// Simplified: prototype_mph = model_mm_s * scale_factor * 0.0022369
-static const float MMS_TO_MPH = HO_SCALE_FACTOR * 3600.0f / (1000000.0f * 1.609344f);
+// Active scale, selected at runtime from the instantiations below
+static ScaleId activeScale = DEFAULT_SCALE;
 
-bool speed_calculate(const RunResult& run, SpeedResult& out) {
-    memset(&out, 0, sizeof(out));
+// Physical sensor at position i along the direction of travel.
+// Sensors are physically ordered 0..N-1 from end A to end B.
+static inline int travelToSensor(int i, Direction direction) {
+    return (direction == DIR_B_TO_A) ? (NUM_SENSORS - 1 - i) : i;
+}
 
-    if (run.sensorsTriggered < 2) {
-        return false;
+// Speed calculator for one scale. Sensor gaps (in mm·us/s) and the
+// mm/s → mph factor are compile-time constants in each instantiation, so
+// the per-interval cost is one divide and one multiply.
+template <ScaleId S>
+struct SpeedCalculator {
+    // prototype_mph = model_mm_s * scale_factor / 1_000_000 * 3600 / 1.609344
+    static constexpr float mmsToMph() { return scale_mms_to_mph(ScaleTraits<S>::ratio()); }
+
+    // Gap between travel positions i and i+1, premultiplied so that
+    // mm/s = gapMmUs / dt_us.
+    static constexpr float gapMmUs(int i, bool reversed) {
+        return sensor_gap_mm(reversed ? (NUM_SENSORS - 2 - i) : i) * 1000000.0f;
     }
 
-    // Build ordered array of timestamps in direction of travel.
-    // Sensors are physically ordered 0..N-1 from end A to end B.
-    // For A→B travel, use sensor order as-is.
-    // For B→A travel, reverse the order.
-    uint32_t ordered[NUM_SENSORS];
-    bool orderedValid[NUM_SENSORS];
+    // Distance travelled from the first sensor in direction of travel.
+    static constexpr float travelPositionMm(int i, bool reversed) {
+        return reversed ? (sensor_position_mm(NUM_SENSORS - 1) -
+                           sensor_position_mm(NUM_SENSORS - 1 - i))
+                        : sensor_position_mm(i);
+    }
 
-    for (int i = 0; i < NUM_SENSORS; i++) {
-        int src = (run.direction == DIR_B_TO_A) ? (NUM_SENSORS - 1 - i) : i;
-        ordered[i] = run.timestamps[src];
-        orderedValid[i] = run.triggered[src];
+    // Compute per-interval speeds from one set of edge timestamps (leading
+    // or trailing), reordered into direction of travel.
+    // Returns the number of valid intervals written.
+    static int intervals(const uint64_t* timestamps, const bool* valid, Direction direction,
+                         uint32_t* intervalsUs, float* speedsMmS, float* speedsMph) {
+        bool reversed = (direction == DIR_B_TO_A);
+        int count = 0;
+        for (int i = 0; i < NUM_SENSORS - 1; i++) {
+            int a = travelToSensor(i, direction);
+            int b = travelToSensor(i + 1, direction);
+            if (!valid[a] || !valid[b]) {
+                continue;  // Skip gaps
+            }
+            if (timestamps[b] <= timestamps[a]) {
+                continue;  // Avoid division by zero / out-of-order edges
+            }
+
+            uint32_t dt = (uint32_t)(timestamps[b] - timestamps[a]);
+            intervalsUs[count] = dt;
+            speedsMmS[count] = gapMmUs(i, reversed) / dt;
+            speedsMph[count] = speedsMmS[count] * mmsToMph();
+            count++;
+        }
+        return count;
+    }
+
+    static bool fit(const uint64_t* timestamps, const bool* valid, Direction direction,
+                    SpeedFit& out) {
+        memset(&out, 0, sizeof(out));
+        bool reversed = (direction == DIR_B_TO_A);
+
+        // Collect (t, x) in direction of travel. Times are offsets from the
+        // first valid edge in seconds; doubles keep microsecond resolution.
+        double t[NUM_SENSORS];
+        double x[NUM_SENSORS];
+        uint64_t base = 0;
+        bool haveBase = false;
+        int n = 0;
+        for (int i = 0; i < NUM_SENSORS; i++) {
+            int src = travelToSensor(i, direction);
+            if (!valid[src]) continue;
+            if (!haveBase) {
+                base = timestamps[src];
+                haveBase = true;
+            }
+            t[n] = (double)(int64_t)(timestamps[src] - base) / 1000000.0;
+            x[n] = travelPositionMm(i, reversed);
+            n++;
+        }
+        out.points = n;
+        if (n < 2) {
+            return false;
+        }
+        out.firstEdgeUs = base;
+
+        // Centre time so velocity is reported at the mean crossing and the
+        // normal equations stay well conditioned
+        double tMean = 0;
+        for (int i = 0; i < n; i++) tMean += t[i];
+        tMean /= n;
+        out.meanTimeS = (float)tMean;
+
+        // Sums for the normal equations in u = t - tMean
+        double s2 = 0, s3 = 0, s4 = 0, sx = 0, sux = 0, suux = 0;
+        for (int i = 0; i < n; i++) {
+            double u = t[i] - tMean;
+            double uu = u * u;
+            s2 += uu;
+            s3 += uu * u;
+            s4 += uu * uu;
+            sx += x[i];
+            sux += u * x[i];
+            suux += uu * x[i];
+        }
+        if (s2 <= 0) {
+            return false;  // All edges at the same instant
+        }
+
+        double c0 = 0, c1 = 0, c2 = 0;
+        double varC1Factor = 0;  // Var(c1) = sigma^2 * varC1Factor
+        bool quadratic = (n >= 4);
+        if (quadratic) {
+            // [ n   0   s2 ] [c0]   [ sx   ]
+            // [ 0   s2  s3 ] [c1] = [ sux  ]
+            // [ s2  s3  s4 ] [c2]   [ suux ]
+            // Symmetric, so the inverse is cofactors / det.
+            double k00 = s2 * s4 - s3 * s3;
+            double k01 = s2 * s3;
+            double k02 = -s2 * s2;
+            double k11 = n * s4 - s2 * s2;
+            double k12 = -n * s3;
+            double k22 = n * s2;
+            double det = n * k00 + s2 * k02;
+            if (det <= 1e-9 * n * s2 * s4) {
+                quadratic = false;  // Ill-conditioned: fall back to a line
+            } else {
+                c0 = (k00 * sx + k01 * sux + k02 * suux) / det;
+                c1 = (k01 * sx + k11 * sux + k12 * suux) / det;
+                c2 = (k02 * sx + k12 * sux + k22 * suux) / det;
+                varC1Factor = k11 / det;
+            }
+        }
+        if (!quadratic) {
+            c0 = sx / n;
+            c1 = sux / s2;
+            c2 = 0;
+            varC1Factor = 1.0 / s2;
+        }
+        out.quadratic = quadratic;
+
+        double ssr = 0;
+        for (int i = 0; i < n; i++) {
+            double u = t[i] - tMean;
+            double r = x[i] - (c0 + c1 * u + c2 * u * u);
+            ssr += r * r;
+        }
+        int dof = n - (quadratic ? 3 : 2);
+
+        out.velocityMmS = (float)c1;
+        out.accelMmS2 = (float)(2.0 * c2);
+        out.residualRmsMm = (float)sqrt(ssr / n);
+        if (dof > 0) {
+            double sigma2 = ssr / dof;
+            out.velocityCi95MmS = (float)(student_t95(dof) * sqrt(sigma2 * varC1Factor));
+        }
+        out.scaleSpeedMph = out.velocityMmS * mmsToMph();
+        out.scaleCi95Mph = out.velocityCi95MmS * mmsToMph();
+        out.valid = true;
+        return true;
+    }
+
+    static bool calculate(const RunResult& run, SpeedResult& out) {
+        memset(&out, 0, sizeof(out));
+
+        if (run.sensorsTriggered < 2) {
+            return false;
+        }
+
+        // Leading edges: when the nose of the loco reaches each sensor
+        int leading = intervals(run.timestamps, run.triggered, run.direction,
+                                out.intervalsUs, out.intervalSpeedsMmS, out.scaleSpeedsMph);
+        float totalSpeed = 0;
+        float totalMmS = 0;
+        for (int i = 0; i < leading; i++) {
+            totalSpeed += out.scaleSpeedsMph[i];
+            totalMmS += out.intervalSpeedsMmS[i];
+        }
+        out.intervalCount = leading;
+        out.avgScaleSpeedMph = (leading > 0) ? (totalSpeed / leading) : 0;
+
+        // Trailing edges: when the tail clears each sensor. Independent of the
+        // leading edges, so it doubles the interval samples from one pass.
+        bool clearValid[NUM_SENSORS];
+        for (int i = 0; i < NUM_SENSORS; i++) {
+            clearValid[i] = run.triggered[i] && run.cleared[i];
+        }
+        int trailing = intervals(run.clearTimestamps, clearValid, run.direction,
+                                 out.trailingIntervalsUs, out.trailingSpeedsMmS,
+                                 out.trailingScaleSpeedsMph);
+        float trailingSpeed = 0;
+        for (int i = 0; i < trailing; i++) {
+            trailingSpeed += out.trailingScaleSpeedsMph[i];
+            totalMmS += out.trailingSpeedsMmS[i];
+        }
+        out.trailingIntervalCount = trailing;
+        out.trailingAvgScaleSpeedMph = (trailing > 0) ? (trailingSpeed / trailing) : 0;
+
+        int samples = leading + trailing;
+        out.combinedAvgScaleSpeedMph = (samples > 0) ? ((totalSpeed + trailingSpeed) / samples) : 0;
+
+        // Loco length: each sensor is occupied for (length / speed)
+        if (samples > 0) {
+            float meanMmS = totalMmS / samples;
+            float lengthSum = 0;
+            int lengthCount = 0;
+            for (int i = 0; i < NUM_SENSORS; i++) {
+                if (run.triggered[i] && run.cleared[i] && run.dwellUs[i] > 0) {
+                    lengthSum += meanMmS * (run.dwellUs[i] / 1000000.0f);
+                    lengthCount++;
+                }
+            }
+            out.locoLengthMm = (lengthCount > 0) ? (lengthSum / lengthCount) : 0;
+        }
+
+        fit(run.timestamps, run.triggered, run.direction, out.fit);
+
+        return samples > 0;
+    }
+};
+
+// --- Runtime scale selection ---
+
+static const char* const SCALE_NAMES[SCALE_COUNT] = {
+    ScaleTraits<SCALE_N>::name(),
+    ScaleTraits<SCALE_HO>::name(),
+    ScaleTraits<SCALE_S>::name(),
+    ScaleTraits<SCALE_O>::name(),
+};
+
+static const float SCALE_RATIOS[SCALE_COUNT] = {
+    ScaleTraits<SCALE_N>::ratio(),
+    ScaleTraits<SCALE_HO>::ratio(),
+    ScaleTraits<SCALE_S>::ratio(),
+    ScaleTraits<SCALE_O>::ratio(),
+};
+
+void speed_set_scale(ScaleId scale) {
+    if (scale < SCALE_COUNT) {
+        activeScale = scale;
     }
+}
+
+ScaleId speed_get_scale() {
+    return activeScale;
+}
 
-    // Compute intervals between consecutive triggered sensors
-    int intervals = 0;
-    float totalSpeed = 0;
+const char* speed_scale_name(ScaleId scale) {
+    return (scale < SCALE_COUNT) ? SCALE_NAMES[scale] : "unknown";
+}
+
+float speed_scale_ratio(ScaleId scale) {
+    return (scale < SCALE_COUNT) ? SCALE_RATIOS[scale] : 0.0f;
+}
 
-    for (int i = 0; i < NUM_SENSORS - 1; i++) {
-        if (!orderedValid[i] || !orderedValid[i + 1]) {
-            continue;  // Skip gaps
+bool speed_scale_from_name(const char* name, ScaleId& out) {
+    if (name == NULL) {
+        return false;
+    }
+    for (int i = 0; i < SCALE_COUNT; i++) {
+        if (strcasecmp(name, SCALE_NAMES[i]) == 0) {
+            out = (ScaleId)i;
+            return true;
         }
+    }
+    return false;
+}
+
+bool speed_fit(const uint64_t* timestamps, const bool* valid, Direction direction,
+               SpeedFit& out) {
+    switch (activeScale) {
+        case SCALE_N:  return SpeedCalculator<SCALE_N>::fit(timestamps, valid, direction, out);
+        case SCALE_S:  return SpeedCalculator<SCALE_S>::fit(timestamps, valid, direction, out);
+        case SCALE_O:  return SpeedCalculator<SCALE_O>::fit(timestamps, valid, direction, out);
+        case SCALE_HO:
+        default:       return SpeedCalculator<SCALE_HO>::fit(timestamps, valid, direction, out);
+    }
+}
 
-        uint32_t dt = ordered[i + 1] - ordered[i];
-        if (dt == 0) {
-            continue;  // Avoid division by zero
+bool speed_intervals_agree(const RunResult& run, int count, float tolerance) {
+    if (count < 1 || run.direction == DIR_UNKNOWN) {
+        return false;
+    }
+    // mm/s doesn't depend on scale, so any instantiation will do
+    uint32_t intervalsUs[NUM_SENSORS];
+    float mms[NUM_SENSORS];
+    float mph[NUM_SENSORS];
+    int n = SpeedCalculator<DEFAULT_SCALE>::intervals(run.timestamps, run.triggered, run.direction,
+                                                      intervalsUs, mms, mph);
+    if (n < count) {
+        return false;
+    }
+
+    float mean = 0;
+    for (int i = n - count; i < n; i++) mean += mms[i];
+    mean /= count;
+    for (int i = n - count; i < n; i++) {
+        if (fabsf(mms[i] - mean) > tolerance * mean) {
+            return false;
         }
+    }
+    return true;
+}
 
-        out.intervalsUs[intervals] = dt;
-        out.intervalSpeedsMmS[intervals] = SENSOR_SPACING_MM / (dt / 1000000.0f);
-        out.scaleSpeedsMph[intervals] = out.intervalSpeedsMmS[intervals] * MMS_TO_MPH;
-        totalSpeed += out.scaleSpeedsMph[intervals];
-        intervals++;
+uint32_t speed_next_edge_timeout_us(const RunResult& run) {
+    if (run.direction == DIR_UNKNOWN || run.sensorsTriggered < 2) {
+        return 0;
+    }
+    // Furthest sensor reached in direction of travel, and the one before it
+    int lead = -1, prev = -1;
+    for (int i = NUM_SENSORS - 1; i >= 0; i--) {
+        int s = travelToSensor(i, run.direction);
+        if (!run.triggered[s]) continue;
+        if (lead < 0) {
+            lead = i;
+        } else {
+            prev = i;
+            break;
+        }
+    }
+    if (lead == NUM_SENSORS - 1) {
+        return UINT32_MAX;
+    }
+    if (prev < 0) {
+        return 0;
     }
 
-    out.intervalCount = intervals;
-    out.avgScaleSpeedMph = (intervals > 0) ? (totalSpeed / intervals) : 0;
+    int a = travelToSensor(prev, run.direction);
+    int b = travelToSensor(lead, run.direction);
+    int next = travelToSensor(lead + 1, run.direction);
+    if (run.timestamps[b] <= run.timestamps[a]) {
+        return 0;
+    }
+    double mmPerUs = fabsf(sensor_position_mm(b) - sensor_position_mm(a)) /
+                     (double)(run.timestamps[b] - run.timestamps[a]);
+    double expectedUs = fabsf(sensor_position_mm(next) - sensor_position_mm(b)) / mmPerUs;
+    double timeoutUs = EDGE_TIMEOUT_FACTOR * expectedUs;
+    if (timeoutUs < EDGE_TIMEOUT_MIN_MS * 1000.0) timeoutUs = EDGE_TIMEOUT_MIN_MS * 1000.0;
+    if (timeoutUs > DETECTION_TIMEOUT_MS * 1000.0) timeoutUs = DETECTION_TIMEOUT_MS * 1000.0;
+    return (uint32_t)timeoutUs;
+}
 
-    return intervals > 0;
+float speed_mms_to_mph(float mmS) {
+    switch (activeScale) {
+        case SCALE_N:  return mmS * SpeedCalculator<SCALE_N>::mmsToMph();
+        case SCALE_S:  return mmS * SpeedCalculator<SCALE_S>::mmsToMph();
+        case SCALE_O:  return mmS * SpeedCalculator<SCALE_O>::mmsToMph();
+        case SCALE_HO:
+        default:       return mmS * SpeedCalculator<SCALE_HO>::mmsToMph();
+    }
+}
+
+bool speed_fit_zero_velocity_us(const SpeedFit& fit, uint64_t& outUs) {
+    if (!fit.valid || !fit.quadratic || fit.accelMmS2 == 0) {
+        return false;
+    }
+    // Jitter on a steady pass fits a tiny acceleration whose zero crossing
+    // is far away; anything beyond the detection timeout is not a start/stop
+    double dt = (double)fit.velocityMmS / fit.accelMmS2;
+    if (fabs(dt) > DETECTION_TIMEOUT_MS / 1000.0) {
+        return false;
+    }
+    double t = fit.meanTimeS - dt;
+    outUs = fit.firstEdgeUs + (int64_t)(t * 1000000.0);
+    return true;
+}
+
+bool speed_calculate(const RunResult& run, SpeedResult& out) {
+    switch (activeScale) {
+        case SCALE_N:  return SpeedCalculator<SCALE_N>::calculate(run, out);
+        case SCALE_S:  return SpeedCalculator<SCALE_S>::calculate(run, out);
+        case SCALE_O:  return SpeedCalculator<SCALE_O>::calculate(run, out);
+        case SCALE_HO:
+        default:       return SpeedCalculator<SCALE_HO>::calculate(run, out);
+    }
 }
 
 void speed_print_result(const RunResult& run, const SpeedResult& speed) {
@@ -58,12 +383,13 @@ void speed_print_result(const RunResult& run, const SpeedResult& speed) {
         (run.direction == DIR_A_TO_B) ? "A→B" :
         (run.direction == DIR_B_TO_A) ? "B→A" : "unknown");
     Serial.printf("Sensors triggered: %d / %d\n", run.sensorsTriggered, NUM_SENSORS);
-    Serial.printf("Total time: %.1f ms\n", run.runDurationUs / 1000.0f);
+    Serial.printf("Total time: %.1f ms%s\n", run.runDurationUs / 1000.0f,
+                  run.earlyTerminated ? " (early-terminated)" : "");
     Serial.println();
 
     // Raw timestamps
     Serial.println("Sensor timestamps (us from first trigger):");
-    uint32_t firstTs = UINT32_MAX;
+    uint64_t firstTs = UINT64_MAX;
     for (int i = 0; i < NUM_SENSORS; i++) {
         if (run.triggered[i] && run.timestamps[i] < firstTs) {
             firstTs = run.timestamps[i];
@@ -71,7 +397,7 @@ void speed_print_result(const RunResult& run, const SpeedResult& speed) {
     }
     for (int i = 0; i < NUM_SENSORS; i++) {
         if (run.triggered[i]) {
-            Serial.printf("  S%d: %lu us\n", i, run.timestamps[i] - firstTs);
+            Serial.printf("  S%d: %lu us\n", i, (unsigned long)(run.timestamps[i] - firstTs));
         } else {
             Serial.printf("  S%d: --\n", i);
         }
@@ -91,5 +417,21 @@ void speed_print_result(const RunResult& run, const SpeedResult& speed) {
     } else {
         Serial.println("No valid intervals computed.");
     }
+
+    // Trailing-edge estimate and loco length
+    if (speed.trailingIntervalCount > 0) {
+        Serial.println();
+        Serial.printf("Trailing edges: %d intervals, average %.1f scale mph\n",
+                      speed.trailingIntervalCount, speed.trailingAvgScaleSpeedMph);
+        Serial.printf("Combined average: %.1f scale mph\n", speed.combinedAvgScaleSpeedMph);
+    }
+    if (speed.locoLengthMm > 0) {
+        Serial.printf("Loco length: %.1f mm\n", speed.locoLengthMm);
+    }
+    if (speed.fit.valid) {
+        Serial.printf("Fit (%d pts): %.1f +/- %.1f scale mph, accel %.1f mm/s^2, rms %.2f mm\n",
+                      speed.fit.points, speed.fit.scaleSpeedMph, speed.fit.scaleCi95Mph,
+                      speed.fit.accelMmS2, speed.fit.residualRmsMm);
+    }
     Serial.println("====================");
 }
@@ -0,0 +1,252 @@
+#include "speed_model.h"
+
+#include <math.h>
+
+// Knots are measured speed steps, so never more than 126
+static const int MAX_POINTS = 128;
+
+// --- PCHIP ---
+
+void pchip_slopes(const float* x, const float* y, int n, float* d) {
+    if (n < 2) {
+        if (n == 1) d[0] = 0;
+        return;
+    }
+    float h[MAX_POINTS];
+    float delta[MAX_POINTS];
+    for (int k = 0; k < n - 1; k++) {
+        h[k] = x[k + 1] - x[k];
+        delta[k] = (y[k + 1] - y[k]) / h[k];
+    }
+    if (n == 2) {
+        d[0] = d[1] = delta[0];
+        return;
+    }
+
+    // Interior: weighted harmonic mean of the secants, zero at extrema
+    for (int k = 1; k < n - 1; k++) {
+        if (delta[k - 1] * delta[k] <= 0) {
+            d[k] = 0;
+        } else {
+            float w1 = 2 * h[k] + h[k - 1];
+            float w2 = h[k] + 2 * h[k - 1];
+            d[k] = (w1 + w2) / (w1 / delta[k - 1] + w2 / delta[k]);
+        }
+    }
+
+    // Ends: three-point estimate, limited to keep the end segment monotone
+    for (int end = 0; end < 2; end++) {
+        int k = end ? n - 2 : 0;       // End secant
+        int j = end ? n - 3 : 1;       // Neighbouring secant
+        float de = ((2 * h[k] + h[j]) * delta[k] - h[k] * delta[j]) / (h[k] + h[j]);
+        if (de * delta[k] <= 0) {
+            de = 0;
+        } else if (delta[k] * delta[j] <= 0 && fabsf(de) > 3 * fabsf(delta[k])) {
+            de = 3 * delta[k];
+        }
+        d[end ? n - 1 : 0] = de;
+    }
+}
+
+float pchip_eval(const float* x, const float* y, const float* d, int n, float xq) {
+    if (n == 1) return y[0];
+    if (xq <= x[0]) return y[0] + d[0] * (xq - x[0]);
+    if (xq >= x[n - 1]) return y[n - 1] + d[n - 1] * (xq - x[n - 1]);
+
+    int k = 0;
+    while (k < n - 2 && xq > x[k + 1]) k++;
+
+    // Cubic Hermite on [x[k], x[k+1]]
+    float h = x[k + 1] - x[k];
+    float t = (xq - x[k]) / h;
+    float t2 = t * t;
+    float t3 = t2 * t;
+    float h00 = 2 * t3 - 3 * t2 + 1;
+    float h10 = t3 - 2 * t2 + t;
+    float h01 = -2 * t3 + 3 * t2;
+    float h11 = t3 - t2;
+    return h00 * y[k] + h10 * h * d[k] + h01 * y[k + 1] + h11 * h * d[k + 1];
+}
+
+// --- Model points ---
+
+// Index of the first moving knot, -1 if none.
+static int firstMoving(const SpeedKnot* knots, int n) {
+    for (int i = 0; i < n; i++) {
+        if (knots[i].moving) return i;
+    }
+    return -1;
+}
+
+// Points the model is built from: the highest stationary knot below the
+// first moving one (as 0 mph, anchoring the start of motion), then every
+// moving knot. Stationary knots above that (stalls) are ignored.
+// src[] maps each point back to its knot. Knot `skip` is left out.
+static int modelPoints(const SpeedKnot* knots, int n, int skip,
+                       float* x, float* y, int* src) {
+    int first = firstMoving(knots, n);
+    if (first < 0) return 0;
+    int m = 0;
+    if (first > 0 && first - 1 != skip) {
+        x[m] = (float)knots[first - 1].step;
+        y[m] = 0;
+        src[m++] = first - 1;
+    }
+    for (int i = first; i < n && m < MAX_POINTS; i++) {
+        if (!knots[i].moving || i == skip) continue;
+        x[m] = (float)knots[i].step;
+        y[m] = knots[i].mph;
+        src[m++] = i;
+    }
+    return m;
+}
+
+// --- Planner ---
+
+int speed_model_initial_steps(int minStep, int maxStep, int count, int* out) {
+    if (maxStep < minStep) return 0;
+    int span = maxStep - minStep;
+    if (count > span + 1) count = span + 1;
+    if (count < 1) return 0;
+    if (count == 1) {
+        out[0] = minStep;
+        return 1;
+    }
+    int written = 0;
+    for (int i = 0; i < count; i++) {
+        int step = minStep + (int)lroundf((float)span * i / (count - 1));
+        if (written == 0 || step != out[written - 1]) {
+            out[written++] = step;
+        }
+    }
+    return written;
+}
+
+float speed_model_loo_residual(const SpeedKnot* knots, int n, int k) {
+    if (k < 0 || k >= n || !knots[k].moving) return 0;
+
+    // Needs a moving neighbour on both sides: no extrapolation
+    bool before = false, after = false;
+    for (int i = 0; i < k; i++) before |= knots[i].moving;
+    for (int i = k + 1; i < n; i++) after |= knots[i].moving;
+    if (!before || !after) return 0;
+
+    float x[MAX_POINTS], y[MAX_POINTS], d[MAX_POINTS];
+    int src[MAX_POINTS];
+    int m = modelPoints(knots, n, k, x, y, src);
+    if (m < 2) return 0;
+    pchip_slopes(x, y, m, d);
+    return pchip_eval(x, y, d, m, (float)knots[k].step) - knots[k].mph;
+}
+
+// Relative leave-one-out residual of knot k beyond what its own and its
+// neighbours' measurement noise explains (larger is worse). A noisy knot
+// is re-measured, not bisected around: new steps beside it cannot shrink
+// its CI.
+static float looScore(const SpeedKnot* knots, int n, int k) {
+    if (knots[k].mph <= 0) return 0;
+    float nbrCi = 0;
+    for (int i = k - 1; i >= 0; i--) {
+        if (knots[i].moving) {
+            nbrCi = knots[i].ci95;
+            break;
+        }
+    }
+    for (int i = k + 1; i < n; i++) {
+        if (knots[i].moving) {
+            if (knots[i].ci95 > nbrCi) nbrCi = knots[i].ci95;
+            break;
+        }
+    }
+    float noise = sqrtf(knots[k].ci95 * knots[k].ci95 + nbrCi * nbrCi);
+    float excess = fabsf(speed_model_loo_residual(knots, n, k)) - noise;
+    return excess > 0 ? excess / knots[k].mph : 0.0f;
+}
+
+int speed_model_refine_steps(const SpeedKnot* knots, int n, float relTol,
+                             int* out, int maxOut) {
+    int written = 0;
+    for (int i = 0; i + 1 < n && written < maxOut; i++) {
+        const SpeedKnot& a = knots[i];
+        const SpeedKnot& b = knots[i + 1];
+        if (b.step - a.step < 2) continue;
+
+        bool refine = false;
+        if (!a.moving && b.moving) {
+            refine = true;   // Start of motion is somewhere in this gap
+        } else if (a.moving && b.moving) {
+            refine = looScore(knots, n, i) > relTol || looScore(knots, n, i + 1) > relTol;
+        }
+        if (refine) {
+            out[written++] = (a.step + b.step) / 2;
+        }
+    }
+    return written;
+}
+
+int speed_model_remeasure_steps(const SpeedKnot* knots, int n, float relTol,
+                                int* out, int maxOut) {
+    int written = 0;
+    for (int i = 0; i < n && written < maxOut; i++) {
+        if (knots[i].moving && knots[i].mph > 0 && knots[i].ci95 > relTol * knots[i].mph) {
+            out[written++] = knots[i].step;
+        }
+    }
+    return written;
+}
+
+bool speed_model_table(const SpeedKnot* knots, int n, int minStep, int maxStep,
+                       SpeedTableEntry* table) {
+    float x[MAX_POINTS], y[MAX_POINTS], d[MAX_POINTS], loo[MAX_POINTS];
+    int src[MAX_POINTS];
+    int m = modelPoints(knots, n, -1, x, y, src);
+    if (m == 0) return false;
+    pchip_slopes(x, y, m, d);
+    for (int p = 0; p < m; p++) {
+        loo[p] = fabsf(speed_model_loo_residual(knots, n, src[p]));
+    }
+
+    // Everything up to the anchoring stationary knot is below start of motion
+    int first = firstMoving(knots, n);
+    int stoppedUpTo = (first > 0) ? knots[first - 1].step : minStep - 1;
+
+    int k = 0;  // Knot cursor (knots are sorted)
+    for (int step = minStep; step <= maxStep; step++) {
+        SpeedTableEntry& e = table[step - minStep];
+        while (k < n && knots[k].step < step) k++;
+        bool isKnot = (k < n && knots[k].step == step);
+
+        e.measured = isKnot;
+        if (step <= stoppedUpTo) {
+            e.mph = 0;
+            e.ci95 = 0;
+            continue;
+        }
+        if (isKnot && knots[k].moving) {
+            e.mph = knots[k].mph;
+            e.ci95 = knots[k].ci95;
+            continue;
+        }
+
+        // Interpolated (a stationary knot here is a stall, not data)
+        e.measured = false;
+        float mph = pchip_eval(x, y, d, m, (float)step);
+        e.mph = mph > 0 ? mph : 0;
+
+        // Bracketing model points
+        int p = 0;
+        while (p < m - 1 && x[p + 1] < step) p++;
+        float ciA = knots[src[p]].ci95;
+        if (step < x[0] || step > x[m - 1] || m == 1) {
+            // Extrapolated: end knot CI plus half the extrapolated change
+            int end = (step < x[0]) ? 0 : m - 1;
+            e.ci95 = knots[src[end]].ci95 + 0.5f * fabsf(e.mph - y[end]);
+            continue;
+        }
+        float t = (step - x[p]) / (x[p + 1] - x[p]);
+        float ciB = knots[src[p + 1]].ci95;
+        float r = loo[p] > loo[p + 1] ? loo[p] : loo[p + 1];
+        e.ci95 = (1 - t) * ciA + t * ciB + 4 * t * (1 - t) * r;
+    }
+    return true;
+}
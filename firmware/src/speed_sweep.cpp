@@ -0,0 +1,706 @@
+#include "speed_sweep.h"
+#include "config.h"
+#include "speed_calc.h"
+#include "pass_stats.h"
+#include "speed_model.h"
+#include "mqtt_manager.h"
+#include "track_switch.h"
+#include "motion_search.h"
+#include "pull_test.h"
+#include "momentum_profile.h"
+
+#include <ArduinoJson.h>
+
+// --- State machine ---
+
+enum SweepState {
+    SW_IDLE,
+    SW_STARTING,    // Direction set forward, waiting before first step
+    SW_SETTLING,    // Speed set, waiting for loco to reach steady speed (not shuttle)
+    SW_MEASURING,   // Sensors armed, waiting for a pass
+    SW_STOPPING,    // Pass done, loco stopping
+    SW_REVERSING,   // Direction toggled for the return pass
+    SW_SHUTTLING,   // Shuttle mode: sensors streaming, reversing at each exit
+    SW_DONE
+};
+
+struct SweepEntry {
+    int speedStep;
+    uint8_t passes;            // Passes attempted
+    uint8_t validPasses;       // Passes with a speed
+    float passMph[SWEEP_MAX_PASSES];
+    bool passForward[SWEEP_MAX_PASSES];
+    bool passValid[SWEEP_MAX_PASSES];
+    bool passInlier[SWEEP_MAX_PASSES];
+    float avgMph;              // Mean over inlier passes
+    float minMph;              // Range over all valid passes, outliers included
+    float maxMph;
+    float fwdMph;              // Mean over inlier forward passes (0 if none)
+    float revMph;              // Mean over inlier reverse passes (0 if none)
+    float medianMph;
+    float stddevMph;           // Inlier sample standard deviation
+    float ci95Mph;             // 95% half-width of avgMph (0 with one pass)
+    uint8_t rejected;          // Valid passes rejected as outliers
+    bool converged;            // Ended early on targetPct
+};
+
+// Configuration
+static SweepParams params;
+
+// State
+static SweepState state = SW_IDLE;
+static unsigned long stateEnteredMs = 0;
+static unsigned long sweepStartMs = 0;
+static int currentStep = 0;
+static int currentStepNum = 0;       // 1-based index into sequence
+static int totalSteps = 0;
+static int passesThisStep = 0;
+static int passNum = 0;              // Passes done at the current step
+static bool forward = true;
+static bool sweepComplete = false;
+static int totalPasses = 0;
+static PassStats stepStats;          // Valid passes at the current step
+
+// Pass handed over by loop()
+static RunResult pendingRun;
+static bool hasPending = false;
+
+// Sensor early-stop setting before the sweep, restored when it ends
+static int savedEarlyStop = 0;
+static float savedEarlyTol = 0;
+
+// Shuttle mode
+static uint64_t speedSetUs = 0;      // Last speed change (passes before settle are skipped)
+static bool passForward = true;      // Throttle direction of the pass just exited
+static bool exitSeen = false;        // Exit for the current pass already handled
+
+// Results
+static const int MAX_ENTRIES = 126;
+static SweepEntry entries[MAX_ENTRIES];
+static int entryCount = 0;
+static int curEntry = 0;             // Entry being measured (an earlier one when re-measuring)
+static int finishedSteps = 0;        // Steps finished, re-measures included
+static int lastFinished = -1;        // Entry of the most recently finished step
+
+// Sparse mode: steps still to measure, in order
+static int planned[MAX_ENTRIES];
+static int planCount = 0;
+static int planPos = 0;
+static int refineRounds = 0;
+
+// --- Helpers ---
+
+static void publishSpeed(int step) {
+    float throttle = (float)step / 126.0f;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%.3f", throttle);
+    mqtt_publish_throttle("speed", String(buf));
+}
+
+// New speed step: passes only count once the loco has settled at it.
+static void setSpeed(int step) {
+    publishSpeed(step);
+    speedSetUs = timebase_now_us();
+}
+
+static void stopLoco() {
+    mqtt_publish_throttle("stop", "");
+}
+
+static void setDirection(bool fwd) {
+    forward = fwd;
+    mqtt_publish_throttle("direction", fwd ? "FORWARD" : "REVERSE");
+}
+
+static void enterState(SweepState s) {
+    state = s;
+    stateEnteredMs = millis();
+}
+
+// Passes for a step: low-speed steps near minStep get extra passes.
+static int passesForStep(int step) {
+    int n = params.passes;
+    if (params.lowRange > 0 && step <= params.minStep + params.lowRange) {
+        n = params.lowPasses;
+    }
+    if (n < 1) n = 1;
+    if (n > SWEEP_MAX_PASSES) n = SWEEP_MAX_PASSES;
+    return n;
+}
+
+// Clear the entry and pass statistics for a new step and set its speed.
+// A step that already has an entry (sparse re-measure) resumes it: its
+// passes are kept and up to passesForStep() more are added.
+static void resetStep(int step) {
+    currentStep = step;
+    currentStepNum++;
+    pass_stats_reset(stepStats);
+
+    curEntry = entryCount;
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].speedStep == step) curEntry = i;
+    }
+    SweepEntry& e = entries[curEntry];
+    if (curEntry < entryCount) {
+        passNum = e.passes;
+        passesThisStep = min(passNum + passesForStep(step), SWEEP_MAX_PASSES);
+        for (int i = 0; i < e.passes; i++) {
+            if (e.passValid[i]) pass_stats_add(stepStats, e.passMph[i]);
+        }
+        e.converged = false;
+    } else {
+        passNum = 0;
+        passesThisStep = passesForStep(step);
+        memset(&e, 0, sizeof(e));
+        e.speedStep = step;
+    }
+
+    setSpeed(step);
+}
+
+// Start a new step entry and set the speed for its first pass. Shuttle
+// sweeps stream from the start: the loco is already moving, so the
+// sensors must be armed to reverse it. Passes before it has settled are
+// skipped in SW_SHUTTLING.
+static void beginStep(int step) {
+    resetStep(step);
+    if (params.shuttle) {
+        hasPending = false;
+        exitSeen = false;
+        sensor_set_streaming(true);
+        enterState(SW_SHUTTLING);
+    } else {
+        enterState(SW_SETTLING);
+    }
+}
+
+// Record one pass (mph <= 0 means no detection). ci95Mph is the pass's own
+// fit confidence, 0 if the fit had too few points.
+static void recordPass(float mph, bool fwd, float ci95Mph) {
+    SweepEntry& e = entries[curEntry];
+    e.passMph[passNum] = mph;
+    e.passForward[passNum] = fwd;
+    e.passValid[passNum] = mph > 0;
+    e.passes++;
+    passNum++;
+    totalPasses++;
+
+    if (mph > 0 && !pass_stats_add(stepStats, mph, ci95Mph)) {
+        Serial.printf("Sweep: step %d pass %d outlier %.2f mph (median %.2f)\n",
+                      currentStep, passNum, mph, stepStats.median);
+    }
+}
+
+// Speed of a finished run, with its fit confidence. 0 mph if no detection.
+static float passSpeed(const RunResult& run, float& ci95Mph) {
+    SpeedResult speed;
+    ci95Mph = 0;
+    if (run.sensorsTriggered < 2 || !speed_calculate(run, speed)) {
+        return 0.0f;
+    }
+    if (speed.fit.valid) {
+        ci95Mph = speed.fit.scaleCi95Mph;
+    }
+    return speed.avgScaleSpeedMph;
+}
+
+// Pass cap reached, or the inlier mean already meets the confidence target.
+// The convergence outcome is recorded on the entry (it may coincide with
+// the last allowed pass).
+static bool stepDone() {
+    bool converged = params.targetPct > 0 &&
+        pass_stats_converged(stepStats, params.targetPct / 100.0f, params.minPasses);
+    entries[curEntry].converged = converged;
+    return converged || passNum >= passesThisStep;
+}
+
+// Aggregate the current step's passes. Valid passes were fed to stepStats
+// in order, so the k-th valid pass is stepStats entry k.
+static void finishStep() {
+    SweepEntry& e = entries[curEntry];
+    float fwdSum = 0, revSum = 0;
+    int fwdCount = 0, revCount = 0;
+    e.validPasses = 0;
+    e.minMph = 0;
+    e.maxMph = 0;
+    for (int i = 0; i < e.passes; i++) {
+        if (!e.passValid[i]) continue;
+        float mph = e.passMph[i];
+        if (e.validPasses == 0 || mph < e.minMph) e.minMph = mph;
+        if (e.validPasses == 0 || mph > e.maxMph) e.maxMph = mph;
+        e.passInlier[i] = stepStats.inlier[e.validPasses];
+        e.validPasses++;
+        if (!e.passInlier[i]) continue;
+        if (e.passForward[i]) {
+            fwdSum += mph;
+            fwdCount++;
+        } else {
+            revSum += mph;
+            revCount++;
+        }
+    }
+    e.avgMph = stepStats.mean;
+    e.fwdMph = (fwdCount > 0) ? (fwdSum / fwdCount) : 0;
+    e.revMph = (revCount > 0) ? (revSum / revCount) : 0;
+    e.medianMph = stepStats.median;
+    e.stddevMph = pass_stats_stddev(stepStats);
+    e.ci95Mph = pass_stats_ci95(stepStats);
+    e.rejected = (uint8_t)pass_stats_rejected(stepStats);
+    if (curEntry == entryCount) entryCount++;
+    lastFinished = curEntry;
+    finishedSteps++;
+
+    Serial.printf("Sweep: step %d = %.1f +/- %.2f mph (%d/%d passes, %d rejected%s)\n",
+                  e.speedStep, e.avgMph, e.ci95Mph, e.validPasses, e.passes, e.rejected,
+                  e.converged ? ", converged" : "");
+}
+
+// Shuttle reversal: stop, flip direction and resume the current step.
+static void reverseNow() {
+    stopLoco();
+    setDirection(!forward);
+    publishSpeed(currentStep);  // Same step: no re-settle
+}
+
+// Measured steps as model knots, sorted by step. Returns the count.
+static int collectKnots(SpeedKnot* knots) {
+    int n = 0;
+    for (int i = 0; i < entryCount; i++) {
+        SpeedKnot k;
+        k.step = entries[i].speedStep;
+        k.mph = entries[i].avgMph;
+        k.ci95 = entries[i].ci95Mph;
+        k.moving = entries[i].validPasses > 0;
+        int j = n++;
+        while (j > 0 && knots[j - 1].step > k.step) {
+            knots[j] = knots[j - 1];
+            j--;
+        }
+        knots[j] = k;
+    }
+    return n;
+}
+
+// Next step to measure, 0 when the sweep is done. Sparse mode works through
+// the plan, then asks the model where it needs more data: extra passes at
+// knots with a poor CI, new steps where the model misses (at most
+// SWEEP_REFINE_ROUNDS rounds).
+static int nextStep() {
+    if (!params.sparse) {
+        int next = currentStep + params.stepInc;
+        return (next > params.maxStep) ? 0 : next;
+    }
+    if (planPos >= planCount && refineRounds < SWEEP_REFINE_ROUNDS) {
+        static SpeedKnot knots[MAX_ENTRIES];
+        static int again[MAX_ENTRIES];
+        int n = collectKnots(knots);
+        float tol = params.refineTolPct / 100.0f;
+        int a = speed_model_remeasure_steps(knots, n, tol, again, MAX_ENTRIES);
+        planCount = 0;
+        for (int i = 0; i < a; i++) {
+            // Only knots with passes to spare
+            for (int j = 0; j < entryCount; j++) {
+                if (entries[j].speedStep == again[i] && entries[j].passes < SWEEP_MAX_PASSES) {
+                    planned[planCount++] = again[i];
+                }
+            }
+        }
+        int remeasure = planCount;
+        planCount += speed_model_refine_steps(knots, n, tol, planned + planCount,
+                                              MAX_ENTRIES - entryCount);
+        planPos = 0;
+        refineRounds++;
+        totalSteps += planCount;
+        if (planCount > 0) {
+            Serial.printf("Sweep: refinement round %d, %d steps re-measured, %d new\n",
+                          refineRounds, remeasure, planCount - remeasure);
+        }
+    }
+    return (planPos < planCount) ? planned[planPos++] : 0;
+}
+
+static void finishSweep(bool complete);
+
+// Aggregate the finished step and move on to the next one (or finish).
+static void advanceStep() {
+    finishStep();
+    int next = (entryCount < MAX_ENTRIES) ? nextStep() : 0;
+    if (next == 0) {
+        finishSweep(true);
+        Serial.printf("Sweep complete: %d steps, %d passes in %lus\n",
+                      entryCount, totalPasses, (millis() - sweepStartMs) / 1000);
+    } else if (state == SW_SHUTTLING) {
+        // Keep shuttling: the loco is already heading back at the old step,
+        // passes count again once it has settled at the new one
+        resetStep(next);
+    } else {
+        beginStep(next);
+    }
+}
+
+static void finishSweep(bool complete) {
+    stopLoco();
+    sensor_disarm();
+    if (params.earlyStop > 0) {
+        sensor_set_early_stop(savedEarlyStop, savedEarlyTol);
+    }
+    sweepComplete = complete;
+    enterState(SW_DONE);
+}
+
+// --- Public API ---
+
+SweepParams speed_sweep_default_params() {
+    SweepParams p;
+    p.minStep = 1;
+    p.maxStep = 126;
+    p.stepInc = 1;
+    p.settleMs = SWEEP_DEFAULT_SETTLE_MS;
+    p.passes = 1;
+    p.lowPasses = 3;
+    p.lowRange = 0;
+    p.timeoutMs = SWEEP_DEFAULT_TIMEOUT_MS;
+    p.shuttle = false;
+    p.targetPct = 0;
+    p.minPasses = 2;
+    p.earlyStop = 0;
+    p.earlyTolPct = EARLY_STOP_TOLERANCE * 100.0f;
+    p.sparse = false;
+    p.knots = SWEEP_SPARSE_KNOTS;
+    p.refineTolPct = SWEEP_REFINE_TOL_PCT;
+    return p;
+}
+
+SweepParams speed_sweep_params_from_json(const char* json) {
+    SweepParams p = speed_sweep_default_params();
+    JsonDocument doc;
+    if (json == NULL || deserializeJson(doc, json) != DeserializationError::Ok) {
+        return p;
+    }
+    p.minStep = doc["min_step"] | p.minStep;
+    p.maxStep = doc["max_step"] | p.maxStep;
+    p.stepInc = doc["step_inc"] | p.stepInc;
+    p.settleMs = doc["settle_ms"] | p.settleMs;
+    p.passes = doc["passes"] | p.passes;
+    p.lowPasses = doc["low_passes"] | p.lowPasses;
+    p.lowRange = doc["low_range"] | p.lowRange;
+    p.timeoutMs = doc["timeout_ms"] | p.timeoutMs;
+    p.shuttle = doc["shuttle"] | p.shuttle;
+    p.targetPct = doc["target_pct"] | p.targetPct;
+    p.minPasses = doc["min_passes"] | p.minPasses;
+    p.earlyStop = doc["early_stop"] | p.earlyStop;
+    p.earlyTolPct = doc["early_tol_pct"] | p.earlyTolPct;
+    p.sparse = doc["sparse"] | p.sparse;
+    p.knots = doc["knots"] | p.knots;
+    p.refineTolPct = doc["refine_tol_pct"] | p.refineTolPct;
+    return p;
+}
+
+void speed_sweep_start(const SweepParams& p) {
+    if (state != SW_IDLE && state != SW_DONE) return;
+    // The other test modes drive the same loco and sensor array
+    if (motion_search_is_running() || pull_test_is_running() || momentum_is_running()) {
+        Serial.println("Sweep: another test mode is running");
+        return;
+    }
+    if (!mqtt_get_throttle_acquired()) {
+        Serial.println("Sweep: throttle not acquired");
+        return;
+    }
+    if (!track_switch_allow_dcc_test()) {
+        Serial.println("Sweep: blocked by track switch (not in DCC programming mode)");
+        return;
+    }
+
+    params = p;
+    params.minStep = constrain(params.minStep, 1, 126);
+    params.maxStep = constrain(params.maxStep, params.minStep, 126);
+    if (params.stepInc < 1) params.stepInc = 1;
+    if (params.settleMs == 0) params.settleMs = SWEEP_DEFAULT_SETTLE_MS;
+    if (params.timeoutMs == 0) params.timeoutMs = SWEEP_DEFAULT_TIMEOUT_MS;
+    if (params.targetPct < 0) params.targetPct = 0;
+    params.minPasses = constrain(params.minPasses, 1, SWEEP_MAX_PASSES);
+
+    // Reset results
+    entryCount = 0;
+    curEntry = 0;
+    finishedSteps = 0;
+    lastFinished = -1;
+    refineRounds = 0;
+    currentStep = 0;
+    currentStepNum = 0;
+    totalPasses = 0;
+    sweepComplete = false;
+    hasPending = false;
+    if (params.sparse) {
+        if (params.knots < 2) params.knots = 2;
+        if (params.refineTolPct <= 0) params.refineTolPct = SWEEP_REFINE_TOL_PCT;
+        planCount = speed_model_initial_steps(params.minStep, params.maxStep,
+                                              params.knots, planned);
+        planPos = 0;
+        totalSteps = planCount;
+    } else {
+        totalSteps = (params.maxStep - params.minStep) / params.stepInc + 1;
+    }
+
+    // The sweep arms each pass itself
+    sensor_disarm();
+    if (params.earlyStop > 0) {
+        savedEarlyStop = sensor_get_early_stop_intervals();
+        savedEarlyTol = sensor_get_early_stop_tolerance();
+        sensor_set_early_stop(params.earlyStop, params.earlyTolPct / 100.0f);
+    }
+
+    stopLoco();
+    setDirection(true);
+    sweepStartMs = millis();
+    enterState(SW_STARTING);
+
+    Serial.printf("Sweep started: steps %d-%d inc %d, settle=%lums, %d steps%s%s\n",
+                  params.minStep, params.maxStep, params.stepInc, params.settleMs, totalSteps,
+                  params.shuttle ? ", shuttle" : "", params.sparse ? ", sparse" : "");
+}
+
+void speed_sweep_abort() {
+    if (state == SW_IDLE || state == SW_DONE) return;
+
+    finishSweep(false);
+    Serial.printf("Sweep aborted at step %d (%d steps collected)\n",
+                  currentStep, entryCount);
+}
+
+void speed_sweep_on_exit(Direction dir) {
+    if (state != SW_SHUTTLING) return;
+    // Reverse first, bookkeeping after: this is what keeps the loco off
+    // the bumper at high steps
+    passForward = forward;
+    exitSeen = true;
+    reverseNow();
+    Serial.printf("Sweep: exit %s, reversed\n", dir == DIR_A_TO_B ? "A→B" : "B→A");
+}
+
+void speed_sweep_on_result(const RunResult& run) {
+    if (state != SW_MEASURING && state != SW_SHUTTLING) return;
+    pendingRun = run;
+    hasPending = true;
+}
+
+void speed_sweep_process() {
+    if (state == SW_IDLE || state == SW_DONE) return;
+
+    unsigned long elapsed = millis() - stateEnteredMs;
+
+    switch (state) {
+        case SW_STARTING:
+            if (elapsed >= 500) {
+                beginStep(params.sparse ? planned[planPos++] : params.minStep);
+            }
+            break;
+
+        case SW_SETTLING:
+            if (elapsed >= params.settleMs) {
+                hasPending = false;
+                sensor_arm();
+                enterState(SW_MEASURING);
+            }
+            break;
+
+        case SW_MEASURING:
+            if (hasPending) {
+                hasPending = false;
+                float ci95;
+                float mph = passSpeed(pendingRun, ci95);
+                recordPass(mph, forward, ci95);
+                stopLoco();
+                enterState(SW_STOPPING);
+            } else if (elapsed >= params.timeoutMs) {
+                Serial.printf("Sweep: step %d pass %d no detection\n", currentStep, passNum + 1);
+                sensor_disarm();
+                recordPass(0.0f, forward, 0);
+                stopLoco();
+                enterState(SW_STOPPING);
+            }
+            break;
+
+        case SW_STOPPING:
+            if (elapsed >= SWEEP_STOP_MS) {
+                // Shuttle: every pass runs the opposite way to the last
+                setDirection(!forward);
+                enterState(SW_REVERSING);
+            }
+            break;
+
+        case SW_REVERSING:
+            if (elapsed >= SWEEP_STOP_MS) {
+                if (!stepDone()) {
+                    setSpeed(currentStep);
+                    enterState(SW_SETTLING);
+                    break;
+                }
+                advanceStep();
+            }
+            break;
+
+        case SW_SHUTTLING:
+            if (hasPending) {
+                hasPending = false;
+                if (pendingRun.runStartUs < speedSetUs + params.settleMs * 1000ULL) {
+                    // Loco was still reaching the new step's speed: the pass
+                    // still triggers a reversal but is not counted
+                    Serial.printf("Sweep: step %d pass skipped (not settled)\n", currentStep);
+                    break;
+                }
+                float ci95;
+                float mph = passSpeed(pendingRun, ci95);
+                recordPass(mph, exitSeen ? passForward : forward, ci95);
+                exitSeen = false;
+                enterState(SW_SHUTTLING);  // Restart the no-detection timeout
+                if (stepDone()) {
+                    advanceStep();
+                }
+            } else if (elapsed >= params.timeoutMs) {
+                // Nothing crossed the array (stalled, or stopped at a bumper
+                // before reaching it): count a miss and send it back
+                Serial.printf("Sweep: step %d pass %d no detection\n", currentStep, passNum + 1);
+                recordPass(0.0f, forward, 0);
+                reverseNow();
+                enterState(SW_SHUTTLING);
+                if (stepDone()) {
+                    advanceStep();
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool speed_sweep_is_running() {
+    return state != SW_IDLE && state != SW_DONE;
+}
+
+int speed_sweep_current_step() {
+    return speed_sweep_is_running() ? currentStep : 0;
+}
+
+int speed_sweep_total_steps() {
+    return totalSteps;
+}
+
+int speed_sweep_completed_steps() {
+    return finishedSteps;
+}
+
+static void addEntry(JsonObject o, const SweepEntry& e) {
+    o["step"] = e.speedStep;
+    o["pct"] = serialized(String(e.speedStep / 126.0f * 100.0f, 1));
+    o["passes"] = e.passes;
+    o["valid_passes"] = e.validPasses;
+    if (e.validPasses > 0) {
+        o["avg_mph"] = serialized(String(e.avgMph, 2));
+        o["min_mph"] = serialized(String(e.minMph, 2));
+        o["max_mph"] = serialized(String(e.maxMph, 2));
+        if (e.fwdMph > 0) o["fwd_mph"] = serialized(String(e.fwdMph, 2));
+        if (e.revMph > 0) o["rev_mph"] = serialized(String(e.revMph, 2));
+        o["median_mph"] = serialized(String(e.medianMph, 2));
+        o["stddev_mph"] = serialized(String(e.stddevMph, 3));
+        o["ci95_mph"] = serialized(String(e.ci95Mph, 3));
+        o["rejected"] = e.rejected;
+        o["converged"] = e.converged;
+    } else {
+        o["error"] = "no_detection";
+    }
+}
+
+String speed_sweep_build_step_json() {
+    JsonDocument doc;
+    doc["type"] = "sweep_step";
+    doc["step_num"] = finishedSteps;
+    doc["total_steps"] = totalSteps;
+    if (lastFinished >= 0) {
+        const SweepEntry& e = entries[lastFinished];
+        addEntry(doc["entry"].to<JsonObject>(), e);
+        JsonArray raw = doc["pass_mph"].to<JsonArray>();
+        JsonArray dir = doc["pass_dir"].to<JsonArray>();
+        JsonArray outlier = doc["pass_outlier"].to<JsonArray>();
+        for (int i = 0; i < e.passes; i++) {
+            raw.add(serialized(String(e.passMph[i], 2)));
+            dir.add(e.passForward[i] ? "fwd" : "rev");
+            outlier.add(e.passValid[i] && !e.passInlier[i]);
+        }
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+String speed_sweep_build_table_json() {
+    static SpeedKnot knots[MAX_ENTRIES];
+    static SpeedTableEntry table[126];
+    int n = collectKnots(knots);
+    if (!speed_model_table(knots, n, params.minStep, params.maxStep, table)) {
+        return String();
+    }
+
+    JsonDocument doc;
+    doc["type"] = "speed_table";
+    doc["scale"] = speed_scale_name(speed_get_scale());
+    doc["min_step"] = params.minStep;
+    doc["max_step"] = params.maxStep;
+    JsonArray mph = doc["mph"].to<JsonArray>();
+    JsonArray ci = doc["ci95"].to<JsonArray>();
+    JsonArray measured = doc["measured"].to<JsonArray>();
+    for (int step = params.minStep; step <= params.maxStep; step++) {
+        const SpeedTableEntry& e = table[step - params.minStep];
+        mph.add(serialized(String(e.mph, 1)));
+        ci.add(serialized(String(e.ci95, 2)));
+        if (e.measured) measured.add(step);
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+String speed_sweep_build_json(bool includeEntries) {
+    JsonDocument doc;
+    doc["type"] = "sweep";
+    doc["running"] = speed_sweep_is_running();
+    doc["complete"] = sweepComplete;
+    doc["min_step"] = params.minStep;
+    doc["max_step"] = params.maxStep;
+    doc["step_inc"] = params.stepInc;
+    doc["settle_ms"] = params.settleMs;
+    doc["passes"] = params.passes;
+    doc["shuttle"] = params.shuttle;
+    if (params.sparse) {
+        doc["sparse"] = true;
+        doc["knots"] = params.knots;
+        doc["refine_tol_pct"] = serialized(String(params.refineTolPct, 1));
+    }
+    if (params.earlyStop > 0) {
+        doc["early_stop"] = params.earlyStop;
+        doc["early_tol_pct"] = serialized(String(params.earlyTolPct, 1));
+    }
+    if (params.targetPct > 0) {
+        doc["target_pct"] = serialized(String(params.targetPct, 1));
+        doc["min_passes"] = params.minPasses;
+    }
+    doc["steps_done"] = entryCount;
+    doc["total_steps"] = totalSteps;
+    doc["total_passes"] = totalPasses;
+    doc["scale"] = speed_scale_name(speed_get_scale());
+
+    if (includeEntries) {
+        JsonArray arr = doc["entries"].to<JsonArray>();
+        for (int i = 0; i < entryCount; i++) {
+            addEntry(arr.add<JsonObject>(), entries[i]);
+        }
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
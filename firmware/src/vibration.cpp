@@ -1,53 +1,271 @@
 #include "vibration.h"
 #include "config.h"
+#include "timebase.h"
+#include "sample_timing.h"
+#include "fft.h"
+#include "order_track.h"
+#include "vibration_stats.h"
 
 #include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
 
-// --- Capture state ---
+// --- Sampler (timer ISR wakes the task, task reads the ADC) ---
+// analogRead() is not ISR-safe, so the timer only notifies a dedicated
+// task, which samples and fills one half of a double buffer while loop()
+// drains the other. Missed ticks show up in the timing statistics.
+static hw_timer_t* sampleTimer = NULL;
+static TaskHandle_t samplerTask = NULL;
+static QueueHandle_t blockQueue = NULL;     // Full block indices → loop()
+static uint16_t blockSamples[2][VIBRATION_BLOCK_SAMPLES];
+static uint32_t blockTimes[2][VIBRATION_BLOCK_SAMPLES];   // timebase_now_us(), low 32 bits
+static int blockLen[2];
+static volatile bool blockBusy[2];          // Handed to loop(), not yet drained
+static volatile bool sampling = false;      // Task takes samples while set
+static volatile bool samplerDone = false;   // Task has handed over the last block
+static volatile uint32_t blocksDropped = 0; // Blocks lost because loop() fell behind
+static volatile uint32_t captureGen = 0;    // Bumped per capture: task drops its partial block
+static uint32_t targetSamples = 0;
+
+// --- Capture state (loop() only) ---
+// Statistics stream through the accumulator; only the first
+// VIBRATION_MAX_SAMPLES samples are kept, for the spectrum (order tracking
+// uses its own decimated buffer).
+static VibrationAccumulator acc;
+static uint16_t accBias = 2048;             // Previous capture's mean (12-bit midpoint at boot)
 static uint16_t sampleBuf[VIBRATION_MAX_SAMPLES];
 static int sampleCount = 0;
 static bool capturing = false;
+static bool stopRequested = false;         // End the capture early (pass over)
 static bool hasResult = false;
-static unsigned long captureStartUs = 0;
-static unsigned long lastSampleUs = 0;
-static unsigned long captureDurationMs = VIBRATION_CAPTURE_MS;
+static uint64_t captureStartUs = 0;
+static unsigned long captureDurationMs = 0;  // Length of the capture in progress
+static SampleTiming timing;
 
 // --- Result cache ---
 static uint16_t resultPeakToPeak = 0;
 static float resultRms = 0.0f;
-static int resultSamples = 0;
+static float resultMean = 0.0f;
+static float resultCrest = 0.0f;
+static uint32_t resultHistogram[VIBRATION_HIST_BINS];
+static uint32_t resultSamples = 0;
+static int resultBuffered = 0;      // Samples held in sampleBuf for the spectrum
 static unsigned long resultDurationMs = 0;
+static uint64_t resultStartUs = 0;  // Capture window on the shared timebase
+static uint64_t resultEndUs = 0;
+static float resultRateHz = 0.0f;
+static float resultJitterUs = 0.0f;
+static uint32_t resultMaxGapUs = 0;
+static uint32_t resultLate = 0;
+static uint32_t resultDropped = 0;
+
+// --- Spectrum (Welch average of Hann-windowed Q15 FFTs) ---
+static const int FFT_N = 1 << VIBRATION_FFT_LOG2;
+static const int FFT_BINS = FFT_N / 2 + 1;
+static const int BAND_COUNT = 4;
+static const float BAND_EDGES_HZ[BAND_COUNT + 1] = {0, 250, 1000, 2500, 5000};
+static int16_t fftRe[FFT_N];
+static int16_t fftIm[FFT_N];
+static float fftPower[FFT_BINS];    // Per-bin power, ADC counts^2
+static float fftMag[FFT_BINS];      // Per-bin amplitude, ADC counts
+static SpectrumPeak resultPeaks[VIBRATION_FFT_PEAKS];
+static int resultPeakCount = 0;
+static float resultBandDb[BAND_COUNT];
+static float resultCentroidHz = 0.0f;
+static uint8_t resultSpectrumDb[VIBRATION_SPECTRUM_BANDS];
+static float resultSpectrumBandHz = 0.0f;
+static float resultBinHz = 0.0f;
+static int resultFftFrames = 0;
+static uint32_t resultFftUs = 0;
+
+// --- Order tracking ---
+static float orderWheelMm = ORDER_WHEEL_DIA_MM;
+static int orderMesh = ORDER_MESH_ORDER;
+static float orderScratch[ORDER_SAMPLES_PER_REV * ORDER_MAX_REVS];
+static uint16_t orderBuf[ORDER_DECIM_SAMPLES];
+static OrderDecimator orderDecim;
+static bool orderCapture = false;       // Capture in progress spans a pass
+static bool resultOrder = false;        // Last result was a pass capture
+static bool orderPending = false;       // Pass waiting for its capture to finish
+static uint32_t orderSequence = 0;
+static uint64_t orderRunStartUs = 0;
+static uint64_t orderRefUs = 0;         // Speed fit reference time
+static float orderVelocityMmS = 0.0f;
+static float orderAccelMmS2 = 0.0f;
+static OrderResult orderResult;
 
 // --- Analysis functions ---
 
 uint16_t vibration_calc_peak_to_peak(const uint16_t* samples, int count) {
-    if (count < 1) return 0;
-    uint16_t minVal = samples[0];
-    uint16_t maxVal = samples[0];
-    for (int i = 1; i < count; i++) {
-        if (samples[i] < minVal) minVal = samples[i];
-        if (samples[i] > maxVal) maxVal = samples[i];
-    }
-    return maxVal - minVal;
+    VibrationAccumulator a;
+    vibration_acc_reset(a, 2048);
+    vibration_acc_add(a, samples, count);
+    return vibration_acc_peak_to_peak(a);
 }
 
 float vibration_calc_rms(const uint16_t* samples, int count) {
-    if (count < 1) return 0.0f;
+    // RMS of the AC component (mean removed: piezo bias)
+    VibrationAccumulator a;
+    vibration_acc_reset(a, 2048);
+    vibration_acc_add(a, samples, count);
+    return vibration_acc_rms(a);
+}
+
+// Power in dB re 1 ADC count^2, floored at 0 dB.
+static float powerDb(float p) {
+    return (p > 1.0f) ? 10.0f * log10f(p) : 0.0f;
+}
+
+// Load one segment of the capture into fftRe/fftIm: mean removed, scaled
+// x8 (12-bit ADC -> +/-16384) to use the Q15 range, Hann windowed.
+static void loadSegment(int start, int n, float mean) {
+    for (int i = 0; i < n; i++) {
+        int32_t v = (int32_t)lroundf(((float)sampleBuf[start + i] - mean) * 8.0f);
+        if (v > 32767) v = 32767;
+        if (v < -32767) v = -32767;
+        fftRe[i] = (int16_t)v;
+        fftIm[i] = 0;
+    }
+    fft_window_hann(fftRe, n);
+}
+
+// Welch spectrum of sampleBuf: 50%-overlapping segments, power averaged,
+// then peaks, named band levels, centroid and the compact per-band
+// spectrum. Segments shrink for captures shorter than FFT_N. Samples
+// within the buffer are one timer period apart, so bins are spaced from
+// the nominal rate (the achieved rate also counts gaps between blocks).
+// Skipped if blocks were dropped: the buffer would splice across the gap.
+static void analyseSpectrum() {
+    resultPeakCount = 0;
+    resultCentroidHz = 0.0f;
+    resultFftFrames = 0;
+    resultFftUs = 0;
+    for (int b = 0; b < BAND_COUNT; b++) resultBandDb[b] = 0.0f;
+    memset(resultSpectrumDb, 0, sizeof(resultSpectrumDb));
+    if (resultDropped > 0) return;
+
+    int log2n = VIBRATION_FFT_LOG2;
+    while ((1 << log2n) > sampleCount && log2n > 6) log2n--;
+    int n = 1 << log2n;
+    if (sampleCount < n) return;
+    int bins = n / 2 + 1;
+
+    float mean = 0;
+    for (int i = 0; i < sampleCount; i++) mean += sampleBuf[i];
+    mean /= sampleCount;
 
-    // Compute mean (DC offset from piezo bias)
-    float sum = 0.0f;
-    for (int i = 0; i < count; i++) {
-        sum += (float)samples[i];
+    unsigned long t0 = micros();
+    for (int k = 0; k < bins; k++) fftPower[k] = 0;
+    for (int start = 0; start + n <= sampleCount; start += n / 2) {
+        loadSegment(start, n, mean);
+        fft_q15(fftRe, fftIm, log2n);
+        fft_accumulate_power(fftRe, fftIm, n, fftPower);
+        resultFftFrames++;
     }
-    float mean = sum / (float)count;
+    resultFftUs = micros() - t0;
 
-    // Compute RMS of AC component (subtract mean)
-    float sumSq = 0.0f;
-    for (int i = 0; i < count; i++) {
-        float diff = (float)samples[i] - mean;
-        sumSq += diff * diff;
+    // A tone of amplitude A comes out at A * 8 (input scale) * 0.5 (Hann)
+    // / 2 (one-sided) = 2A per bin, so counts = sqrt(power) / 2.
+    for (int k = 0; k < bins; k++) {
+        fftPower[k] = fftPower[k] / resultFftFrames / 4.0f;
+        fftMag[k] = sqrtf(fftPower[k]);
+    }
+
+    resultBinHz = (float)VIBRATION_SAMPLE_HZ / n;
+    resultPeakCount = spectrum_peaks(fftMag, bins, resultBinHz, VIBRATION_PEAK_MIN,
+                                     resultPeaks, VIBRATION_FFT_PEAKS);
+    resultCentroidHz = spectrum_centroid(fftPower, bins, resultBinHz);
+    for (int b = 0; b < BAND_COUNT; b++) {
+        resultBandDb[b] = powerDb(spectrum_band_power(fftPower, bins, resultBinHz,
+                                                      BAND_EDGES_HZ[b], BAND_EDGES_HZ[b + 1]));
+    }
+
+    // Equal-width bands up to Nyquist; the last one includes the Nyquist bin
+    float nyquist = resultBinHz * (n / 2);
+    resultSpectrumBandHz = nyquist / VIBRATION_SPECTRUM_BANDS;
+    for (int b = 0; b < VIBRATION_SPECTRUM_BANDS; b++) {
+        float lo = b * resultSpectrumBandHz;
+        float hi = (b == VIBRATION_SPECTRUM_BANDS - 1) ? nyquist + resultBinHz
+                                                       : lo + resultSpectrumBandHz;
+        float db = powerDb(spectrum_band_power(fftPower, bins, resultBinHz, lo, hi));
+        resultSpectrumDb[b] = (uint8_t)(db > 255.0f ? 255 : lroundf(db));
+    }
+}
+
+// --- Sampler ---
+
+static void IRAM_ATTR sampleTimerIsr() {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(samplerTask, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+// Hand the filled block to loop() and switch halves. If loop() still has
+// the other half, the block is dropped and refilled in place.
+static void handOver(int& fill, int& fillCount) {
+    if (fillCount == 0) return;
+    if (blockBusy[fill ^ 1]) {
+        blocksDropped = blocksDropped + 1;
+        fillCount = 0;
+        return;
+    }
+    blockLen[fill] = fillCount;
+    blockBusy[fill] = true;
+    xQueueSend(blockQueue, &fill, 0);
+    fill ^= 1;
+    fillCount = 0;
+}
+
+static void samplerTaskMain(void* arg) {
+    int fill = 0;
+    int fillCount = 0;
+    uint32_t taken = 0;
+    uint32_t gen = 0;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!sampling) continue;
+        // New capture: whatever a timed-out one left behind is stale
+        if (gen != captureGen) {
+            gen = captureGen;
+            fill = 0;
+            fillCount = 0;
+            taken = 0;
+        }
+
+        blockSamples[fill][fillCount] = (uint16_t)analogRead(PIEZO_ADC_PIN);
+        blockTimes[fill][fillCount] = (uint32_t)timebase_now_us();
+        fillCount++;
+        taken++;
+
+        if (taken >= targetSamples) {
+            timerAlarmDisable(sampleTimer);
+            sampling = false;
+            handOver(fill, fillCount);
+            samplerDone = true;
+            taken = 0;
+        } else if (fillCount == VIBRATION_BLOCK_SAMPLES) {
+            handOver(fill, fillCount);
+        }
+    }
+}
+
+// Fold every block the sampler has handed over into the statistics,
+// buffering the start of the capture for the spectrum and, for a pass
+// capture, all of it decimated for order tracking.
+static void drainBlocks() {
+    int idx;
+    while (xQueueReceive(blockQueue, &idx, 0) == pdTRUE) {
+        vibration_acc_add(acc, blockSamples[idx], blockLen[idx]);
+        if (orderCapture) order_decim_add(orderDecim, blockSamples[idx], blockLen[idx]);
+        for (int i = 0; i < blockLen[idx]; i++) {
+            if (sampleCount < VIBRATION_MAX_SAMPLES) {
+                sampleBuf[sampleCount++] = blockSamples[idx][i];
+            }
+            sample_timing_add(timing, blockTimes[idx][i]);
+        }
+        blockBusy[idx] = false;
     }
-    return sqrtf(sumSq / (float)count);
 }
 
 // --- Public API ---
@@ -57,20 +275,51 @@ void vibration_init() {
     // ADC1 channel 0 (GPIO 36) - no attenuation needed for low-voltage piezo
     analogReadResolution(12);
 
+    order_decim_reset(orderDecim, orderBuf, ORDER_DECIM_SAMPLES,
+                      VIBRATION_SAMPLE_HZ / ORDER_DECIM_HZ);
+    blockQueue = xQueueCreate(2, sizeof(int));
+    xTaskCreatePinnedToCore(samplerTaskMain, "vib", VIBRATION_TASK_STACK,
+                            NULL, VIBRATION_TASK_PRIORITY, &samplerTask, VIBRATION_TASK_CORE);
+
+    // 1 MHz timer ticks, alarm every sample period (enabled per capture)
+    sampleTimer = timerBegin(VIBRATION_TIMER, 80, true);
+    timerAttachInterrupt(sampleTimer, sampleTimerIsr, true);
+    timerAlarmWrite(sampleTimer, 1000000 / VIBRATION_SAMPLE_HZ, true);
+
     Serial.println("Piezo vibration sensor initialized.");
-    Serial.printf("  ADC pin=GPIO%d, capture=%dms\n", PIEZO_ADC_PIN, VIBRATION_CAPTURE_MS);
+    Serial.printf("  ADC pin=GPIO%d, capture=%dms at %dHz\n",
+                  PIEZO_ADC_PIN, VIBRATION_CAPTURE_MS, VIBRATION_SAMPLE_HZ);
 }
 
-void vibration_start_capture() {
-    if (capturing) return;
+void vibration_start_capture(unsigned long ms) {
+    if (capturing || sampleTimer == NULL) return;
+    if (ms < 10) ms = 10;
+    if (ms > VIBRATION_MAX_CAPTURE_MS) ms = VIBRATION_MAX_CAPTURE_MS;
+    captureDurationMs = ms;
 
     sampleCount = 0;
+    vibration_acc_reset(acc, accBias);
     capturing = true;
+    stopRequested = false;
+    orderCapture = false;
     hasResult = false;
-    captureStartUs = micros();
-    lastSampleUs = captureStartUs;
+    sample_timing_reset(timing, 1000000 / VIBRATION_SAMPLE_HZ);
+
+    // Anything left from an aborted capture
+    int idx;
+    while (xQueueReceive(blockQueue, &idx, 0) == pdTRUE) {}
+    blockBusy[0] = blockBusy[1] = false;
+    blocksDropped = 0;
+    samplerDone = false;
+    captureGen = captureGen + 1;
+
+    targetSamples = (uint32_t)((uint64_t)captureDurationMs * VIBRATION_SAMPLE_HZ / 1000);
+    captureStartUs = timebase_now_us();
+    sampling = true;
+    timerWrite(sampleTimer, 0);
+    timerAlarmEnable(sampleTimer);
 
-    Serial.println("Vibration capture started...");
+    Serial.printf("Vibration capture started (%lums)...\n", captureDurationMs);
 }
 
 bool vibration_is_capturing() {
@@ -80,33 +329,55 @@ bool vibration_is_capturing() {
 void vibration_process() {
     if (!capturing) return;
 
-    unsigned long now = micros();
+    drainBlocks();
 
-    // Check if capture window has elapsed
-    if ((now - captureStartUs) >= (captureDurationMs * 1000UL)) {
-        // Capture complete — compute results
-        capturing = false;
-        hasResult = true;
-        resultSamples = sampleCount;
-        resultDurationMs = (now - captureStartUs) / 1000UL;
-
-        if (sampleCount > 0) {
-            resultPeakToPeak = vibration_calc_peak_to_peak(sampleBuf, sampleCount);
-            resultRms = vibration_calc_rms(sampleBuf, sampleCount);
-        } else {
-            resultPeakToPeak = 0;
-            resultRms = 0.0f;
-        }
-
-        Serial.printf("Vibration capture done: %d samples, p2p=%u, rms=%.1f\n",
-                       resultSamples, resultPeakToPeak, resultRms);
+    uint64_t now = timebase_now_us();
+    bool timedOut = (now - captureStartUs) >= (captureDurationMs + 500) * 1000ULL;
+    if (!samplerDone && !timedOut && !stopRequested) {
         return;
     }
+    if (!samplerDone) {
+        // Stopped early, or the sampler never finished (task starved):
+        // keep what arrived
+        timerAlarmDisable(sampleTimer);
+        sampling = false;
+    }
+    drainBlocks();
+
+    // Capture complete — compute results
+    capturing = false;
+    hasResult = true;
+    resultOrder = orderCapture;
+    orderCapture = false;
+    resultSamples = acc.count;
+    resultBuffered = sampleCount;
+    resultDurationMs = (unsigned long)((now - captureStartUs) / 1000ULL);
+    resultStartUs = captureStartUs;
+    resultEndUs = now;
+    resultRateHz = sample_timing_rate_hz(timing);
+    resultJitterUs = sample_timing_jitter_us(timing);
+    resultMaxGapUs = timing.maxIntervalUs;
+    resultLate = timing.late;
+    resultDropped = blocksDropped;
 
-    // Sample at target rate
-    if ((now - lastSampleUs) >= VIBRATION_SAMPLE_US && sampleCount < VIBRATION_MAX_SAMPLES) {
-        sampleBuf[sampleCount++] = (uint16_t)analogRead(PIEZO_ADC_PIN);
-        lastSampleUs = now;
+    resultPeakToPeak = vibration_acc_peak_to_peak(acc);
+    resultRms = vibration_acc_rms(acc);
+    resultMean = vibration_acc_mean(acc);
+    resultCrest = vibration_acc_crest(acc);
+    memcpy(resultHistogram, acc.histogram, sizeof(resultHistogram));
+    if (acc.count > 0) accBias = (uint16_t)lroundf(resultMean);
+    analyseSpectrum();
+
+    Serial.printf("Vibration capture done: %lu samples at %.0fHz (jitter %.1fus, max gap %luus, %lu late, %lu blocks dropped), p2p=%u, rms=%.1f, crest=%.1f\n",
+                  (unsigned long)resultSamples, resultRateHz, resultJitterUs, (unsigned long)resultMaxGapUs,
+                  (unsigned long)resultLate, (unsigned long)resultDropped,
+                  resultPeakToPeak, resultRms, resultCrest);
+    if (resultDropped > 0) {
+        Serial.println("  spectrum: skipped (blocks dropped)");
+    } else if (resultPeakCount > 0) {
+        Serial.printf("  spectrum: %d frames in %luus, peak %.0fHz (%.1f), centroid %.0fHz\n",
+                      resultFftFrames, (unsigned long)resultFftUs, resultPeaks[0].hz,
+                      resultPeaks[0].magnitude, resultCentroidHz);
     }
 }
 
@@ -122,13 +393,207 @@ float vibration_get_rms() {
     return resultRms;
 }
 
+uint64_t vibration_get_start_us() {
+    return resultStartUs;
+}
+
+uint64_t vibration_get_end_us() {
+    return resultEndUs;
+}
+
+float vibration_get_rate_hz() {
+    return resultRateHz;
+}
+
+float vibration_get_jitter_us() {
+    return resultJitterUs;
+}
+
+float vibration_get_peak_hz() {
+    return (resultPeakCount > 0) ? resultPeaks[0].hz : 0.0f;
+}
+
+float vibration_get_centroid_hz() {
+    return resultCentroidHz;
+}
+
+float vibration_get_spectrum_band_hz() {
+    return resultSpectrumBandHz;
+}
+
+void vibration_get_spectrum_db(uint8_t* out) {
+    memcpy(out, resultSpectrumDb, sizeof(resultSpectrumDb));
+}
+
+uint32_t vibration_fft_benchmark(int runs) {
+    if (runs < 1) return 0;
+    float mean = 0;
+    int n = (sampleCount >= FFT_N) ? FFT_N : 0;
+    for (int i = 0; i < n; i++) mean += sampleBuf[i];
+    if (n) mean /= n;
+
+    unsigned long t0 = micros();
+    for (int r = 0; r < runs; r++) {
+        if (n) {
+            loadSegment(0, n, mean);
+        } else {
+            // No capture yet: a synthetic tone exercises the same path
+            for (int i = 0; i < FFT_N; i++) {
+                fftRe[i] = (int16_t)(8000 * sinf(6.2831853f * 50 * i / FFT_N));
+                fftIm[i] = 0;
+            }
+            fft_window_hann(fftRe, FFT_N);
+        }
+        fft_q15(fftRe, fftIm, VIBRATION_FFT_LOG2);
+    }
+    return (micros() - t0) / runs;
+}
+
+void vibration_set_order_tracking(float wheelDiaMm, int meshOrder) {
+    orderWheelMm = (wheelDiaMm > 0) ? wheelDiaMm : 0.0f;
+    orderMesh = (meshOrder > 0 && 2 * meshOrder < ORDER_SAMPLES_PER_REV) ? meshOrder : 0;
+    orderPending = false;
+}
+
+bool vibration_order_tracking_enabled() {
+    return orderWheelMm > 0;
+}
+
+float vibration_get_wheel_dia_mm() {
+    return orderWheelMm;
+}
+
+int vibration_get_mesh_order() {
+    return orderMesh;
+}
+
+void vibration_order_begin_pass() {
+    if (!vibration_order_tracking_enabled() || capturing) return;
+    vibration_start_capture(ORDER_MAX_CAPTURE_MS);
+    if (!capturing) return;
+    order_decim_reset(orderDecim, orderBuf, ORDER_DECIM_SAMPLES,
+                      VIBRATION_SAMPLE_HZ / ORDER_DECIM_HZ);
+    orderCapture = true;
+}
+
+void vibration_order_end_pass() {
+    if (capturing && orderCapture) stopRequested = true;
+}
+
+void vibration_order_on_pass(uint32_t sequence, uint64_t runStartUs, uint64_t refUs,
+                             float velocityMmS, float accelMmS2) {
+    if (!vibration_order_tracking_enabled()) return;
+    orderPending = true;
+    orderSequence = sequence;
+    orderRunStartUs = runStartUs;
+    orderRefUs = refUs;
+    orderVelocityMmS = velocityMmS;
+    orderAccelMmS2 = accelMmS2;
+}
+
+bool vibration_order_take_result() {
+    if (!orderPending || capturing) return false;
+    orderPending = false;
+
+    if (!hasResult || !resultOrder || resultStartUs < orderRunStartUs ||
+        resultStartUs - orderRunStartUs > (uint64_t)ORDER_MATCH_MS * 1000) {
+        Serial.printf("Order tracking: no vibration capture for run #%lu\n",
+                      (unsigned long)orderSequence);
+        return false;
+    }
+    if (resultDropped > 0) {
+        Serial.printf("Order tracking: run #%lu, capture dropped blocks\n",
+                      (unsigned long)orderSequence);
+        return false;
+    }
+
+    // Decimated samples are one boxcar apart, timed from the nominal rate
+    float rateHz = order_decim_rate_hz(orderDecim, VIBRATION_SAMPLE_HZ);
+    float t0S = (int64_t)(resultStartUs - orderRefUs) / 1000000.0f +
+                order_decim_offset_s(orderDecim, VIBRATION_SAMPLE_HZ);
+    order_track_analyse(orderBuf, orderDecim.count, rateHz, t0S, orderVelocityMmS, orderAccelMmS2,
+                        orderWheelMm, orderMesh, ORDER_SAMPLES_PER_REV, orderScratch,
+                        ORDER_SAMPLES_PER_REV * ORDER_MAX_REVS, orderResult);
+    if (orderResult.valid) {
+        Serial.printf("Order tracking: run #%lu, %.2f rev/s over %d revs, 1x=%.2f 2x=%.2f mesh=%.2f (rms %.2f)\n",
+                      (unsigned long)orderSequence, orderResult.revHz, orderResult.revs,
+                      orderResult.amp1x, orderResult.amp2x, orderResult.ampMesh,
+                      orderResult.totalRms);
+    } else {
+        Serial.printf("Order tracking: run #%lu, capture does not cover a whole revolution\n",
+                      (unsigned long)orderSequence);
+    }
+    return true;
+}
+
+String vibration_build_order_json() {
+    JsonDocument doc;
+    doc["type"] = "order";
+    doc["run"] = orderSequence;
+    doc["valid"] = orderResult.valid;
+    doc["wheel_mm"] = serialized(String(orderWheelMm, 2));
+    doc["speed_mms"] = serialized(String(orderVelocityMmS, 1));
+    doc["accel_mms2"] = serialized(String(orderAccelMmS2, 1));
+    doc["rev_hz"] = serialized(String(orderResult.revHz, 2));
+    doc["revs"] = orderResult.revs;
+    doc["samples_per_rev"] = orderResult.samplesPerRev;
+    doc["decim_hz"] = serialized(String(order_decim_rate_hz(orderDecim, VIBRATION_SAMPLE_HZ), 0));
+    doc["rms"] = serialized(String(orderResult.totalRms, 2));
+    doc["amp_1x"] = serialized(String(orderResult.amp1x, 2));
+    doc["amp_2x"] = serialized(String(orderResult.amp2x, 2));
+    doc["frac_1x"] = serialized(String(orderResult.frac1x, 3));
+    doc["frac_2x"] = serialized(String(orderResult.frac2x, 3));
+    if (orderMesh > 0) {
+        doc["mesh_order"] = orderMesh;
+        doc["amp_mesh"] = serialized(String(orderResult.ampMesh, 2));
+        doc["frac_mesh"] = serialized(String(orderResult.fracMesh, 3));
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
 String vibration_build_json() {
     JsonDocument doc;
     doc["type"] = "vibration";
     doc["peak_to_peak"] = resultPeakToPeak;
     doc["rms"] = serialized(String(resultRms, 1));
+    doc["mean"] = serialized(String(resultMean, 1));
+    doc["crest"] = serialized(String(resultCrest, 2));
+    JsonArray hist = doc["histogram"].to<JsonArray>();
+    for (int b = 0; b < VIBRATION_HIST_BINS; b++) hist.add(resultHistogram[b]);
     doc["samples"] = resultSamples;
+    doc["spectrum_samples"] = resultBuffered;
     doc["duration_ms"] = resultDurationMs;
+    doc["t_start_us"] = resultStartUs;
+    doc["t_end_us"] = resultEndUs;
+    doc["rate_hz"] = serialized(String(resultRateHz, 0));
+    doc["jitter_us"] = serialized(String(resultJitterUs, 1));
+    doc["max_gap_us"] = resultMaxGapUs;
+    doc["late"] = resultLate;
+    doc["dropped_blocks"] = resultDropped;
+
+    doc["fft_frames"] = resultFftFrames;
+    doc["fft_us"] = resultFftUs;
+    doc["bin_hz"] = serialized(String(resultBinHz, 2));
+    doc["centroid_hz"] = serialized(String(resultCentroidHz, 0));
+    JsonArray peaks = doc["peaks"].to<JsonArray>();
+    for (int i = 0; i < resultPeakCount; i++) {
+        JsonObject pk = peaks.add<JsonObject>();
+        pk["hz"] = serialized(String(resultPeaks[i].hz, 1));
+        pk["amp"] = serialized(String(resultPeaks[i].magnitude, 2));
+    }
+    JsonArray bands = doc["bands"].to<JsonArray>();
+    for (int b = 0; b < BAND_COUNT; b++) {
+        JsonObject band = bands.add<JsonObject>();
+        band["lo_hz"] = BAND_EDGES_HZ[b];
+        band["hi_hz"] = BAND_EDGES_HZ[b + 1];
+        band["db"] = serialized(String(resultBandDb[b], 1));
+    }
+    doc["spectrum_band_hz"] = serialized(String(resultSpectrumBandHz, 1));
+    JsonArray spec = doc["spectrum_db"].to<JsonArray>();
+    for (int b = 0; b < VIBRATION_SPECTRUM_BANDS; b++) spec.add(resultSpectrumDb[b]);
 
     String json;
     serializeJson(doc, json);
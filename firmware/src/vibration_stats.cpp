@@ -0,0 +1,57 @@
+#include "vibration_stats.h"
+
+#include <math.h>
+#include <string.h>
+
+void vibration_acc_reset(VibrationAccumulator& a, uint16_t bias) {
+    memset(&a, 0, sizeof(a));
+    a.bias = bias;
+}
+
+// Octave bin of a non-negative deviation: 0 -> 0, 1 -> 1, 2..3 -> 2, ...
+static int histBin(uint32_t d) {
+    int bin = 0;
+    while (d) {
+        bin++;
+        d >>= 1;
+    }
+    return (bin < VIBRATION_HIST_BINS) ? bin : VIBRATION_HIST_BINS - 1;
+}
+
+void vibration_acc_add(VibrationAccumulator& a, const uint16_t* samples, int n) {
+    for (int i = 0; i < n; i++) {
+        uint16_t s = samples[i];
+        if (a.count == 0 || s < a.minVal) a.minVal = s;
+        if (a.count == 0 || s > a.maxVal) a.maxVal = s;
+        int32_t d = (int32_t)s - a.bias;
+        a.sum += d;
+        a.sumSq += (uint64_t)((int64_t)d * d);
+        a.histogram[histBin(d < 0 ? -d : d)]++;
+        a.count++;
+    }
+}
+
+float vibration_acc_mean(const VibrationAccumulator& a) {
+    if (a.count == 0) return a.bias;
+    return a.bias + (float)((double)a.sum / a.count);
+}
+
+float vibration_acc_rms(const VibrationAccumulator& a) {
+    if (a.count == 0) return 0.0f;
+    double m = (double)a.sum / a.count;
+    double var = (double)a.sumSq / a.count - m * m;
+    return (var > 0) ? (float)sqrt(var) : 0.0f;
+}
+
+uint16_t vibration_acc_peak_to_peak(const VibrationAccumulator& a) {
+    return (a.count > 0) ? a.maxVal - a.minVal : 0;
+}
+
+float vibration_acc_crest(const VibrationAccumulator& a) {
+    float rms = vibration_acc_rms(a);
+    if (rms <= 0) return 0.0f;
+    float mean = vibration_acc_mean(a);
+    float up = a.maxVal - mean;
+    float down = mean - a.minVal;
+    return ((up > down) ? up : down) / rms;
+}
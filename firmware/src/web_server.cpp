@@ -8,6 +8,9 @@
 #include "vibration.h"
 #include "audio_capture.h"
 #include "pull_test.h"
+#include "speed_sweep.h"
+#include "motion_search.h"
+#include "momentum_profile.h"
 #include "track_switch.h"
 
 #include <ESPAsyncWebServer.h>
@@ -61,14 +64,30 @@ static void onWsEvent(AsyncWebSocket* srv, AsyncWebSocketClient* client,
                         sensor_disarm();
                         Serial.println("WS: Disarmed");
                         web_send_status();
+                    } else if (strcmp(action, "stream") == 0) {
+                        bool en = doc["enabled"] | true;
+                        if (en && !track_switch_allow_operation()) {
+                            Serial.println("WS: Stream blocked — track in layout mode");
+                        } else {
+                            sensor_set_streaming(en);
+                            Serial.printf("WS: Streaming %s\n", en ? "on" : "off");
+                        }
+                        web_send_status();
                     } else if (strcmp(action, "status") == 0) {
                         web_send_status();
+                    } else if (strcmp(action, "scale") == 0) {
+                        ScaleId scale;
+                        if (speed_scale_from_name(doc["scale"] | "", scale)) {
+                            speed_set_scale(scale);
+                            Serial.printf("WS: Scale %s\n", speed_scale_name(scale));
+                        }
+                        web_send_status();
                     } else if (strcmp(action, "tare") == 0) {
                         load_cell_tare();
                         Serial.println("WS: Tared");
                         web_send_load();
                     } else if (strcmp(action, "vibration") == 0) {
-                        vibration_start_capture();
+                        vibration_start_capture(VIBRATION_CAPTURE_MS);
                         Serial.println("WS: Vibration capture started");
                     } else if (strcmp(action, "audio") == 0) {
                         audio_start_capture();
@@ -126,11 +145,47 @@ static void onWsEvent(AsyncWebSocket* srv, AsyncWebSocketClient* client,
                     } else if (strcmp(action, "pull_test_start") == 0) {
                         int stepInc = doc["step_inc"] | 5;
                         unsigned long settleMs = doc["settle_ms"] | 3000UL;
-                        pull_test_start(stepInc, settleMs);
-                        Serial.printf("WS: Pull test start inc=%d settle=%lums\n", stepInc, settleMs);
+                        bool autoSettle = doc["auto_settle"] | true;
+                        if (doc["ramp"] | false) {
+                            float rate = doc["ramp_rate"] | 0.0f;
+                            pull_test_start_ramp(stepInc, rate);
+                            Serial.printf("WS: Pull ramp start inc=%d rate=%.1f\n", stepInc, rate);
+                        } else {
+                            pull_test_start(stepInc, settleMs, autoSettle);
+                            Serial.printf("WS: Pull test start inc=%d settle=%lums%s\n", stepInc, settleMs,
+                                          autoSettle ? " (auto)" : "");
+                        }
                     } else if (strcmp(action, "pull_test_abort") == 0) {
                         pull_test_abort();
                         Serial.println("WS: Pull test abort");
+
+                    // --- Speed sweep commands ---
+                    } else if (strcmp(action, "sweep_start") == 0) {
+                        speed_sweep_start(speed_sweep_params_from_json(cmd));
+                        Serial.println("WS: Sweep start");
+                    } else if (strcmp(action, "sweep_abort") == 0) {
+                        speed_sweep_abort();
+                        Serial.println("WS: Sweep abort");
+                    } else if (strcmp(action, "sweep") == 0) {
+                        client->text(speed_sweep_build_json(true));
+
+                    // --- Start-of-motion search ---
+                    } else if (strcmp(action, "motion_search_start") == 0) {
+                        int lowStep = doc["low_step"] | 0;
+                        int highStep = doc["high_step"] | 0;
+                        motion_search_start(lowStep, highStep);
+                        Serial.println("WS: Motion search start");
+                    } else if (strcmp(action, "motion_search_abort") == 0) {
+                        motion_search_abort();
+                        Serial.println("WS: Motion search abort");
+
+                    // --- Momentum profiling ---
+                    } else if (strcmp(action, "momentum_start") == 0) {
+                        momentum_start(momentum_params_from_json(cmd));
+                        Serial.println("WS: Momentum profile start");
+                    } else if (strcmp(action, "momentum_abort") == 0) {
+                        momentum_abort();
+                        Serial.println("WS: Momentum profile abort");
                     }
                 }
             }
@@ -146,7 +201,8 @@ static String buildStatusJson() {
     doc["state"] = sensor_state_name(sensor_get_state());
     doc["sensors"] = NUM_SENSORS;
     doc["spacing_mm"] = SENSOR_SPACING_MM;
-    doc["scale_factor"] = HO_SCALE_FACTOR;
+    doc["scale"] = speed_scale_name(speed_get_scale());
+    doc["scale_factor"] = speed_scale_ratio(speed_get_scale());
     doc["wifi_mode"] = wifi_is_sta() ? "STA" : "AP";
     doc["ip"] = wifi_get_ip();
     doc["ssid"] = wifi_get_ssid();
@@ -156,6 +212,14 @@ static String buildStatusJson() {
     doc["mqtt_prefix"] = mqtt_get_prefix();
     doc["mqtt_name"] = mqtt_get_name();
     doc["uptime_ms"] = millis();
+    doc["isr_overflows"] = sensor_get_event_overflows();
+    doc["isr_high_water"] = sensor_get_event_high_water();
+    doc["streaming"] = sensor_is_streaming();
+    doc["results_dropped"] = sensor_get_results_dropped();
+    doc["early_stop_intervals"] = sensor_get_early_stop_intervals();
+    doc["early_stop_tol_pct"] = serialized(String(sensor_get_early_stop_tolerance() * 100.0f, 1));
+    doc["wheel_mm"] = serialized(String(vibration_get_wheel_dia_mm(), 2));
+    doc["mesh_order"] = vibration_get_mesh_order();
 
     // Include throttle state in status message
     doc["throttle_acquired"] = mqtt_get_throttle_acquired();
@@ -179,25 +243,34 @@ static String buildStatusJson() {
     return json;
 }
 
-static String buildResultJson() {
-    const RunResult& run = sensor_get_result();
+static String buildResultJson(const RunResult& run) {
     SpeedResult speed;
     bool hasSpeed = speed_calculate(run, speed);
 
     JsonDocument doc;
     doc["type"] = "result";
+    doc["seq"] = run.sequence;
+    doc["scale"] = speed_scale_name(speed_get_scale());
     doc["direction"] = (run.direction == DIR_A_TO_B) ? "A-B" :
                        (run.direction == DIR_B_TO_A) ? "B-A" : "unknown";
     doc["sensors_triggered"] = run.sensorsTriggered;
     doc["duration_ms"] = run.runDurationUs / 1000.0f;
+    if (run.earlyTerminated) {
+        doc["early_terminated"] = true;
+    }
 
     // Raw timestamps relative to first trigger
-    uint32_t firstTs = UINT32_MAX;
+    uint64_t firstTs = UINT64_MAX;
     for (int i = 0; i < NUM_SENSORS; i++) {
         if (run.triggered[i] && run.timestamps[i] < firstTs) {
             firstTs = run.timestamps[i];
         }
     }
+    // Absolute first-trigger time on the shared 64-bit timebase, so
+    // vibration/audio/load results can be placed relative to crossings
+    if (run.sensorsTriggered > 0) {
+        doc["t0_us"] = firstTs;
+    }
     JsonArray ts = doc["timestamps_us"].to<JsonArray>();
     JsonArray trig = doc["triggered"].to<JsonArray>();
     for (int i = 0; i < NUM_SENSORS; i++) {
@@ -215,6 +288,35 @@ static String buildResultJson() {
             speeds_mph.add(serialized(String(speed.scaleSpeedsMph[i], 1)));
         }
         doc["avg_speed_mph"] = serialized(String(speed.avgScaleSpeedMph, 1));
+
+        // Trailing-edge estimate (sensor clear times)
+        if (speed.trailingIntervalCount > 0) {
+            JsonArray trail_mph = doc["trailing_speeds_mph"].to<JsonArray>();
+            for (int i = 0; i < speed.trailingIntervalCount; i++) {
+                trail_mph.add(serialized(String(speed.trailingScaleSpeedsMph[i], 1)));
+            }
+            doc["trailing_avg_speed_mph"] = serialized(String(speed.trailingAvgScaleSpeedMph, 1));
+            doc["combined_avg_speed_mph"] = serialized(String(speed.combinedAvgScaleSpeedMph, 1));
+        }
+        if (speed.locoLengthMm > 0) {
+            doc["loco_length_mm"] = serialized(String(speed.locoLengthMm, 1));
+        }
+
+        // Position/time regression: speed at mean crossing with 95% CI
+        if (speed.fit.valid) {
+            doc["fit_speed_mph"] = serialized(String(speed.fit.scaleSpeedMph, 2));
+            doc["fit_ci95_mph"] = serialized(String(speed.fit.scaleCi95Mph, 2));
+            doc["fit_accel_mm_s2"] = serialized(String(speed.fit.accelMmS2, 1));
+            doc["fit_rms_mm"] = serialized(String(speed.fit.residualRmsMm, 2));
+            doc["fit_points"] = speed.fit.points;
+        }
+    }
+
+    // Per-sensor dwell (block to clear), -1 if the sensor never cleared
+    doc["sensors_cleared"] = run.sensorsCleared;
+    JsonArray dwell = doc["dwell_us"].to<JsonArray>();
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        dwell.add(run.dwellUs[i] > 0 ? (long)run.dwellUs[i] : -1);
     }
 
     String json;
@@ -222,6 +324,26 @@ static String buildResultJson() {
     return json;
 }
 
+static String buildIntervalJson(const IntervalEvent& ev) {
+    float mmS = ev.gapMm * 1000000.0f / ev.intervalUs;
+
+    JsonDocument doc;
+    doc["type"] = "interval";
+    doc["seq"] = ev.sequence;
+    doc["direction"] = (ev.direction == DIR_A_TO_B) ? "A-B" : "B-A";
+    doc["index"] = ev.index;
+    doc["from"] = ev.fromSensor;
+    doc["to"] = ev.toSensor;
+    doc["interval_us"] = ev.intervalUs;
+    doc["speed_mm_s"] = serialized(String(mmS, 1));
+    doc["speed_mph"] = serialized(String(speed_mms_to_mph(mmS), 1));
+    doc["t_us"] = ev.timestampUs;
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
 static String buildThrottleStatusJson() {
     JsonDocument doc;
     doc["type"] = "throttle";
@@ -244,8 +366,14 @@ void web_send_status() {
     mqtt_publish_status(json);
 }
 
-void web_send_result() {
-    String json = buildResultJson();
+void web_send_interval(const IntervalEvent& ev) {
+    String json = buildIntervalJson(ev);
+    ws.textAll(json);
+    mqtt_publish_interval(json);
+}
+
+void web_send_result(const RunResult& run) {
+    String json = buildResultJson(run);
     ws.textAll(json);
     mqtt_publish_result(json);
     // Also print to serial for debugging
@@ -264,6 +392,12 @@ void web_send_vibration() {
     mqtt_publish_vibration(json);
 }
 
+void web_send_order() {
+    String json = vibration_build_order_json();
+    ws.textAll(json);
+    mqtt_publish_order(json);
+}
+
 void web_send_audio() {
     String json = audio_build_json();
     ws.textAll(json);
@@ -276,9 +410,38 @@ void web_send_throttle_status() {
 }
 
 void web_send_pull_test() {
-    String json = pull_test_build_json();
+    ws.textAll(pull_test_build_json(true));
+    mqtt_publish_pull_test(pull_test_build_json(false));
+}
+
+void web_send_sweep_step() {
+    String json = speed_sweep_build_step_json();
+    ws.textAll(json);
+    mqtt_publish_sweep_step(json);
+}
+
+void web_send_sweep() {
+    ws.textAll(speed_sweep_build_json(true));
+    mqtt_publish_sweep(speed_sweep_build_json(false));
+
+    // Full step table, interpolated between measured steps
+    String table = speed_sweep_build_table_json();
+    if (table.length() > 0) {
+        ws.textAll(table);
+        mqtt_publish_speed_table(table);
+    }
+}
+
+void web_send_momentum() {
+    String json = momentum_build_json();
+    ws.textAll(json);
+    mqtt_publish_momentum(json);
+}
+
+void web_send_motion_search() {
+    String json = motion_search_build_json();
     ws.textAll(json);
-    mqtt_publish_pull_test(json);
+    mqtt_publish_motion_search(json);
 }
 
 void web_send_pull_progress() {
@@ -412,7 +575,7 @@ void web_init() {
         req->send(200, "application/json", vibration_build_json());
     });
     server.on("/api/vibration", HTTP_POST, [](AsyncWebServerRequest* req) {
-        vibration_start_capture();
+        vibration_start_capture(VIBRATION_CAPTURE_MS);
         req->send(200, "application/json", "{\"ok\":true,\"msg\":\"capture started\"}");
     });
 
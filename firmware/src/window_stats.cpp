@@ -0,0 +1,64 @@
+#include "window_stats.h"
+
+#include <math.h>
+#include <string.h>
+
+// Median of n values (n <= WINDOW_STATS_MAX). Sorts a copy.
+static float medianOf(const float* v, int n) {
+    static float tmp[WINDOW_STATS_MAX];
+    memcpy(tmp, v, n * sizeof(float));
+    // Insertion sort: a few hundred samples, called once per reading
+    for (int i = 1; i < n; i++) {
+        float x = tmp[i];
+        int j = i - 1;
+        while (j >= 0 && tmp[j] > x) {
+            tmp[j + 1] = tmp[j];
+            j--;
+        }
+        tmp[j + 1] = x;
+    }
+    return (n % 2) ? tmp[n / 2] : 0.5f * (tmp[n / 2 - 1] + tmp[n / 2]);
+}
+
+bool window_stats_steady(const WindowStats& s, float maxSlopePerS, float maxStddev,
+                         float relTol) {
+    if (s.count < 2) return false;
+    float rel = relTol * fabsf(s.mean);
+    float sdLimit = maxStddev > rel ? maxStddev : rel;
+    return fabsf(s.slopePerS) <= maxSlopePerS && s.stddev <= sdLimit;
+}
+
+bool window_stats_compute(const float* values, const uint64_t* timesUs, int n,
+                          WindowStats& out) {
+    memset(&out, 0, sizeof(out));
+    if (n < 1) return false;
+    if (n > WINDOW_STATS_MAX) n = WINDOW_STATS_MAX;
+
+    // Welford mean/variance, plus time moments for the slope. Times are
+    // relative to the first sample to keep the float sums well conditioned.
+    double mean = 0, m2 = 0;
+    double tMean = 0, tM2 = 0, cov = 0;
+    out.min = values[0];
+    out.max = values[0];
+    for (int i = 0; i < n; i++) {
+        double x = values[i];
+        double t = (timesUs[i] - timesUs[0]) / 1000000.0;
+        double dx = x - mean;
+        double dt = t - tMean;
+        mean += dx / (i + 1);
+        tMean += dt / (i + 1);
+        m2 += dx * (x - mean);
+        tM2 += dt * (t - tMean);
+        cov += dt * (x - mean);
+        if (values[i] < out.min) out.min = values[i];
+        if (values[i] > out.max) out.max = values[i];
+    }
+
+    out.count = n;
+    out.mean = (float)mean;
+    out.median = medianOf(values, n);
+    out.stddev = (n > 1) ? (float)sqrt(m2 / (n - 1)) : 0.0f;
+    out.slopePerS = (tM2 > 0) ? (float)(cov / tM2) : 0.0f;
+    out.spanS = (timesUs[n - 1] - timesUs[0]) / 1000000.0f;
+    return true;
+}
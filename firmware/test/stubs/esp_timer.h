@@ -0,0 +1,20 @@
+/**
+ * esp_timer.h stub for native (desktop) unit tests.
+ *
+ * Backs timebase_now_us() with a controllable fake clock so tests can
+ * place events anywhere on the 64-bit timeline, including past the
+ * point where a 32-bit micros() would have wrapped.
+ */
+#pragma once
+
+#include <cstdint>
+
+inline int64_t fake_esp_timer_us = 0;
+
+inline int64_t esp_timer_get_time() { return fake_esp_timer_us; }
+
+// Set the fake clock to an absolute time (us since "boot").
+inline void fake_clock_set_us(uint64_t us) { fake_esp_timer_us = (int64_t)us; }
+
+// Advance the fake clock.
+inline void fake_clock_advance_us(uint64_t us) { fake_esp_timer_us += (int64_t)us; }
@@ -0,0 +1,196 @@
+/**
+ * Unit tests for event_ring.h
+ *
+ * Tests the lock-free SPSC ring that carries sensor ISR timestamps
+ * to sensor_update(): ordering, overflow accounting, wrap-around,
+ * and a two-thread flood standing in for ISR vs. a stalled loop().
+ * Runs natively on desktop (no hardware needed).
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "Arduino.h"   // stub
+#include "config.h"
+#include "event_ring.h"
+
+#include <thread>
+
+// --- Stubs ---
+FakeSerial Serial;
+uint32_t millis() { return 0; }
+uint32_t micros() { return 0; }
+
+struct TestEvent {
+    uint32_t seq;
+    uint32_t timestampUs;
+};
+
+// ================================================================
+// Tests
+// ================================================================
+
+void test_empty_pop_fails(void) {
+    EventRing<TestEvent, 8> ring;
+    TestEvent ev;
+    TEST_ASSERT_FALSE(ring.pop(ev));
+    TEST_ASSERT_FALSE(ring.peek(ev));
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.overflows());
+}
+
+void test_fifo_order(void) {
+    EventRing<TestEvent, 8> ring;
+    for (uint32_t i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(ring.push({i, 1000 + i * 10}));
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, ring.size());
+
+    TestEvent ev;
+    for (uint32_t i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(ring.pop(ev));
+        TEST_ASSERT_EQUAL_UINT32(i, ev.seq);
+        TEST_ASSERT_EQUAL_UINT32(1000 + i * 10, ev.timestampUs);
+    }
+    TEST_ASSERT_FALSE(ring.pop(ev));
+}
+
+void test_all_slots_usable(void) {
+    // Free-running counters: capacity N holds N events, not N-1
+    EventRing<TestEvent, 8> ring;
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(ring.push({i, 0}));
+    }
+    TEST_ASSERT_FALSE(ring.push({8, 0}));
+    TEST_ASSERT_EQUAL_UINT32(8, ring.size());
+    TEST_ASSERT_EQUAL_UINT32(1, ring.overflows());
+}
+
+void test_flood_keeps_oldest_and_counts_drops(void) {
+    // Burst of 10x capacity with no consumer (loop stalled in MQTT)
+    EventRing<TestEvent, SENSOR_EVENT_RING_SIZE> ring;
+    const uint32_t burst = SENSOR_EVENT_RING_SIZE * 10;
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < burst; i++) {
+        if (ring.push({i, i * 100})) accepted++;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_EVENT_RING_SIZE, accepted);
+    TEST_ASSERT_EQUAL_UINT32(burst - SENSOR_EVENT_RING_SIZE, ring.overflows());
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_EVENT_RING_SIZE, ring.high_water());
+
+    // The consumer sees the first edges of the burst, in order
+    TestEvent ev;
+    for (uint32_t i = 0; i < SENSOR_EVENT_RING_SIZE; i++) {
+        TEST_ASSERT_TRUE(ring.pop(ev));
+        TEST_ASSERT_EQUAL_UINT32(i, ev.seq);
+    }
+    TEST_ASSERT_FALSE(ring.pop(ev));
+
+    // Recovers once drained
+    TEST_ASSERT_TRUE(ring.push({999, 0}));
+    TEST_ASSERT_TRUE(ring.pop(ev));
+    TEST_ASSERT_EQUAL_UINT32(999, ev.seq);
+}
+
+void test_wraparound_many_cycles(void) {
+    // Interleave bursts and drains so indices wrap the slot array many times
+    EventRing<TestEvent, 4> ring;
+    uint32_t nextPush = 0, nextPop = 0;
+    TestEvent ev;
+    for (int cycle = 0; cycle < 1000; cycle++) {
+        int n = 1 + (cycle % 4);
+        for (int i = 0; i < n; i++) {
+            TEST_ASSERT_TRUE(ring.push({nextPush++, 0}));
+        }
+        for (int i = 0; i < n; i++) {
+            TEST_ASSERT_TRUE(ring.pop(ev));
+            TEST_ASSERT_EQUAL_UINT32(nextPop++, ev.seq);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ring.overflows());
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_peek_does_not_consume(void) {
+    EventRing<TestEvent, 4> ring;
+    ring.push({7, 70});
+    TestEvent ev;
+    TEST_ASSERT_TRUE(ring.peek(ev));
+    TEST_ASSERT_EQUAL_UINT32(7, ev.seq);
+    TEST_ASSERT_EQUAL_UINT32(1, ring.size());
+    TEST_ASSERT_TRUE(ring.pop(ev));
+    TEST_ASSERT_EQUAL_UINT32(7, ev.seq);
+}
+
+void test_clear_discards_pending(void) {
+    // sensor_arm() discards edges queued before arming
+    EventRing<TestEvent, 8> ring;
+    for (uint32_t i = 0; i < 6; i++) ring.push({i, 0});
+    ring.clear();
+    TEST_ASSERT_TRUE(ring.empty());
+
+    TestEvent ev;
+    TEST_ASSERT_FALSE(ring.pop(ev));
+    ring.push({42, 0});
+    TEST_ASSERT_TRUE(ring.pop(ev));
+    TEST_ASSERT_EQUAL_UINT32(42, ev.seq);
+}
+
+void test_concurrent_flood(void) {
+    // Producer thread hammers the ring like back-to-back interrupts while
+    // the consumer drains in bursts with stalls. Every accepted event must
+    // arrive exactly once and in order; accepted + dropped == produced.
+    static EventRing<TestEvent, SENSOR_EVENT_RING_SIZE> ring;
+    const uint32_t produced = 200000;
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < produced; i++) {
+            ring.push({i, i});
+        }
+    });
+
+    uint32_t received = 0;
+    uint32_t lastSeq = 0;
+    bool ordered = true;
+    bool producerDone = false;
+    TestEvent ev;
+    while (true) {
+        int burst = 0;
+        while (burst < 64 && ring.pop(ev)) {
+            if (received > 0 && ev.seq <= lastSeq) ordered = false;
+            lastSeq = ev.seq;
+            received++;
+            burst++;
+        }
+        if (producerDone && ring.empty()) break;
+        if (!producerDone && received + ring.overflows() + ring.size() >= produced) {
+            producer.join();
+            producerDone = true;
+        }
+        std::this_thread::yield();  // Simulated loop() stall
+    }
+
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_UINT32(produced, received + ring.overflows());
+    TEST_ASSERT_TRUE(ring.high_water() <= SENSOR_EVENT_RING_SIZE);
+}
+
+// ================================================================
+// Test runner
+// ================================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_empty_pop_fails);
+    RUN_TEST(test_fifo_order);
+    RUN_TEST(test_all_slots_usable);
+    RUN_TEST(test_flood_keeps_oldest_and_counts_drops);
+    RUN_TEST(test_wraparound_many_cycles);
+    RUN_TEST(test_peek_does_not_consume);
+    RUN_TEST(test_clear_discards_pending);
+    RUN_TEST(test_concurrent_flood);
+
+    return UNITY_END();
+}
@@ -0,0 +1,176 @@
+/**
+ * Unit tests for fft.cpp
+ *
+ * Tests the Q15 radix-2 FFT against a double-precision DFT, the Hann
+ * window, peak picking with interpolation, band power and spectral
+ * centroid, and benchmarks the 1024-point kernel.
+ * Runs natively on desktop (no hardware needed).
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "fft.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Pull in the implementation directly for native builds
+#include "../../src/fft.cpp"
+
+static const double PI = 3.14159265358979323846;
+
+// Real test signal: a few tones plus a deterministic "noise" term
+static void fillSignal(int16_t* re, int16_t* im, int n) {
+    uint32_t lcg = 12345;
+    for (int i = 0; i < n; i++) {
+        lcg = lcg * 1103515245u + 12345u;
+        double noise = ((int)((lcg >> 16) & 0x7FF) - 1024) * 1.0;
+        double v = 9000 * cos(2 * PI * 37 * i / n) + 5000 * sin(2 * PI * 210.5 * i / n) + noise;
+        re[i] = (int16_t)lround(v);
+        im[i] = 0;
+    }
+}
+
+// --- Tests ---
+
+void test_fft_dc(void) {
+    int16_t re[64], im[64];
+    for (int i = 0; i < 64; i++) { re[i] = 1000; im[i] = 0; }
+    fft_q15(re, im, 6);
+    TEST_ASSERT_INT_WITHIN(2, 1000, re[0]);
+    for (int k = 1; k < 64; k++) {
+        TEST_ASSERT_INT_WITHIN(2, 0, re[k]);
+        TEST_ASSERT_INT_WITHIN(2, 0, im[k]);
+    }
+}
+
+void test_fft_cosine_bin(void) {
+    // Cosine amplitude A at bin 16: A/2 in bins 16 and n-16
+    const int n = 256;
+    int16_t re[n], im[n];
+    for (int i = 0; i < n; i++) {
+        re[i] = (int16_t)lround(20000 * cos(2 * PI * 16 * i / n));
+        im[i] = 0;
+    }
+    fft_q15(re, im, 8);
+    TEST_ASSERT_INT_WITHIN(8, 10000, re[16]);
+    TEST_ASSERT_INT_WITHIN(8, 10000, re[n - 16]);
+    TEST_ASSERT_INT_WITHIN(8, 0, im[16]);
+    TEST_ASSERT_INT_WITHIN(8, 0, re[15]);
+}
+
+void test_fft_matches_dft(void) {
+    const int n = FFT_MAX_SIZE;
+    static int16_t re[n], im[n], in[n], zero[n];
+    fillSignal(in, zero, n);
+    memcpy(re, in, sizeof(re));
+    memset(im, 0, sizeof(im));
+    fft_q15(re, im, FFT_MAX_LOG2);
+
+    // Halving each stage costs ~half an LSB per stage at worst
+    double maxErr = 0;
+    for (int k = 0; k < n; k += 7) {
+        double sr = 0, si = 0;
+        for (int i = 0; i < n; i++) {
+            sr += in[i] * cos(2 * PI * k * i / n);
+            si -= in[i] * sin(2 * PI * k * i / n);
+        }
+        maxErr = fmax(maxErr, fabs(sr / n - re[k]));
+        maxErr = fmax(maxErr, fabs(si / n - im[k]));
+    }
+    TEST_ASSERT_TRUE(maxErr < 6.0);
+}
+
+void test_fft_full_scale_no_overflow(void) {
+    // Alternating full scale: all energy in the Nyquist bin
+    const int n = 128;
+    int16_t re[n], im[n];
+    for (int i = 0; i < n; i++) { re[i] = (i % 2) ? -32767 : 32767; im[i] = 0; }
+    fft_q15(re, im, 7);
+    // Q15 twiddles top out at 32767/32768 and halving rounds: about
+    // 1 LSB per stage either way
+    TEST_ASSERT_INT_WITHIN(8, 32767, re[n / 2]);
+    TEST_ASSERT_INT_WITHIN(8, 0, re[0]);
+}
+
+void test_hann_window(void) {
+    const int n = 256;
+    int16_t x[n];
+    for (int i = 0; i < n; i++) x[i] = 20000;
+    fft_window_hann(x, n);
+    TEST_ASSERT_INT_WITHIN(1, 0, x[0]);
+    TEST_ASSERT_INT_WITHIN(2, 20000, x[n / 2]);
+    TEST_ASSERT_INT_WITHIN(2, 10000, x[n / 4]);
+    TEST_ASSERT_INT_WITHIN(2, x[n / 4], x[3 * n / 4]);
+}
+
+void test_peaks_find_tones(void) {
+    const int n = FFT_MAX_SIZE;
+    static int16_t re[n], im[n];
+    fillSignal(re, im, n);
+    fft_window_hann(re, n);
+    fft_q15(re, im, FFT_MAX_LOG2);
+    static float power[n / 2 + 1];
+    memset(power, 0, sizeof(power));
+    fft_accumulate_power(re, im, n, power);
+    static float mag[n / 2 + 1];
+    for (int k = 0; k <= n / 2; k++) mag[k] = sqrtf(power[k]);
+
+    // Bin width 1 Hz: tones at 37 and 210.5
+    SpectrumPeak peaks[4];
+    int found = spectrum_peaks(mag, n / 2 + 1, 1.0f, 100.0f, peaks, 4);
+    TEST_ASSERT_TRUE(found >= 2);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 37.0f, peaks[0].hz);
+    TEST_ASSERT_FLOAT_WITHIN(0.25f, 210.5f, peaks[1].hz);
+    TEST_ASSERT_TRUE(peaks[0].magnitude > peaks[1].magnitude);
+}
+
+void test_band_power_and_centroid(void) {
+    float power[11] = {100, 0, 0, 4, 0, 0, 0, 0, 0, 4, 0};   // 0..1000 Hz, 100 Hz bins
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 4.0f, spectrum_band_power(power, 11, 100.0f, 250, 500));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 108.0f, spectrum_band_power(power, 11, 100.0f, 0, 1000));
+    // DC excluded: equal power at 300 and 900 Hz
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 600.0f, spectrum_centroid(power, 11, 100.0f));
+}
+
+void test_fft_benchmark(void) {
+    // A 10 kHz, 500 ms capture is ~9 half-overlapped 1024-point frames
+    const int n = FFT_MAX_SIZE;
+    static int16_t src[n], re[n], im[n];
+    fillSignal(src, im, n);
+    const int runs = 2000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++) {
+        memcpy(re, src, sizeof(re));
+        memset(im, 0, sizeof(im));
+        fft_window_hann(re, n);
+        fft_q15(re, im, FFT_MAX_LOG2);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(t1 - t0).count() / runs;
+    printf("  fft_q15 %d-point + Hann: %.1f us (host)\n", n, us);
+    TEST_ASSERT_TRUE(us > 0);
+}
+
+
+// ================================================================
+// Test runner
+// ================================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fft_dc);
+    RUN_TEST(test_fft_cosine_bin);
+    RUN_TEST(test_fft_matches_dft);
+    RUN_TEST(test_fft_full_scale_no_overflow);
+    RUN_TEST(test_hann_window);
+    RUN_TEST(test_peaks_find_tones);
+    RUN_TEST(test_band_power_and_centroid);
+    RUN_TEST(test_fft_benchmark);
+
+    return UNITY_END();
+}
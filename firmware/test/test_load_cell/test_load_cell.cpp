@@ -1,7 +1,8 @@
 /**
  * Unit tests for load_cell.cpp
  *
- * Tests raw-to-grams conversion and EMA filter math.
+ * Tests raw-to-grams conversion, EMA filter math and the HX711 SPI
+ * frame encoding.
  * Runs natively on desktop (no hardware needed).
  *
  * Run with: pio test -e native
@@ -10,6 +11,7 @@
 #include <unity.h>
 #include "Arduino.h"   // stub
 #include "config.h"
+#include "hx711.h"
 
 // --- Stubs ---
 FakeSerial Serial;
@@ -98,6 +100,50 @@ void test_large_raw_value(void) {
     TEST_ASSERT_FLOAT_WITHIN(1.0f, 19047.6f, g);
 }
 
+// Build the frame MISO would return for a 24-bit reading. The even
+// (SCK high) bits are filled with `noise` to check they are ignored.
+static void encodeFrame(int32_t value, bool noise, uint8_t* rx) {
+    memset(rx, noise ? 0xFF : 0x00, HX711_FRAME_BYTES);
+    uint32_t bits = (uint32_t)value & 0xFFFFFF;
+    for (int k = 0; k < 24; k++) {
+        int bit = 2 * k + 1;
+        uint8_t mask = 1 << (7 - (bit & 7));
+        if ((bits >> (23 - k)) & 1) rx[bit >> 3] |= mask;
+        else rx[bit >> 3] &= ~mask;
+    }
+}
+
+void test_hx711_clock_pattern(void) {
+    // 25 rising edges, SCK LOW at the end (HIGH > 60us powers down)
+    uint8_t tx[HX711_FRAME_BYTES];
+    hx711_clock_pattern(tx);
+    int rising = 0;
+    int prev = 0;
+    for (int bit = 0; bit < HX711_FRAME_BYTES * 8; bit++) {
+        int level = (tx[bit >> 3] >> (7 - (bit & 7))) & 1;
+        if (level && !prev) rising++;
+        prev = level;
+    }
+    TEST_ASSERT_EQUAL_INT(25, rising);
+    TEST_ASSERT_EQUAL_INT(0, prev);
+}
+
+void test_hx711_decode_positive(void) {
+    uint8_t rx[HX711_FRAME_BYTES];
+    encodeFrame(0x123456, true, rx);
+    TEST_ASSERT_EQUAL_INT(0x123456, hx711_decode_frame(rx));
+    encodeFrame(0x7FFFFF, false, rx);
+    TEST_ASSERT_EQUAL_INT(8388607, hx711_decode_frame(rx));
+}
+
+void test_hx711_decode_negative(void) {
+    uint8_t rx[HX711_FRAME_BYTES];
+    encodeFrame(-1234, true, rx);
+    TEST_ASSERT_EQUAL_INT(-1234, hx711_decode_frame(rx));
+    encodeFrame(-8388608, false, rx);
+    TEST_ASSERT_EQUAL_INT(-8388608, hx711_decode_frame(rx));
+}
+
 // ================================================================
 // Test runner
 // ================================================================
@@ -114,6 +160,9 @@ int main(int argc, char **argv) {
     RUN_TEST(test_ema_convergence);
     RUN_TEST(test_ema_half_alpha);
     RUN_TEST(test_large_raw_value);
+    RUN_TEST(test_hx711_clock_pattern);
+    RUN_TEST(test_hx711_decode_positive);
+    RUN_TEST(test_hx711_decode_negative);
 
     return UNITY_END();
 }
@@ -0,0 +1,197 @@
+/**
+ * Unit tests for order_track.cpp
+ *
+ * Tests the speed fit to wheel revolution mapping, angle-domain
+ * resampling (including an accelerating pass), order amplitudes, the
+ * energy split between 1x, 2x and the gear-mesh order, and the
+ * decimator that holds a whole crawl-speed pass.
+ * Runs natively on desktop (no hardware needed).
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "order_track.h"
+
+#include <math.h>
+
+// Pull in the implementation directly for native builds
+#include "../../src/order_track.cpp"
+
+static const float WHEEL_MM = 10.0f;           // 31.4mm per revolution
+static const float SAMPLE_HZ = 10000.0f;
+static const int PER_REV = 64;
+
+static uint16_t samples[6000];
+static float scratch[64 * 16];
+
+// Fill samples with tones locked to wheel angle: amps[k] at order k.
+static void fillOrders(int count, float v, float a, const float* amps, int orders) {
+    for (int i = 0; i < count; i++) {
+        float r = order_track_revs(i / SAMPLE_HZ, v, a, WHEEL_MM);
+        float x = 2048;
+        for (int k = 1; k < orders; k++) {
+            x += amps[k] * sinf(2.0f * (float)M_PI * k * r);
+        }
+        samples[i] = (uint16_t)lroundf(x);
+    }
+}
+
+// --- Tests ---
+
+void test_revs_from_speed_fit(void) {
+    float v = (float)M_PI * WHEEL_MM;   // One revolution per second
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f, order_track_revs(2.0f, v, 0, WHEEL_MM));
+    // Accelerating: x = v t + a/2 t^2
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 4.0f, order_track_revs(2.0f, v, v, WHEEL_MM));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, order_track_revs(2.0f, v, 0, 0));
+}
+
+void test_single_order_recovered(void) {
+    // 200mm/s: 6.4 rev/s, 500ms capture covers 3 whole revolutions
+    float amps[4] = {0, 0, 0, 40.0f};
+    fillOrders(5000, 200.0f, 0, amps, 4);
+    int n = order_track_resample(samples, 5000, SAMPLE_HZ, 0, 200.0f, 0, WHEEL_MM,
+                                 PER_REV, scratch, 64 * 16);
+    TEST_ASSERT_EQUAL_INT(3 * PER_REV, n);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 40.0f, order_track_amplitude(scratch, n, PER_REV, 3));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 0.0f, order_track_amplitude(scratch, n, PER_REV, 1));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 0.0f, order_track_amplitude(scratch, n, PER_REV, 2));
+}
+
+void test_accelerating_pass(void) {
+    // Speed doubles over the capture: a fixed-speed resample would smear
+    // the order, the fitted acceleration keeps it on one bin
+    float amps[3] = {0, 0, 30.0f};
+    fillOrders(5000, 150.0f, 300.0f, amps, 3);
+    OrderResult r;
+    TEST_ASSERT_TRUE(order_track_analyse(samples, 5000, SAMPLE_HZ, 0, 150.0f, 300.0f, WHEEL_MM,
+                                         0, PER_REV, scratch, 64 * 16, r));
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 30.0f, r.amp2x);
+
+    OrderResult flat;
+    order_track_analyse(samples, 5000, SAMPLE_HZ, 0, 225.0f, 0, WHEEL_MM,
+                        0, PER_REV, scratch, 64 * 16, flat);
+    TEST_ASSERT_LESS_THAN(20.0f, flat.amp2x);
+
+    // Rev rate at the midpoint: 150 + 300 * 0.25 = 225mm/s
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 225.0f / ((float)M_PI * WHEEL_MM), r.revHz);
+}
+
+void test_energy_split(void) {
+    float amps[21] = {0};
+    amps[1] = 60.0f;
+    amps[2] = 30.0f;
+    amps[20] = 20.0f;   // Gear mesh
+    fillOrders(5000, 250.0f, 0, amps, 21);
+    OrderResult r;
+    TEST_ASSERT_TRUE(order_track_analyse(samples, 5000, SAMPLE_HZ, 0, 250.0f, 0, WHEEL_MM,
+                                         20, PER_REV, scratch, 64 * 16, r));
+    TEST_ASSERT_EQUAL_INT(3, r.revs);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 60.0f, r.amp1x);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 30.0f, r.amp2x);
+    // Boxcar averaging attenuates order 20 of 64 by sinc(20/64) ~ 0.84
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, 20.0f * 0.84f, r.ampMesh);
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, 1.0f, r.frac1x + r.frac2x + r.fracMesh);
+    TEST_ASSERT_TRUE(r.frac1x > r.frac2x && r.frac2x > r.fracMesh);
+}
+
+void test_rejects_short_or_reversing_capture(void) {
+    float amps[2] = {0, 10.0f};
+    fillOrders(5000, 20.0f, 0, amps, 2);
+    OrderResult r;
+    // 20mm/s for 500ms is a third of a revolution
+    TEST_ASSERT_FALSE(order_track_analyse(samples, 5000, SAMPLE_HZ, 0, 20.0f, 0, WHEEL_MM,
+                                          0, PER_REV, scratch, 64 * 16, r));
+    TEST_ASSERT_FALSE(r.valid);
+    // Decelerating to a stop after 0.2 revolutions: nothing usable
+    TEST_ASSERT_EQUAL_INT(0, order_track_resample(samples, 5000, SAMPLE_HZ, 0, 40.0f, -200.0f,
+                                                  WHEEL_MM, PER_REV, scratch, 64 * 16));
+    // Reversing
+    TEST_ASSERT_EQUAL_INT(0, order_track_resample(samples, 5000, SAMPLE_HZ, 0, -200.0f, 0,
+                                                  WHEEL_MM, PER_REV, scratch, 64 * 16));
+}
+
+void test_rejects_undersampled_revolution(void) {
+    // 5000mm/s at 10kHz is ~63 samples per revolution, under 64
+    float amps[2] = {0, 10.0f};
+    fillOrders(5000, 5000.0f, 0, amps, 2);
+    TEST_ASSERT_EQUAL_INT(0, order_track_resample(samples, 5000, SAMPLE_HZ, 0, 5000.0f, 0,
+                                                  WHEEL_MM, PER_REV, scratch, 64 * 16));
+    // Scratch limits the revolutions analysed
+    fillOrders(5000, 1000.0f, 0, amps, 2);
+    TEST_ASSERT_EQUAL_INT(4 * PER_REV, order_track_resample(samples, 5000, SAMPLE_HZ, 0, 1000.0f, 0,
+                                                            WHEEL_MM, PER_REV, scratch, 4 * PER_REV + 10));
+}
+
+void test_decimator_halves_when_full(void) {
+    uint16_t buf[8];
+    OrderDecimator d;
+    order_decim_reset(d, buf, 8, 2);
+    uint16_t in[24];
+    for (int i = 0; i < 24; i++) in[i] = (uint16_t)(100 + 8 * i);
+    order_decim_add(d, in, 10);
+    order_decim_add(d, in + 10, 14);
+    // Full after 16 inputs: pairs averaged, now 4 inputs per output
+    TEST_ASSERT_EQUAL_INT(4, d.factor);
+    TEST_ASSERT_EQUAL_INT(6, d.count);
+    for (int k = 0; k < 6; k++) {
+        TEST_ASSERT_EQUAL_UINT16(112 + 32 * k, buf[k]);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 2500.0f, order_decim_rate_hz(d, SAMPLE_HZ));
+    TEST_ASSERT_FLOAT_WITHIN(1e-7f, 1.5f / SAMPLE_HZ, order_decim_offset_s(d, SAMPLE_HZ));
+}
+
+void test_crawl_speed_pass(void) {
+    // 20mm/s for 8s: 5 revolutions, 80000 samples at 10kHz, streamed in
+    // blocks through the decimator the way the sampler hands them over.
+    // Speed fit referenced to the middle of the pass.
+    static uint16_t decim[8192];
+    OrderDecimator d;
+    order_decim_reset(d, decim, 8192, 5);
+    const float v = 20.0f;
+    const float t0S = -4.0f;
+    const int total = 80000;
+    uint16_t block[256];
+    for (int i = 0; i < total; i += 256) {
+        int n = (total - i < 256) ? total - i : 256;
+        for (int j = 0; j < n; j++) {
+            float r = order_track_revs(t0S + (i + j) / SAMPLE_HZ, v, 0, WHEEL_MM);
+            float x = 2048 + 100.0f * sinf(2.0f * (float)M_PI * r)
+                           + 40.0f * sinf(2.0f * (float)M_PI * 2 * r);
+            block[j] = (uint16_t)lroundf(x);
+        }
+        order_decim_add(d, block, n);
+    }
+    TEST_ASSERT_EQUAL_INT(10, d.factor);
+    TEST_ASSERT_EQUAL_INT(8000, d.count);
+
+    OrderResult r;
+    TEST_ASSERT_TRUE(order_track_analyse(decim, d.count, order_decim_rate_hz(d, SAMPLE_HZ),
+                                         t0S + order_decim_offset_s(d, SAMPLE_HZ), v, 0, WHEEL_MM,
+                                         0, PER_REV, scratch, 64 * 16, r));
+    TEST_ASSERT_EQUAL_INT(5, r.revs);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 100.0f, r.amp1x);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 40.0f, r.amp2x);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, v / ((float)M_PI * WHEEL_MM), r.revHz);
+}
+
+
+// ================================================================
+// Test runner
+// ================================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_revs_from_speed_fit);
+    RUN_TEST(test_single_order_recovered);
+    RUN_TEST(test_accelerating_pass);
+    RUN_TEST(test_energy_split);
+    RUN_TEST(test_rejects_short_or_reversing_capture);
+    RUN_TEST(test_rejects_undersampled_revolution);
+    RUN_TEST(test_decimator_halves_when_full);
+    RUN_TEST(test_crawl_speed_pass);
+
+    return UNITY_END();
+}
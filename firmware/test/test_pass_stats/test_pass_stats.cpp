@@ -0,0 +1,191 @@
+/**
+ * Unit tests for pass_stats.cpp
+ *
+ * Tests robust per-step aggregation of repeated speed passes: Welford
+ * mean/variance, median/MAD outlier rejection and the convergence rule
+ * the speed sweep uses to stop a step early.
+ * Runs natively on desktop (no hardware needed).
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "config.h"
+#include "pass_stats.h"
+
+// Pull in the implementation directly for native builds
+#include "../../src/pass_stats.cpp"
+
+// --- Tests ---
+
+void test_mean_and_stddev(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    const float v[] = {10.0f, 12.0f, 11.0f, 13.0f, 9.0f};
+    for (float x : v) TEST_ASSERT_TRUE(pass_stats_add(stats, x));
+
+    TEST_ASSERT_EQUAL_INT(5, stats.count);
+    TEST_ASSERT_EQUAL_INT(5, stats.inliers);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 11.0f, stats.mean);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 11.0f, stats.median);
+    // Sample variance of 9..13 = 2.5
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 2.5f, stats.variance);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, sqrtf(2.5f), pass_stats_stddev(stats));
+}
+
+void test_median_even_count(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    pass_stats_add(stats, 4.0f);
+    pass_stats_add(stats, 1.0f);
+    pass_stats_add(stats, 3.0f);
+    pass_stats_add(stats, 2.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 2.5f, stats.median);
+}
+
+void test_ci95_uses_student_t(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    pass_stats_add(stats, 10.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.0f, pass_stats_ci95(stats));
+
+    pass_stats_add(stats, 12.0f);
+    // n=2: s = sqrt(2), t(1) = 12.706, half-width = 12.706 * sqrt(2)/sqrt(2)
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.706f, pass_stats_ci95(stats));
+}
+
+void test_wheel_slip_rejected(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    // Wheel slip gives one fast pass; it must not drag the mean
+    pass_stats_add(stats, 20.1f);
+    pass_stats_add(stats, 19.9f);
+    pass_stats_add(stats, 20.0f);
+    TEST_ASSERT_FALSE(pass_stats_add(stats, 26.0f));
+    pass_stats_add(stats, 20.2f);
+
+    TEST_ASSERT_EQUAL_INT(1, pass_stats_rejected(stats));
+    TEST_ASSERT_FALSE(stats.inlier[3]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 20.05f, stats.mean);
+}
+
+void test_missed_sensor_rejected(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    // A missed sensor spans a double gap at the wrong spacing: ~half speed
+    pass_stats_add(stats, 15.0f);
+    pass_stats_add(stats, 7.6f);
+    pass_stats_add(stats, 15.1f);
+    pass_stats_add(stats, 14.9f);
+
+    TEST_ASSERT_EQUAL_INT(1, pass_stats_rejected(stats));
+    TEST_ASSERT_FALSE(stats.inlier[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 15.0f, stats.mean);
+}
+
+void test_no_rejection_below_three_passes(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    // Two disagreeing passes: no majority to say which is wrong
+    TEST_ASSERT_TRUE(pass_stats_add(stats, 10.0f));
+    TEST_ASSERT_TRUE(pass_stats_add(stats, 30.0f));
+    TEST_ASSERT_EQUAL_INT(0, pass_stats_rejected(stats));
+}
+
+void test_identical_passes_keep_small_deviations(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    // MAD is 0; the relative floor keeps a pass 0.5% off as an inlier
+    pass_stats_add(stats, 10.0f);
+    pass_stats_add(stats, 10.0f);
+    pass_stats_add(stats, 10.0f);
+    TEST_ASSERT_TRUE(pass_stats_add(stats, 10.05f));
+    TEST_ASSERT_EQUAL_INT(0, pass_stats_rejected(stats));
+}
+
+void test_earlier_pass_reclassified(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    // The first pass is wrong but only becomes an outlier once the
+    // following passes establish the median
+    pass_stats_add(stats, 5.0f);
+    pass_stats_add(stats, 10.0f);
+    TEST_ASSERT_TRUE(stats.inlier[0]);
+    pass_stats_add(stats, 10.1f);
+    pass_stats_add(stats, 9.9f);
+    TEST_ASSERT_FALSE(stats.inlier[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 10.0f, stats.mean);
+}
+
+void test_converges_on_tight_passes(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    pass_stats_add(stats, 20.00f);
+    TEST_ASSERT_FALSE(pass_stats_converged(stats, 0.02f, 2));
+    pass_stats_add(stats, 20.05f);
+    // n=2, half-width = 12.706 * 0.035/1.414 = 0.32 mph < 2% of 20
+    TEST_ASSERT_TRUE(pass_stats_converged(stats, 0.02f, 2));
+    // Not without enough inliers
+    TEST_ASSERT_FALSE(pass_stats_converged(stats, 0.02f, 3));
+}
+
+void test_not_converged_on_scatter(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    pass_stats_add(stats, 18.0f);
+    pass_stats_add(stats, 22.0f);
+    pass_stats_add(stats, 19.0f);
+    TEST_ASSERT_FALSE(pass_stats_converged(stats, 0.02f, 2));
+    // Disabled target never converges
+    TEST_ASSERT_FALSE(pass_stats_converged(stats, 0.0f, 1));
+}
+
+void test_single_pass_uses_fit_ci(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    pass_stats_add(stats, 20.0f, 0.2f);
+    TEST_ASSERT_TRUE(pass_stats_converged(stats, 0.02f, 1));
+
+    pass_stats_reset(stats);
+    pass_stats_add(stats, 20.0f, 0.6f);
+    TEST_ASSERT_FALSE(pass_stats_converged(stats, 0.02f, 1));
+
+    // No fit CI: one pass alone can't show convergence
+    pass_stats_reset(stats);
+    pass_stats_add(stats, 20.0f);
+    TEST_ASSERT_FALSE(pass_stats_converged(stats, 0.02f, 1));
+}
+
+void test_full_buffer_ignores_extra_passes(void) {
+    PassStats stats;
+    pass_stats_reset(stats);
+    for (int i = 0; i < PASS_STATS_MAX; i++) {
+        pass_stats_add(stats, 10.0f);
+    }
+    TEST_ASSERT_FALSE(pass_stats_add(stats, 10.0f));
+    TEST_ASSERT_EQUAL_INT(PASS_STATS_MAX, stats.count);
+}
+
+
+// ================================================================
+// Test runner
+// ================================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_mean_and_stddev);
+    RUN_TEST(test_median_even_count);
+    RUN_TEST(test_ci95_uses_student_t);
+    RUN_TEST(test_wheel_slip_rejected);
+    RUN_TEST(test_missed_sensor_rejected);
+    RUN_TEST(test_no_rejection_below_three_passes);
+    RUN_TEST(test_identical_passes_keep_small_deviations);
+    RUN_TEST(test_earlier_pass_reclassified);
+    RUN_TEST(test_converges_on_tight_passes);
+    RUN_TEST(test_not_converged_on_scatter);
+    RUN_TEST(test_single_pass_uses_fit_ci);
+    RUN_TEST(test_full_buffer_ignores_extra_passes);
+
+    return UNITY_END();
+}
@@ -0,0 +1,64 @@
+/**
+ * Unit tests for pull_ramp.cpp
+ *
+ * Tests the ramp pull test's step binning and the adhesion-limit /
+ * stall plateau detector that ends the ramp.
+ * Runs natively on desktop (no hardware needed).
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "pull_ramp.h"
+
+// Pull in the implementation directly for native builds
+#include "../../src/pull_ramp.cpp"
+
+// --- Tests ---
+
+void test_bins_match_stepped_rows(void) {
+    // step_inc 5: rows 5, 10, ..., 125, 126
+    TEST_ASSERT_EQUAL_INT(0, pull_ramp_bin(1, 5));
+    TEST_ASSERT_EQUAL_INT(0, pull_ramp_bin(5, 5));
+    TEST_ASSERT_EQUAL_INT(1, pull_ramp_bin(6, 5));
+    TEST_ASSERT_EQUAL_INT(5, pull_ramp_bin_step(0, 5));
+    TEST_ASSERT_EQUAL_INT(125, pull_ramp_bin_step(24, 5));
+    TEST_ASSERT_EQUAL_INT(25, pull_ramp_bin(126, 5));
+    TEST_ASSERT_EQUAL_INT(126, pull_ramp_bin_step(25, 5));
+}
+
+void test_no_plateau_while_rising(void) {
+    float g[] = {0, 10, 25, 40, 60, 75, 90};
+    TEST_ASSERT_FALSE(pull_ramp_plateau(g, 7, 2, 0.02f, 20.0f));
+}
+
+void test_plateau_at_adhesion_limit(void) {
+    // Pull levels off around 120 g and then drops as the wheels slip
+    float g[] = {10, 40, 80, 110, 120, 121, 119, 100};
+    TEST_ASSERT_FALSE(pull_ramp_plateau(g, 5, 2, 0.02f, 20.0f));
+    TEST_ASSERT_FALSE(pull_ramp_plateau(g, 6, 2, 0.02f, 20.0f));  // 121: within 2%, no rise
+    TEST_ASSERT_TRUE(pull_ramp_plateau(g, 7, 2, 0.02f, 20.0f));
+    TEST_ASSERT_TRUE(pull_ramp_plateau(g, 8, 2, 0.02f, 20.0f));
+}
+
+void test_no_plateau_below_min_peak(void) {
+    // Loco not yet pulling: flat near zero is not a plateau
+    float g[] = {0.2f, 0.1f, 0.3f, 0.2f, 0.2f};
+    TEST_ASSERT_FALSE(pull_ramp_plateau(g, 5, 2, 0.02f, 20.0f));
+}
+
+
+// ================================================================
+// Test runner
+// ================================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_bins_match_stepped_rows);
+    RUN_TEST(test_no_plateau_while_rising);
+    RUN_TEST(test_plateau_at_adhesion_limit);
+    RUN_TEST(test_no_plateau_below_min_peak);
+
+    return UNITY_END();
+}
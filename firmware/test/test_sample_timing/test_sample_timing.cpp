@@ -0,0 +1,93 @@
+/**
+ * Unit tests for sample_timing.cpp
+ *
+ * Tests the vibration sampler's rate and jitter accounting: achieved
+ * rate, interval standard deviation, longest gap, late ticks and 32-bit
+ * timestamp wrap-around.
+ * Runs natively on desktop (no hardware needed).
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "sample_timing.h"
+
+// Pull in the implementation directly for native builds
+#include "../../src/sample_timing.cpp"
+
+// --- Tests ---
+
+void test_exact_rate_has_no_jitter(void) {
+    SampleTiming t;
+    sample_timing_reset(t, 100);
+    for (uint32_t i = 0; i < 1000; i++) sample_timing_add(t, 5000 + i * 100);
+    TEST_ASSERT_EQUAL_UINT32(1000, t.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10000.0f, sample_timing_rate_hz(t));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, sample_timing_jitter_us(t));
+    TEST_ASSERT_EQUAL_UINT32(100, t.maxIntervalUs);
+    TEST_ASSERT_EQUAL_UINT32(0, t.late);
+}
+
+void test_alternating_jitter(void) {
+    // 90/110 us alternating: mean 100, stddev 10
+    SampleTiming t;
+    sample_timing_reset(t, 100);
+    uint32_t ts = 0;
+    for (int i = 0; i < 201; i++) {
+        sample_timing_add(t, ts);
+        ts += (i % 2) ? 110 : 90;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 100.0f, t.meanIntervalUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 10.0f, sample_timing_jitter_us(t));
+    TEST_ASSERT_EQUAL_UINT32(0, t.late);
+}
+
+void test_missed_ticks_counted(void) {
+    // A WiFi burst delays two samples by a couple of periods
+    SampleTiming t;
+    sample_timing_reset(t, 100);
+    uint32_t ts = 0;
+    for (int i = 0; i < 100; i++) {
+        ts += (i == 30 || i == 60) ? 350 : 100;
+        sample_timing_add(t, ts);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, t.late);
+    TEST_ASSERT_EQUAL_UINT32(350, t.maxIntervalUs);
+    TEST_ASSERT_TRUE(sample_timing_rate_hz(t) < 10000.0f);
+    TEST_ASSERT_TRUE(sample_timing_jitter_us(t) > 10.0f);
+}
+
+void test_timestamp_wraparound(void) {
+    SampleTiming t;
+    sample_timing_reset(t, 50);
+    uint32_t ts = 0xFFFFFF00u;
+    for (int i = 0; i < 20; i++, ts += 50) sample_timing_add(t, ts);
+    TEST_ASSERT_EQUAL_UINT32(50, t.maxIntervalUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 20000.0f, sample_timing_rate_hz(t));
+}
+
+void test_too_few_samples(void) {
+    SampleTiming t;
+    sample_timing_reset(t, 100);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, sample_timing_rate_hz(t));
+    sample_timing_add(t, 10);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, sample_timing_rate_hz(t));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, sample_timing_jitter_us(t));
+}
+
+
+// ================================================================
+// Test runner
+// ================================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_exact_rate_has_no_jitter);
+    RUN_TEST(test_alternating_jitter);
+    RUN_TEST(test_missed_ticks_counted);
+    RUN_TEST(test_timestamp_wraparound);
+    RUN_TEST(test_too_few_samples);
+
+    return UNITY_END();
+}
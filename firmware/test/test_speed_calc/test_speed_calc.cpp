@@ -74,6 +74,42 @@ static RunResult makeUniformRun_BtoA(float speed_mm_s) {
     return r;
 }
 
+/**
+ * Add trailing edges to a uniform-speed run: each sensor clears
+ * length_mm / speed_mm_s after it blocked.
+ */
+static void addTrailingEdges(RunResult& r, float speed_mm_s, float length_mm) {
+    uint32_t dwell_us = (uint32_t)((length_mm / speed_mm_s) * 1000000.0f);
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        if (!r.triggered[i]) continue;
+        r.cleared[i] = true;
+        r.clearTimestamps[i] = r.timestamps[i] + dwell_us;
+        r.dwellUs[i] = dwell_us;
+        r.sensorsCleared++;
+    }
+}
+
+/**
+ * Build an A→B pass under constant acceleration:
+ * x = v0 t + a t^2 / 2, so each sensor fires at the positive root.
+ */
+static RunResult makeAcceleratingRun_AtoB(float v0_mm_s, float a_mm_s2) {
+    RunResult r;
+    memset(&r, 0, sizeof(r));
+    r.direction = DIR_A_TO_B;
+    r.sensorsTriggered = NUM_SENSORS;
+
+    uint64_t t0 = 1000000;
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        double x = i * (double)SENSOR_SPACING_MM;
+        double t = (-v0_mm_s + sqrt((double)v0_mm_s * v0_mm_s + 2.0 * a_mm_s2 * x)) / a_mm_s2;
+        r.triggered[i] = true;
+        r.timestamps[i] = t0 + (uint64_t)(t * 1000000.0 + 0.5);
+    }
+    r.runDurationUs = (uint32_t)(r.timestamps[NUM_SENSORS - 1] - r.timestamps[0]);
+    return r;
+}
+
 
 // ================================================================
 // Tests
@@ -331,6 +367,359 @@ void test_b_to_a_timestamps_reordered(void) {
 }
 
 
+void test_timestamps_across_32bit_wrap(void) {
+    // A pass ~72 minutes after boot straddles the point where a 32-bit
+    // micros() wraps. On the 64-bit timebase the intervals stay correct.
+    fake_clock_set_us(0xFFFFFFFFULL - 150000);  // 150ms before the old wrap
+
+    RunResult run;
+    memset(&run, 0, sizeof(run));
+    run.direction = DIR_A_TO_B;
+    run.sensorsTriggered = NUM_SENSORS;
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        run.triggered[i] = true;
+        run.timestamps[i] = timebase_now_us();
+        fake_clock_advance_us(100000);  // 100ms per sensor = 1000 mm/s
+    }
+    TEST_ASSERT_TRUE(run.timestamps[NUM_SENSORS - 1] > 0xFFFFFFFFULL);
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_EQUAL_INT(NUM_SENSORS - 1, result.intervalCount);
+    for (int i = 0; i < result.intervalCount; i++) {
+        TEST_ASSERT_EQUAL_UINT32(100000, result.intervalsUs[i]);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 1000.0f, result.intervalSpeedsMmS[i]);
+    }
+}
+
+
+void test_no_trailing_edges(void) {
+    // Leading edges only: trailing estimate and length stay zero
+    RunResult run = makeUniformRun_AtoB(500.0f);
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_EQUAL_INT(0, result.trailingIntervalCount);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, result.locoLengthMm);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, result.avgScaleSpeedMph, result.combinedAvgScaleSpeedMph);
+}
+
+
+void test_trailing_edges_match_leading(void) {
+    // Constant 400 mm/s, 200 mm loco: trailing intervals equal leading ones
+    float speed_mms = 400.0f;
+    RunResult run = makeUniformRun_AtoB(speed_mms);
+    addTrailingEdges(run, speed_mms, 200.0f);
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_EQUAL_INT(NUM_SENSORS - 1, result.trailingIntervalCount);
+    for (int i = 0; i < result.trailingIntervalCount; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, speed_mms, result.trailingSpeedsMmS[i]);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, result.avgScaleSpeedMph, result.trailingAvgScaleSpeedMph);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, speed_mms * EXPECTED_MMS_TO_MPH, result.combinedAvgScaleSpeedMph);
+}
+
+
+void test_trailing_edges_B_to_A(void) {
+    float speed_mms = 250.0f;
+    RunResult run = makeUniformRun_BtoA(speed_mms);
+    addTrailingEdges(run, speed_mms, 150.0f);
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_EQUAL_INT(NUM_SENSORS - 1, result.trailingIntervalCount);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, speed_mms * EXPECTED_MMS_TO_MPH, result.trailingAvgScaleSpeedMph);
+}
+
+
+void test_loco_length_from_dwell(void) {
+    // 180 mm loco at 300 mm/s occupies each sensor for 600 ms
+    float speed_mms = 300.0f;
+    RunResult run = makeUniformRun_AtoB(speed_mms);
+    addTrailingEdges(run, speed_mms, 180.0f);
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 180.0f, result.locoLengthMm);
+}
+
+
+void test_trailing_edge_missing_sensor(void) {
+    // Last sensor never cleared (loco stopped over it): one fewer interval
+    float speed_mms = 500.0f;
+    RunResult run = makeUniformRun_AtoB(speed_mms);
+    addTrailingEdges(run, speed_mms, 200.0f);
+    run.cleared[NUM_SENSORS - 1] = false;
+    run.dwellUs[NUM_SENSORS - 1] = 0;
+    run.sensorsCleared--;
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_EQUAL_INT(NUM_SENSORS - 1, result.intervalCount);
+    TEST_ASSERT_EQUAL_INT(NUM_SENSORS - 2, result.trailingIntervalCount);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 200.0f, result.locoLengthMm);
+}
+
+
+void test_fit_uniform_speed(void) {
+    float speed_mms = 500.0f;
+    RunResult run = makeUniformRun_AtoB(speed_mms);
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_TRUE(result.fit.valid);
+    TEST_ASSERT_EQUAL_INT(NUM_SENSORS, result.fit.points);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, speed_mms, result.fit.velocityMmS);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, 0.0f, result.fit.accelMmS2);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, result.fit.residualRmsMm);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, speed_mms * EXPECTED_MMS_TO_MPH, result.fit.scaleSpeedMph);
+}
+
+
+void test_fit_B_to_A_positive_velocity(void) {
+    float speed_mms = 300.0f;
+    RunResult run = makeUniformRun_BtoA(speed_mms);
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_TRUE(result.fit.valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, speed_mms, result.fit.velocityMmS);
+}
+
+
+void test_fit_recovers_acceleration(void) {
+    // 200 mm/s at sensor 0, accelerating at 400 mm/s^2
+    float v0 = 200.0f, accel = 400.0f;
+    RunResult run = makeAcceleratingRun_AtoB(v0, accel);
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_TRUE(result.fit.valid);
+    TEST_ASSERT_TRUE(result.fit.quadratic);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, accel, result.fit.accelMmS2);
+
+    // Velocity is reported at the mean crossing time
+    double tMean = 0;
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        tMean += (run.timestamps[i] - run.timestamps[0]) / 1000000.0;
+    }
+    tMean /= NUM_SENSORS;
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, v0 + accel * tMean, result.fit.velocityMmS);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, result.fit.residualRmsMm);
+}
+
+
+void test_fit_bridges_missing_sensor(void) {
+    // A missing middle sensor removes two intervals from the average but
+    // the fit still uses every remaining crossing
+    float speed_mms = 400.0f;
+    RunResult run = makeUniformRun_AtoB(speed_mms);
+    run.triggered[1] = false;
+    run.sensorsTriggered--;
+
+    SpeedResult result;
+    TEST_ASSERT_TRUE(speed_calculate(run, result));
+    TEST_ASSERT_EQUAL_INT(NUM_SENSORS - 1, result.fit.points);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, speed_mms, result.fit.velocityMmS);
+}
+
+
+void test_fit_two_points_is_linear(void) {
+    RunResult run = makeUniformRun_AtoB(250.0f);
+    for (int i = 2; i < NUM_SENSORS; i++) {
+        run.triggered[i] = false;
+    }
+    run.sensorsTriggered = 2;
+
+    SpeedFit fit;
+    TEST_ASSERT_TRUE(speed_fit(run.timestamps, run.triggered, run.direction, fit));
+    TEST_ASSERT_FALSE(fit.quadratic);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 250.0f, fit.velocityMmS);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, fit.accelMmS2);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, fit.velocityCi95MmS);  // No residual dof
+}
+
+
+void test_fit_jitter_gives_confidence_interval(void) {
+    // +/-200 us alternating jitter on a 300 mm/s pass
+    float speed_mms = 300.0f;
+    RunResult run = makeUniformRun_AtoB(speed_mms);
+    for (int i = 0; i < NUM_SENSORS; i++) {
+        run.timestamps[i] += (i % 2) ? 200 : 0;
+    }
+
+    SpeedFit fit;
+    TEST_ASSERT_TRUE(speed_fit(run.timestamps, run.triggered, run.direction, fit));
+    TEST_ASSERT_TRUE(fit.residualRmsMm > 0.0f);
+    TEST_ASSERT_TRUE(fit.velocityCi95MmS > 0.0f);
+    TEST_ASSERT_TRUE(fabsf(fit.velocityMmS - speed_mms) <= fit.velocityCi95MmS);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, fit.velocityCi95MmS * EXPECTED_MMS_TO_MPH, fit.scaleCi95Mph);
+}
+
+
+void test_fit_rejects_single_point(void) {
+    RunResult run = makeUniformRun_AtoB(500.0f);
+    for (int i = 1; i < NUM_SENSORS; i++) {
+        run.triggered[i] = false;
+    }
+
+    SpeedFit fit;
+    TEST_ASSERT_FALSE(speed_fit(run.timestamps, run.triggered, run.direction, fit));
+    TEST_ASSERT_EQUAL_INT(1, fit.points);
+}
+
+
+void test_scale_selection_changes_mph(void) {
+    // Same pass measured as N scale: mph scales with the ratio, mm/s does not
+    float speed_mms = 500.0f;
+    RunResult run = makeUniformRun_AtoB(speed_mms);
+
+    SpeedResult ho;
+    TEST_ASSERT_TRUE(speed_calculate(run, ho));
+
+    speed_set_scale(SCALE_N);
+    SpeedResult n;
+    TEST_ASSERT_TRUE(speed_calculate(run, n));
+    speed_set_scale(SCALE_HO);
+
+    float expected_n_mph = speed_mms * 160.0f * 3600.0f / (1000000.0f * 1.609344f);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, speed_mms, n.intervalSpeedsMmS[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, expected_n_mph, n.avgScaleSpeedMph);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, expected_n_mph, n.fit.scaleSpeedMph);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, ho.avgScaleSpeedMph * 160.0f / HO_SCALE_FACTOR, n.avgScaleSpeedMph);
+}
+
+
+void test_scale_names_and_ratios(void) {
+    ScaleId id;
+    TEST_ASSERT_TRUE(speed_scale_from_name("ho", id));
+    TEST_ASSERT_EQUAL_INT(SCALE_HO, id);
+    TEST_ASSERT_TRUE(speed_scale_from_name("O", id));
+    TEST_ASSERT_EQUAL_INT(SCALE_O, id);
+    TEST_ASSERT_FALSE(speed_scale_from_name("G", id));
+    TEST_ASSERT_FALSE(speed_scale_from_name(NULL, id));
+
+    TEST_ASSERT_EQUAL_STRING("N", speed_scale_name(SCALE_N));
+    TEST_ASSERT_EQUAL_STRING("S", speed_scale_name(SCALE_S));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 48.0f, speed_scale_ratio(SCALE_O));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, HO_SCALE_FACTOR, speed_scale_ratio(SCALE_HO));
+
+    // Out-of-range ids are ignored
+    speed_set_scale(SCALE_COUNT);
+    TEST_ASSERT_EQUAL_INT(DEFAULT_SCALE, speed_get_scale());
+}
+
+
+void test_sensor_geometry_is_constexpr(void) {
+    static_assert(sensor_position_mm(0) == 0.0f, "sensor 0 is the origin");
+    static_assert(scale_mms_to_mph(ScaleTraits<SCALE_HO>::ratio()) > 0.0f, "folds at compile time");
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, (NUM_SENSORS - 1) * SENSOR_SPACING_MM,
+                             sensor_position_mm(NUM_SENSORS - 1));
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, EXPECTED_MMS_TO_MPH,
+                             scale_mms_to_mph(ScaleTraits<SCALE_HO>::ratio()));
+}
+
+
+void test_intervals_agree_uniform(void) {
+    RunResult r = makeUniformRun_AtoB(500.0f);
+    TEST_ASSERT_TRUE(speed_intervals_agree(r, NUM_SENSORS - 1, 0.01f));
+    // Not enough intervals yet
+    TEST_ASSERT_FALSE(speed_intervals_agree(r, NUM_SENSORS, 0.01f));
+}
+
+void test_intervals_agree_run_in_progress(void) {
+    // B→A pass that has only reached the first three sensors
+    RunResult r = makeUniformRun_BtoA(200.0f);
+    r.triggered[0] = false;
+    r.sensorsTriggered = NUM_SENSORS - 1;
+    TEST_ASSERT_TRUE(speed_intervals_agree(r, NUM_SENSORS - 2, 0.01f));
+    TEST_ASSERT_FALSE(speed_intervals_agree(r, NUM_SENSORS - 1, 0.01f));
+}
+
+void test_intervals_disagree_while_accelerating(void) {
+    // Still picking up speed: the latest intervals differ by more than 3%
+    RunResult r = makeAcceleratingRun_AtoB(200.0f, 400.0f);
+    TEST_ASSERT_FALSE(speed_intervals_agree(r, NUM_SENSORS - 1, 0.03f));
+    // A loose tolerance accepts it
+    TEST_ASSERT_TRUE(speed_intervals_agree(r, NUM_SENSORS - 1, 0.5f));
+}
+
+void test_intervals_agree_needs_direction(void) {
+    RunResult r = makeUniformRun_AtoB(500.0f);
+    r.direction = DIR_UNKNOWN;
+    TEST_ASSERT_FALSE(speed_intervals_agree(r, 2, 0.5f));
+    r.direction = DIR_A_TO_B;
+    TEST_ASSERT_FALSE(speed_intervals_agree(r, 0, 0.5f));
+}
+
+
+void test_edge_timeout_from_last_speed(void) {
+    // A→B at 100 mm/s, first two sensors in: next is due in 1 s
+    RunResult r = makeUniformRun_AtoB(100.0f);
+    for (int i = 2; i < NUM_SENSORS; i++) r.triggered[i] = false;
+    r.sensorsTriggered = 2;
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(EDGE_TIMEOUT_FACTOR * 1000000.0f),
+                             speed_next_edge_timeout_us(r));
+
+    // B→A at the same speed
+    RunResult b = makeUniformRun_BtoA(100.0f);
+    for (int i = 0; i < NUM_SENSORS - 2; i++) b.triggered[i] = false;
+    b.sensorsTriggered = 2;
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(EDGE_TIMEOUT_FACTOR * 1000000.0f),
+                             speed_next_edge_timeout_us(b));
+}
+
+void test_edge_timeout_limits(void) {
+    // Fast pass: floor applies
+    RunResult r = makeUniformRun_AtoB(2000.0f);
+    for (int i = 2; i < NUM_SENSORS; i++) r.triggered[i] = false;
+    r.sensorsTriggered = 2;
+    TEST_ASSERT_EQUAL_UINT32(EDGE_TIMEOUT_MIN_MS * 1000UL, speed_next_edge_timeout_us(r));
+
+    // Crawl: capped at the detection timeout
+    r = makeUniformRun_AtoB(1.0f);
+    for (int i = 2; i < NUM_SENSORS; i++) r.triggered[i] = false;
+    r.sensorsTriggered = 2;
+    TEST_ASSERT_EQUAL_UINT32(DETECTION_TIMEOUT_MS * 1000UL, speed_next_edge_timeout_us(r));
+}
+
+void test_edge_timeout_no_speed_or_far_end(void) {
+    RunResult r = makeUniformRun_AtoB(100.0f);
+    // Far-end sensor already blocked: trailing-edge timeout takes over
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, speed_next_edge_timeout_us(r));
+
+    // Only one sensor: no speed yet
+    for (int i = 1; i < NUM_SENSORS; i++) r.triggered[i] = false;
+    r.sensorsTriggered = 1;
+    TEST_ASSERT_EQUAL_UINT32(0, speed_next_edge_timeout_us(r));
+}
+
+
+void test_fit_zero_velocity_time(void) {
+    // 100 mm/s at sensor 0, +200 mm/s^2: started from rest 0.5 s earlier
+    RunResult r = makeAcceleratingRun_AtoB(100.0f, 200.0f);
+    SpeedFit fit;
+    TEST_ASSERT_TRUE(speed_fit(r.timestamps, r.triggered, r.direction, fit));
+    uint64_t startUs;
+    TEST_ASSERT_TRUE(speed_fit_zero_velocity_us(fit, startUs));
+    TEST_ASSERT_INT_WITHIN(2000, (int)(r.timestamps[0] - 500000), (int)startUs);
+
+    // Decelerating: stop time lies after the last sensor
+    RunResult d = makeAcceleratingRun_AtoB(400.0f, -200.0f);
+    TEST_ASSERT_TRUE(speed_fit(d.timestamps, d.triggered, d.direction, fit));
+    uint64_t stopUs;
+    TEST_ASSERT_TRUE(speed_fit_zero_velocity_us(fit, stopUs));
+    TEST_ASSERT_INT_WITHIN(2000, (int)(d.timestamps[0] + 2000000), (int)stopUs);
+
+    // Constant speed: no zero crossing
+    RunResult u = makeUniformRun_AtoB(300.0f);
+    speed_fit(u.timestamps, u.triggered, u.direction, fit);
+    TEST_ASSERT_FALSE(speed_fit_zero_velocity_us(fit, stopUs));
+}
+
+
 // ================================================================
 // Test runner
 // ================================================================
@@ -351,6 +740,30 @@ int main(int argc, char **argv) {
     RUN_TEST(test_varying_speeds);
     RUN_TEST(test_scale_factor_sanity);
     RUN_TEST(test_b_to_a_timestamps_reordered);
+    RUN_TEST(test_timestamps_across_32bit_wrap);
+    RUN_TEST(test_no_trailing_edges);
+    RUN_TEST(test_trailing_edges_match_leading);
+    RUN_TEST(test_trailing_edges_B_to_A);
+    RUN_TEST(test_loco_length_from_dwell);
+    RUN_TEST(test_trailing_edge_missing_sensor);
+    RUN_TEST(test_fit_uniform_speed);
+    RUN_TEST(test_fit_B_to_A_positive_velocity);
+    RUN_TEST(test_fit_recovers_acceleration);
+    RUN_TEST(test_fit_bridges_missing_sensor);
+    RUN_TEST(test_fit_two_points_is_linear);
+    RUN_TEST(test_fit_jitter_gives_confidence_interval);
+    RUN_TEST(test_fit_rejects_single_point);
+    RUN_TEST(test_scale_selection_changes_mph);
+    RUN_TEST(test_scale_names_and_ratios);
+    RUN_TEST(test_sensor_geometry_is_constexpr);
+    RUN_TEST(test_intervals_agree_uniform);
+    RUN_TEST(test_intervals_agree_run_in_progress);
+    RUN_TEST(test_intervals_disagree_while_accelerating);
+    RUN_TEST(test_intervals_agree_needs_direction);
+    RUN_TEST(test_edge_timeout_from_last_speed);
+    RUN_TEST(test_edge_timeout_limits);
+    RUN_TEST(test_edge_timeout_no_speed_or_far_end);
+    RUN_TEST(test_fit_zero_velocity_time);
 
     return UNITY_END();
 }
@@ -0,0 +1,279 @@
+/**
+ * Unit tests for speed_model.cpp
+ *
+ * Tests the PCHIP interpolant, the sparse sweep planner (initial knots,
+ * refinement around start of motion and poor knots) and the 126-step
+ * table built from a handful of measured steps.
+ * Runs natively on desktop (no hardware needed).
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "speed_model.h"
+
+#include <string.h>
+
+// Pull in the implementation directly for native builds
+#include "../../src/speed_model.cpp"
+
+// --- Helpers ---
+
+// A smooth decoder curve: stationary up to step 4, then concave rise
+static float curveMph(int step) {
+    if (step <= 4) return 0.0f;
+    float s = (float)(step - 4);
+    return 0.9f * s - 0.0025f * s * s;
+}
+
+static SpeedKnot knotAt(int step) {
+    SpeedKnot k;
+    k.step = step;
+    k.mph = curveMph(step);
+    k.ci95 = 0.0f;
+    k.moving = k.mph > 0;
+    return k;
+}
+
+// Insert a knot keeping the array sorted by step.
+static void insertKnot(SpeedKnot* knots, int& n, SpeedKnot k) {
+    int i = n;
+    while (i > 0 && knots[i - 1].step > k.step) {
+        knots[i] = knots[i - 1];
+        i--;
+    }
+    knots[i] = k;
+    n++;
+}
+
+// --- Tests ---
+
+void test_pchip_passes_through_knots(void) {
+    const float x[] = {0, 1, 3, 6};
+    const float y[] = {0, 2, 3, 7};
+    float d[4];
+    pchip_slopes(x, y, 4, d);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, y[i], pchip_eval(x, y, d, 4, x[i]));
+    }
+}
+
+void test_pchip_is_monotone_without_overshoot(void) {
+    // Step-like data: a plain cubic spline overshoots here
+    const float x[] = {0, 1, 2, 3, 4};
+    const float y[] = {0, 0, 10, 10, 10};
+    float d[5];
+    pchip_slopes(x, y, 5, d);
+    float prev = -1;
+    for (float q = 0; q <= 4.0f; q += 0.05f) {
+        float v = pchip_eval(x, y, d, 5, q);
+        TEST_ASSERT_TRUE(v >= prev - 1e-5f);
+        TEST_ASSERT_TRUE(v >= -1e-5f && v <= 10.0f + 1e-5f);
+        prev = v;
+    }
+}
+
+void test_pchip_reproduces_line(void) {
+    const float x[] = {1, 20, 50, 126};
+    const float y[] = {2, 40, 100, 252};
+    float d[4];
+    pchip_slopes(x, y, 4, d);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 70.0f, pchip_eval(x, y, d, 4, 35.0f));
+    // Linear extension past the ends
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.0f, pchip_eval(x, y, d, 4, 0.0f));
+}
+
+void test_initial_steps_span_range(void) {
+    int steps[16];
+    int n = speed_model_initial_steps(1, 126, 6, steps);
+    TEST_ASSERT_EQUAL_INT(6, n);
+    TEST_ASSERT_EQUAL_INT(1, steps[0]);
+    TEST_ASSERT_EQUAL_INT(126, steps[5]);
+    for (int i = 1; i < n; i++) TEST_ASSERT_TRUE(steps[i] > steps[i - 1]);
+
+    // More knots than steps: every step once
+    n = speed_model_initial_steps(10, 13, 8, steps);
+    TEST_ASSERT_EQUAL_INT(4, n);
+    TEST_ASSERT_EQUAL_INT(13, steps[3]);
+}
+
+void test_refine_locates_start_of_motion(void) {
+    SpeedKnot knots[8];
+    int n = 0;
+    insertKnot(knots, n, knotAt(1));
+    insertKnot(knots, n, knotAt(26));
+    insertKnot(knots, n, knotAt(51));
+
+    // Bisect the stationary/moving gap until the onset is bracketed
+    for (int round = 0; round < 8; round++) {
+        int next[8];
+        int r = speed_model_refine_steps(knots, n, 0.5f, next, 8);
+        if (r == 0) break;
+        TEST_ASSERT_EQUAL_INT(1, r);
+        insertKnot(knots, n, knotAt(next[0]));
+    }
+    // Adjacent knots 4 (stationary) and 5 (moving)
+    int i = 0;
+    while (!knots[i + 1].moving) i++;
+    TEST_ASSERT_EQUAL_INT(4, knots[i].step);
+    TEST_ASSERT_EQUAL_INT(5, knots[i + 1].step);
+}
+
+void test_refine_around_outlier_knot(void) {
+    SpeedKnot knots[8];
+    int n = 0;
+    int initial[5];
+    int k = speed_model_initial_steps(5, 125, 5, initial);
+    for (int i = 0; i < k; i++) insertKnot(knots, n, knotAt(initial[i]));
+
+    int next[8];
+    TEST_ASSERT_EQUAL_INT(0, speed_model_refine_steps(knots, n, 0.05f, next, 8));
+
+    // Middle knot measured 20% fast (slip): both neighbouring gaps refined
+    knots[2].mph *= 1.2f;
+    TEST_ASSERT_TRUE(fabsf(speed_model_loo_residual(knots, n, 2)) > 0.1f * knots[2].mph);
+    int r = speed_model_refine_steps(knots, n, 0.05f, next, 8);
+    TEST_ASSERT_TRUE(r >= 2);
+}
+
+void test_remeasure_on_poor_confidence(void) {
+    SpeedKnot knots[4] = {knotAt(10), knotAt(40), knotAt(70), knotAt(100)};
+    int next[4];
+    TEST_ASSERT_EQUAL_INT(0, speed_model_refine_steps(knots, 4, 0.05f, next, 4));
+    TEST_ASSERT_EQUAL_INT(0, speed_model_remeasure_steps(knots, 4, 0.05f, next, 4));
+    // A noisy knot gets more passes, not new steps beside it
+    knots[3].ci95 = 0.1f * knots[3].mph;
+    TEST_ASSERT_EQUAL_INT(0, speed_model_refine_steps(knots, 4, 0.05f, next, 4));
+    TEST_ASSERT_EQUAL_INT(1, speed_model_remeasure_steps(knots, 4, 0.05f, next, 4));
+    TEST_ASSERT_EQUAL_INT(100, next[0]);
+}
+
+// Simulated measurement: per-pass spread 3% below step 30, 1% above;
+// mean of `passes` passes with deterministic noise, CI95 ~ 2 sigma / sqrt(passes)
+static uint32_t noiseSeed = 1;
+static float noise() {
+    float sum = 0;
+    for (int i = 0; i < 4; i++) {
+        noiseSeed = noiseSeed * 1103515245u + 12345u;
+        sum += ((noiseSeed >> 16) & 0x7FFF) / 32767.0f - 0.5f;
+    }
+    return sum;   // ~unit variance / 3
+}
+
+static SpeedKnot measureKnot(int step, int passes) {
+    SpeedKnot k = knotAt(step);
+    if (!k.moving) return k;
+    float sigma = (step < 30 ? 0.03f : 0.01f) * k.mph / sqrtf((float)passes);
+    k.mph += sigma * noise() * 1.73f;
+    k.ci95 = 2.0f * sigma;
+    return k;
+}
+
+void test_sparse_refinement_with_noisy_knots(void) {
+    // Low-speed knots with 2%+ CI must not drive bisection down to a dense
+    // sweep: they get more passes, the model still needs far fewer steps
+    SpeedKnot knots[64];
+    int passes[127] = {0};
+    int n = 0;
+    int initial[12];
+    int k = speed_model_initial_steps(1, 126, 12, initial);
+    for (int i = 0; i < k; i++) {
+        passes[initial[i]] = 3;
+        insertKnot(knots, n, measureKnot(initial[i], 3));
+    }
+    int measuredSteps = n;
+    for (int round = 0; round < 4; round++) {   // SWEEP_REFINE_ROUNDS
+        int again[16], next[16];
+        int a = speed_model_remeasure_steps(knots, n, 0.02f, again, 16);
+        int r = speed_model_refine_steps(knots, n, 0.02f, next, 16);
+        if (a == 0 && r == 0) break;
+        for (int i = 0; i < a; i++) {
+            if (passes[again[i]] >= 8) continue;
+            passes[again[i]] = (passes[again[i]] * 2 > 8) ? 8 : passes[again[i]] * 2;
+            for (int j = 0; j < n; j++) {
+                if (knots[j].step == again[i]) knots[j] = measureKnot(again[i], passes[again[i]]);
+            }
+        }
+        for (int i = 0; i < r; i++) {
+            passes[next[i]] = 3;
+            insertKnot(knots, n, measureKnot(next[i], 3));
+            measuredSteps++;
+        }
+    }
+    TEST_ASSERT_TRUE(measuredSteps <= 126 / 4);
+
+    SpeedTableEntry table[126];
+    TEST_ASSERT_TRUE(speed_model_table(knots, n, 1, 126, table));
+    for (int step = 5; step <= 126; step++) {
+        float expected = curveMph(step);
+        TEST_ASSERT_FLOAT_WITHIN(0.05f * expected + 0.1f, expected, table[step - 1].mph);
+    }
+}
+
+void test_sparse_table_matches_curve(void) {
+    // ~15 knots stand in for 126 measured steps
+    SpeedKnot knots[32];
+    int n = 0;
+    int initial[12];
+    int k = speed_model_initial_steps(1, 126, 12, initial);
+    for (int i = 0; i < k; i++) insertKnot(knots, n, knotAt(initial[i]));
+    for (int round = 0; round < 10; round++) {
+        int next[16];
+        int r = speed_model_refine_steps(knots, n, 0.02f, next, 16);
+        if (r == 0) break;
+        for (int i = 0; i < r; i++) insertKnot(knots, n, knotAt(next[i]));
+    }
+    TEST_ASSERT_TRUE(n <= 126 / 3);
+
+    SpeedTableEntry table[126];
+    TEST_ASSERT_TRUE(speed_model_table(knots, n, 1, 126, table));
+    for (int step = 1; step <= 126; step++) {
+        float expected = curveMph(step);
+        TEST_ASSERT_FLOAT_WITHIN(0.02f * expected + 0.05f, expected, table[step - 1].mph);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, table[3].mph);   // Step 4: stationary
+    TEST_ASSERT_TRUE(table[0].measured);
+    TEST_ASSERT_TRUE(table[125].measured);
+}
+
+void test_table_confidence_grows_mid_gap(void) {
+    SpeedKnot knots[4] = {knotAt(10), knotAt(40), knotAt(70), knotAt(100)};
+    for (int i = 0; i < 4; i++) knots[i].ci95 = 0.1f;
+    knots[1].mph *= 1.05f;  // Some model error around step 40
+
+    SpeedTableEntry table[91];
+    TEST_ASSERT_TRUE(speed_model_table(knots, 4, 10, 100, table));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.1f, table[0].ci95);          // Knot
+    TEST_ASSERT_FALSE(table[45 - 10].measured);
+    TEST_ASSERT_TRUE(table[55 - 10].ci95 > table[42 - 10].ci95);   // Mid-gap > near knot
+    TEST_ASSERT_TRUE(table[55 - 10].ci95 > 0.1f);
+}
+
+void test_table_needs_moving_knot(void) {
+    SpeedKnot knots[2] = {knotAt(1), knotAt(3)};
+    SpeedTableEntry table[3];
+    TEST_ASSERT_FALSE(speed_model_table(knots, 2, 1, 3, table));
+}
+
+
+// ================================================================
+// Test runner
+// ================================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_pchip_passes_through_knots);
+    RUN_TEST(test_pchip_is_monotone_without_overshoot);
+    RUN_TEST(test_pchip_reproduces_line);
+    RUN_TEST(test_initial_steps_span_range);
+    RUN_TEST(test_refine_locates_start_of_motion);
+    RUN_TEST(test_refine_around_outlier_knot);
+    RUN_TEST(test_remeasure_on_poor_confidence);
+    RUN_TEST(test_sparse_refinement_with_noisy_knots);
+    RUN_TEST(test_sparse_table_matches_curve);
+    RUN_TEST(test_table_confidence_grows_mid_gap);
+    RUN_TEST(test_table_needs_moving_knot);
+
+    return UNITY_END();
+}
@@ -0,0 +1,123 @@
+/**
+ * Unit tests for vibration_stats.cpp
+ *
+ * Tests the single-pass accumulator against the two-pass calculation:
+ * mean, RMS, peak-to-peak, crest factor and the octave histogram, fed
+ * block by block as the sampler hands samples over.
+ * Runs natively on desktop (no hardware needed).
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "vibration_stats.h"
+
+#include <math.h>
+
+// Pull in the implementation directly for native builds
+#include "../../src/vibration_stats.cpp"
+
+static uint16_t samples[20000];
+
+// Two-pass reference RMS about the mean
+static double refRms(const uint16_t* s, int n) {
+    double mean = 0;
+    for (int i = 0; i < n; i++) mean += s[i];
+    mean /= n;
+    double sq = 0;
+    for (int i = 0; i < n; i++) sq += (s[i] - mean) * (s[i] - mean);
+    return sqrt(sq / n);
+}
+
+// --- Tests ---
+
+void test_empty(void) {
+    VibrationAccumulator a;
+    vibration_acc_reset(a, 2048);
+    TEST_ASSERT_EQUAL_UINT32(0, a.count);
+    TEST_ASSERT_EQUAL_FLOAT(2048.0f, vibration_acc_mean(a));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, vibration_acc_rms(a));
+    TEST_ASSERT_EQUAL_UINT16(0, vibration_acc_peak_to_peak(a));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, vibration_acc_crest(a));
+}
+
+void test_matches_two_pass_in_blocks(void) {
+    // Sine on a bias well away from the accumulator's reference
+    int n = 20000;
+    for (int i = 0; i < n; i++) {
+        samples[i] = (uint16_t)lround(1800 + 300 * sin(2 * M_PI * 120 * i / 10000.0) + (i % 7) - 3);
+    }
+    VibrationAccumulator a;
+    vibration_acc_reset(a, 2048);
+    for (int i = 0; i < n; i += 256) {
+        vibration_acc_add(a, samples + i, (n - i < 256) ? n - i : 256);
+    }
+    TEST_ASSERT_EQUAL_UINT32(n, a.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 1800.0f, vibration_acc_mean(a));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, (float)refRms(samples, n), vibration_acc_rms(a));
+    TEST_ASSERT_INT_WITHIN(6, 600, vibration_acc_peak_to_peak(a));
+    // Sine crest factor sqrt(2)
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, 1.414f, vibration_acc_crest(a));
+}
+
+void test_crest_flags_impacts(void) {
+    // Low-level noise with a few sharp knocks
+    for (int i = 0; i < 5000; i++) {
+        samples[i] = (uint16_t)(2048 + ((i * 37) % 9) - 4);
+    }
+    samples[1000] = 2448;
+    samples[3000] = 1648;
+    VibrationAccumulator a;
+    vibration_acc_reset(a, 2048);
+    vibration_acc_add(a, samples, 5000);
+    TEST_ASSERT_GREATER_THAN(20.0f, vibration_acc_crest(a));
+    TEST_ASSERT_EQUAL_UINT16(800, vibration_acc_peak_to_peak(a));
+}
+
+void test_histogram_octaves(void) {
+    uint16_t s[] = {2048, 2049, 2046, 2051, 2044, 2148, 1024, 0, 4095};
+    VibrationAccumulator a;
+    vibration_acc_reset(a, 2048);
+    vibration_acc_add(a, s, 9);
+    // |d| = 0, 1, 2, 3, 4, 100, 1024, 2048, 2047
+    TEST_ASSERT_EQUAL_UINT32(1, a.histogram[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, a.histogram[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, a.histogram[2]);    // 2..3
+    TEST_ASSERT_EQUAL_UINT32(1, a.histogram[3]);    // 4..7
+    TEST_ASSERT_EQUAL_UINT32(1, a.histogram[7]);    // 64..127
+    TEST_ASSERT_EQUAL_UINT32(2, a.histogram[11]);   // 1024..2047
+    TEST_ASSERT_EQUAL_UINT32(1, a.histogram[12]);   // 2048 and up (top bin)
+    uint32_t total = 0;
+    for (int b = 0; b < VIBRATION_HIST_BINS; b++) total += a.histogram[b];
+    TEST_ASSERT_EQUAL_UINT32(9, total);
+}
+
+void test_long_capture_exact(void) {
+    // Ten minutes at 10kHz: integer sums stay exact
+    VibrationAccumulator a;
+    vibration_acc_reset(a, 2000);
+    uint16_t block[2] = {0, 4095};
+    for (int i = 0; i < 3000000; i++) {
+        vibration_acc_add(a, block, 2);
+    }
+    TEST_ASSERT_EQUAL_UINT32(6000000, a.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2047.5f, vibration_acc_mean(a));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2047.5f, vibration_acc_rms(a));
+}
+
+
+// ================================================================
+// Test runner
+// ================================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_empty);
+    RUN_TEST(test_matches_two_pass_in_blocks);
+    RUN_TEST(test_crest_flags_impacts);
+    RUN_TEST(test_histogram_octaves);
+    RUN_TEST(test_long_capture_exact);
+
+    return UNITY_END();
+}
@@ -0,0 +1,139 @@
+/**
+ * Unit tests for window_stats.cpp
+ *
+ * Tests the load cell window summary: mean, median, sample stddev,
+ * min/max, least-squares slope against sample time, and the steadiness
+ * rule the pull test's auto settle uses.
+ * Runs natively on desktop (no hardware needed).
+ *
+ * Run with: pio test -e native
+ */
+
+#include <unity.h>
+#include "config.h"
+#include "window_stats.h"
+
+// Pull in the implementation directly for native builds
+#include "../../src/window_stats.cpp"
+
+// 80 SPS sample times starting at an arbitrary boot offset
+static void sampleTimes(uint64_t* t, int n) {
+    for (int i = 0; i < n; i++) t[i] = 5000000000ULL + (uint64_t)i * 12500;
+}
+
+// --- Tests ---
+
+void test_empty_window(void) {
+    WindowStats s;
+    TEST_ASSERT_FALSE(window_stats_compute(NULL, NULL, 0, s));
+    TEST_ASSERT_EQUAL_INT(0, s.count);
+}
+
+void test_single_sample(void) {
+    float v[] = {42.0f};
+    uint64_t t[] = {1000};
+    WindowStats s;
+    TEST_ASSERT_TRUE(window_stats_compute(v, t, 1, s));
+    TEST_ASSERT_EQUAL_INT(1, s.count);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 42.0f, s.mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 42.0f, s.median);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, s.stddev);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, s.slopePerS);
+}
+
+void test_summary_values(void) {
+    float v[] = {3, 1, 4, 1, 5, 9, 2, 6};
+    uint64_t t[8];
+    sampleTimes(t, 8);
+    WindowStats s;
+    TEST_ASSERT_TRUE(window_stats_compute(v, t, 8, s));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 3.875f, s.mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 3.5f, s.median);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.748376f, s.stddev);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, s.min);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 9.0f, s.max);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0875f, s.spanS);
+}
+
+void test_slope_of_ramp(void) {
+    // Drawbar load still rising at 5 g/s on top of noise
+    const int n = 160;
+    float v[n];
+    uint64_t t[n];
+    sampleTimes(t, n);
+    for (int i = 0; i < n; i++) {
+        float sec = (t[i] - t[0]) / 1000000.0f;
+        v[i] = 100.0f + 5.0f * sec + ((i % 2) ? 0.8f : -0.8f);
+    }
+    WindowStats s;
+    TEST_ASSERT_TRUE(window_stats_compute(v, t, n, s));
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 5.0f, s.slopePerS);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 100.0f + 5.0f * s.spanS / 2, s.mean);
+}
+
+void test_median_resists_spike(void) {
+    // One bump against the drawbar: mean moves, median does not
+    float v[21];
+    uint64_t t[21];
+    sampleTimes(t, 21);
+    for (int i = 0; i < 21; i++) v[i] = 50.0f + ((i % 3) - 1) * 0.5f;
+    v[10] = 500.0f;
+    WindowStats s;
+    TEST_ASSERT_TRUE(window_stats_compute(v, t, 21, s));
+    TEST_ASSERT_FLOAT_WITHIN(0.51f, 50.0f, s.median);
+    TEST_ASSERT_TRUE(s.mean > 65.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 500.0f, s.max);
+}
+
+void test_steady_on_noise_not_ramp(void) {
+    const int n = 40;   // 500 ms at 80 SPS
+    float v[n];
+    uint64_t t[n];
+    sampleTimes(t, n);
+    for (int i = 0; i < n; i++) v[i] = 30.0f + ((i % 2) ? 0.3f : -0.3f);
+    WindowStats s;
+    window_stats_compute(v, t, n, s);
+    TEST_ASSERT_TRUE(window_stats_steady(s, 2.0f, 1.0f, 0.0f));
+
+    // Still climbing at 10 g/s: not settled
+    for (int i = 0; i < n; i++) v[i] += 10.0f * (t[i] - t[0]) / 1000000.0f;
+    window_stats_compute(v, t, n, s);
+    TEST_ASSERT_FALSE(window_stats_steady(s, 2.0f, 1.0f, 0.0f));
+}
+
+void test_steady_limits_scale_with_pull(void) {
+    // 3 g stddev is noise on a 400 g pull, not on a 30 g one
+    const int n = 40;
+    float v[n];
+    uint64_t t[n];
+    sampleTimes(t, n);
+    for (int i = 0; i < n; i++) v[i] = 400.0f + ((i % 2) ? 3.0f : -3.0f);
+    WindowStats s;
+    window_stats_compute(v, t, n, s);
+    TEST_ASSERT_FALSE(window_stats_steady(s, 2.0f, 1.0f, 0.0f));
+    TEST_ASSERT_TRUE(window_stats_steady(s, 2.0f, 1.0f, 0.02f));
+
+    // The slope limit does not scale: 400 g climbing at 5 g/s is not settled
+    for (int i = 0; i < n; i++) v[i] += 5.0f * (t[i] - t[0]) / 1000000.0f;
+    window_stats_compute(v, t, n, s);
+    TEST_ASSERT_FALSE(window_stats_steady(s, 2.0f, 1.0f, 0.02f));
+}
+
+
+// ================================================================
+// Test runner
+// ================================================================
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_empty_window);
+    RUN_TEST(test_single_sample);
+    RUN_TEST(test_summary_values);
+    RUN_TEST(test_slope_of_ramp);
+    RUN_TEST(test_median_resists_spike);
+    RUN_TEST(test_steady_on_noise_not_ramp);
+    RUN_TEST(test_steady_limits_scale_with_pull);
+
+    return UNITY_END();
+}